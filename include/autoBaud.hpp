@@ -0,0 +1,25 @@
+#ifndef AUTO_BAUD_HPP
+#define AUTO_BAUD_HPP
+
+#include <vector>
+
+#include "frameDecoder.hpp"
+
+// Default serial baud rate of the oven controller.
+#define DEFAULT_BAUD 9600
+
+// Time to listen at each baud rate while detecting the rate (ms). This covers the two packets
+// needed to confirm the framing, plus any partial packet, at one packet per second.
+#define AUTOBAUD_TIMEOUT 3500
+
+// Return the baud rates tried by detectBaud(), in order: the default rate, the standard rates and
+// the rates which are exact on a 16 MHz Arduino.
+std::vector<int> getBaudRates();
+
+// Detect the baud rate of an open serial port. Each rate is tried for up to timeout_ ms until the
+// received bytes contain two consecutive valid packets, i.e. two frames with a valid CRC or three
+// legacy delimiters one packet apart. The port is left at the detected rate, and the packet format
+// is returned in format_. Return the baud rate, 0 if no rate matched or -1 on a port error.
+int detectBaud(const int &fd_, const std::vector<int> &rates_, PacketFormat &format_, const int &timeout_=AUTOBAUD_TIMEOUT);
+
+#endif
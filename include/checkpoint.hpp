@@ -0,0 +1,78 @@
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+#include <string>
+#include <stdint.h>
+
+#include "relayEdges.hpp"
+
+// Identifier at the start of every checkpoint file.
+#define CHECKPOINT_MAGIC "OVENCKP"
+
+#define CHECKPOINT_VERSION 1
+
+// Maximum number of text output files which may be extended in place.
+#define CHECKPOINT_NUM_OUTPUTS 4
+
+// Number of input bytes hashed at the start of the file and before the resume offset.
+#define CHECKPOINT_HASH_LENGTH 4096
+
+// Checkpoint file layout (all values little-endian):
+//  CheckpointHeader
+// The checkpoint is a sidecar to the output of an incremental (follow mode) run over a growing
+// capture file. It is only valid while the input file still starts with the same bytes and is at
+// least as long as the resume offset, and while every output is at least as long as it was.
+
+struct CheckpointHeader{
+	char magic[8];
+	uint32_t version;
+	uint32_t format; // Packet format of the input file.
+	uint64_t inputOffset; // Offset at which to resume decoding the input file.
+	uint64_t inputHash; // Hash of the input file (see CHECKPOINT_HASH_LENGTH).
+	uint64_t numPackets; // Number of packets decoded, including any junk packets.
+	uint64_t numRecords; // Number of records written.
+	uint64_t outputSize[CHECKPOINT_NUM_OUTPUTS]; // Length of each text output (bytes).
+	uint32_t lastTimestamp; // Timestamp of the last packet decoded (ms).
+	uint32_t lastSequence; // Sequence number of the last valid frame (framed input).
+	uint8_t haveSequence;
+	uint8_t synced; // Non-zero if the resume offset directly follows a frame delimiter (framed input).
+	uint8_t reserved[6];
+	RelayState relays[2];
+	char title[64];
+};
+
+// State of an incremental run over a growing capture file, so that the next run only decodes the
+// packets which were appended since and extends the outputs in place.
+class Checkpoint{
+  public:
+	CheckpointHeader header;
+
+	Checkpoint();
+
+	// Clear the checkpoint, i.e. start from the beginning of the input.
+	void reset();
+
+	// Load a checkpoint and check it against the input file buffer. Return false (and reset the
+	// checkpoint) if the checkpoint is missing, out of date or was written for a different input.
+	bool load(const std::string &fname_, const char *data_, const size_t &size_);
+
+	// Write the checkpoint for the input file buffer. Return true if the file was written successfully.
+	bool save(const std::string &fname_, const char *data_, const size_t &size_);
+
+	// Truncate an output file to its length at the checkpoint, removing anything written after the
+	// checkpoint was saved. Return false if the file is shorter than it was. Files which are not
+	// regular files (e.g. /dev/null) are left alone.
+	static bool truncateOutput(const std::string &fname_, const uint64_t &size_);
+
+	// Return the length of a file, or zero if it does not exist.
+	static uint64_t getFileSize(const std::string &fname_);
+
+	// Return the default checkpoint filename for an output file.
+	static std::string getSidecarName(const std::string &outname_){ return outname_+".ckp"; }
+
+  private:
+	// Hash the start of the input buffer and the bytes before the resume offset.
+	static uint64_t hashInput(const char *data_, const size_t &offset_);
+};
+
+#endif
@@ -0,0 +1,133 @@
+#ifndef COLUMN_STORE_HPP
+#define COLUMN_STORE_HPP
+
+#include <fstream>
+#include <vector>
+#include <string>
+#include <stdint.h>
+
+#include "packetDecoder.hpp"
+
+// Identifier at the start of every column file.
+#define COLUMN_MAGIC "OVENCOL"
+
+#define COLUMN_VERSION 1
+
+// Default number of records per chunk.
+#define COLUMN_CHUNK_SIZE 65536
+
+// Column file layout (all values little-endian):
+//  ColumnHeader
+//  chunk 0: time[n] (uint32), temperature[n] (float), pressure[n] (float, Torr), relay1[n] (int16), relay2[n] (int16)
+//  chunk 1: ...
+//  ColumnChunk[numChunks] (chunk index with min/max zone maps)
+// Each chunk starts on an 8 byte boundary so that the columns may be used directly from a mapped file.
+
+struct ColumnHeader{
+	char magic[8];
+	uint32_t version;
+	uint32_t chunkSize;
+	uint64_t numRecords;
+	uint64_t indexOffset;
+	uint32_t numChunks;
+	uint32_t reserved;
+	char title[64];
+};
+
+struct ColumnChunk{
+	uint64_t offset; // Offset of the first column of the chunk.
+	uint32_t numRecords;
+	uint32_t timeMin;
+	uint32_t timeMax;
+	float tempMin; // NaN values are ignored.
+	float tempMax;
+	float presMin;
+	float presMax;
+	uint32_t relay1On; // Number of records with relay 1 on.
+	uint32_t relay2On; // Number of records with relay 2 on.
+	uint32_t reserved;
+};
+
+// Streaming writer for column files.
+class ColumnWriter{
+  public:
+	ColumnWriter(const size_t &chunkSize_=COLUMN_CHUNK_SIZE);
+
+	~ColumnWriter();
+
+	// Create a new column file. Return true if the file was opened successfully.
+	bool open(const std::string &fname_, const char *title_=NULL);
+
+	// Open an existing column file to add more records. An incomplete last chunk is read back and
+	// written again with the new records. Return false if the file is not a valid column file.
+	bool append(const std::string &fname_);
+
+	bool isOpen() const { return file.is_open(); }
+
+	// Add a single record. The pressure is given in Torr.
+	void add(const unsigned int &timestamp_, const float &temperature_, const float &pressure_, const short &relay1_, const short &relay2_);
+
+	// Write any remaining records along with the chunk index and close the file.
+	void close();
+
+	size_t getNumRecords() const { return header.numRecords+chunk.size(); }
+
+  private:
+	std::ofstream file;
+
+	ColumnHeader header;
+
+	PacketColumns chunk;
+
+	std::vector<ColumnChunk> index;
+
+	uint64_t offset;
+
+	// Write the current chunk to the file.
+	void writeChunk();
+};
+
+// Read-only access to a memory mapped column file.
+class ColumnReader{
+  public:
+	ColumnReader() : header(NULL), index(NULL) { }
+
+	// Open a column file. Return true if the file is a valid column file.
+	bool open(const std::string &fname_);
+
+	void close();
+
+	bool isOpen() const { return file.isOpen(); }
+
+	const ColumnHeader &getHeader() const { return *header; }
+
+	size_t getNumChunks() const { return header->numChunks; }
+
+	size_t getNumRecords() const { return header->numRecords; }
+
+	const ColumnChunk &getChunk(const size_t &chunk_) const { return index[chunk_]; }
+
+	// Return pointers to the columns of a chunk.
+	const uint32_t *getTime(const size_t &chunk_) const ;
+	const float *getTemperature(const size_t &chunk_) const ;
+	const float *getPressure(const size_t &chunk_) const ;
+	const int16_t *getRelay1(const size_t &chunk_) const ;
+	const int16_t *getRelay2(const size_t &chunk_) const ;
+
+	// Return true if a chunk may contain records within the time (ms) and temperature (C) ranges.
+	// Records with a NaN temperature only match when the temperature range is (-inf, inf).
+	bool mayMatch(const size_t &chunk_, const uint32_t &timeLow_, const uint32_t &timeHigh_, const float &tempLow_, const float &tempHigh_) const ;
+
+	// Append all records within the time and temperature ranges to the output columns.
+	// Return the number of chunks which were skipped using the zone maps.
+	size_t select(PacketColumns &cols_, const uint32_t &timeLow_, const uint32_t &timeHigh_, const float &tempLow_, const float &tempHigh_) const ;
+
+  private:
+	MappedFile file;
+
+	const ColumnHeader *header;
+
+	const ColumnChunk *index;
+};
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef DUMP_MERGER_HPP
+#define DUMP_MERGER_HPP
+
+#include <vector>
+#include <string>
+#include <stdint.h>
+
+#include "packetDecoder.hpp"
+#include "frameDecoder.hpp"
+#include "packetFormat.hpp"
+
+// Maximum forward gap across the millis() wraparound for two packets to be from the same boot (ms).
+#define DUMP_MAX_WRAP_GAP 3600000
+
+// Decode an entire data file (legacy, framed or compressed) into cols_. The junk first packet of
+// legacy files is removed. The title is truncated to 63 characters. Return false if the file
+// could not be opened.
+bool decodeDataFile(const std::string &fname_, PacketColumns &cols_, char *title_, PacketFormat &format_, const bool &scalar_=false, const bool &resync_=false);
+
+// A single data file of an SD card dump.
+struct DumpFile{
+	std::string path;
+	char title[64];
+	PacketFormat format;
+	PacketColumns cols;
+	bool opened;
+
+	unsigned int numWraps; // Number of times millis() wrapped around within the file.
+	unsigned int numReboots; // Number of times the controller rebooted at the start of the file.
+	unsigned int numOutOfOrder; // Number of packets earlier than the previous packet (but not wrapped around).
+};
+
+// Consecutive packets of a single file which have the same offset between the controller
+// time and the merged time.
+struct DumpSegment{
+	size_t file;
+	size_t begin;
+	size_t end;
+	uint64_t offset; // Merged time (ms) = offset + timestamp.
+};
+
+// Decodes all data files of an SD card dump (DATA0001.DAT, DATA0002.DAT, ...) in parallel and
+// merges them into a single stream ordered by time.
+//
+// Files are taken in name order, which is the order in which the firmware created them. The
+// controller time of each packet is placed on a 64 bit merged timeline:
+//  - A hot-swapped card starts a new file without resetting millis(), so a file with the same
+//    title whose first timestamp follows the last timestamp of the previous file continues the
+//    same timeline.
+//  - A timestamp which jumps forward across 2^32 (by less than DUMP_MAX_WRAP_GAP) is a millis()
+//    wraparound, and 2^32 ms are added to the rest of the boot.
+//  - The firmware opens a new file in setup(), so any other step backwards in time at the start
+//    of a file, or a change of title, is a reboot. The new boot is placed after the end of all
+//    earlier data.
+//  - Any other step backwards in time within a file is an out of order packet (e.g. a corrupt
+//    timestamp) and starts a new segment on the same timeline.
+// Each file is split into segments which are in time order, and the segments are then merged
+// with a k-way merge.
+class DumpMerger{
+  public:
+	DumpMerger();
+
+	// Use the scalar decoder and/or resync mode for legacy files.
+	void setScalar(const bool &state_=true){ scalar = state_; }
+
+	void setResync(const bool &state_=true){ resync = state_; }
+
+	// Add all DAT (and compressed) files in a directory. Return the number of files added.
+	size_t addDirectory(const std::string &dir_);
+
+	void addFile(const std::string &fname_);
+
+	// Decode all files using numThreads_ threads (0 uses all cores) and place them on the merged
+	// timeline. Return the total number of packets decoded.
+	size_t decode(unsigned int numThreads_=0);
+
+	// Write all packets to a csv writer in time order, with the pressure converted to Torr and
+	// the merged time in the first column. Return the number of packets written.
+	size_t merge(CsvWriter &writer_) const ;
+
+	const std::vector<DumpFile> &getFiles() const { return files; }
+
+	const std::vector<DumpSegment> &getSegments() const { return segments; }
+
+	size_t getNumPackets() const { return numPackets; }
+
+  private:
+	std::vector<DumpFile> files;
+	std::vector<DumpSegment> segments;
+
+	size_t numPackets;
+
+	bool scalar;
+	bool resync;
+
+	// Split the decoded files into segments and assign the merged time offsets.
+	void buildTimeline();
+};
+
+#endif
@@ -0,0 +1,148 @@
+#ifndef FRAME_DECODER_HPP
+#define FRAME_DECODER_HPP
+
+#include <vector>
+#include <stdint.h>
+
+#include "packetDecoder.hpp"
+#include "packetFrame.h"
+
+// Number of bytes to examine when detecting the format of a stream.
+#define FORMAT_DETECT_LENGTH 4096
+
+// Title written at the start of each file by the oven controller.
+#define DEFAULT_TITLE "JUN062016_Tmin=88.0,Tmax=89.0"
+
+// Length of the title, including the terminating null (bytes).
+#define TITLE_LENGTH 30
+
+// Maximum length of a file header (bytes).
+#define HEADER_MAX_LENGTH 35
+
+enum PacketFormat {FORMAT_UNKNOWN, FORMAT_LEGACY, FORMAT_FRAMED, FORMAT_COMPRESSED};
+
+// Detect the packet format of a stream from its first bytes. A stream is framed if it contains a
+// frame with a valid CRC, and legacy if it starts with a delimiter or contains two delimiters one
+// packet length apart.
+PacketFormat detectFormat(const char *data_, const size_t &len_);
+
+// Return the name of a packet format.
+const char *getFormatName(const PacketFormat &format_);
+
+// Encode a single packet the way the oven controller sends it, in the legacy or framed format. With
+// compact_, framed packets are sent as compact frames with the readings rounded to the nearest
+// quarter degree and ADC count. The output must have room for FRAME_MAX_LENGTH bytes. Return the
+// length of the packet.
+size_t encodePacket(const PacketFormat &format_, char *out_, const uint32_t &sequence_, const unsigned int &timestamp_, const float &temperature_, const float &pressure_, const short &relay1_, const short &relay2_, const bool &compact_=false);
+
+// Encode the file header written by the oven controller, i.e. the length of the title, the title
+// and a lone packet delimiter (legacy) or frame delimiter (framed). The output must have room for
+// HEADER_MAX_LENGTH bytes. Return the length of the header.
+size_t encodeHeader(const PacketFormat &format_, char *out_, const char *title_=DEFAULT_TITLE);
+
+// Stage times sent by the oven controller in a timing frame (see packetFrame.h).
+struct TimingRecord{
+	uint32_t timestamp; // ms
+	uint32_t stages[FRAME_TIMING_STAGES]; // Longest time spent in each stage since the last timing frame (us).
+};
+
+// Single pass decoder for framed packets (see packetFrame.h). Bytes may be passed in pieces of any
+// size, and partial frames are kept until the rest of the frame arrives. Lost frames are counted
+// exactly using the sequence numbers, and repeated frames are skipped. The fixed-point readings of
+// compact frames are converted to C and V, the same as full frames. Timing frames are decoded
+// separately from the packets.
+class FrameDecoder{
+  public:
+	FrameDecoder();
+
+	// Set an input buffer to decode with decode(cols_, N_).
+	void setInput(const char *data_, const size_t &len_, const size_t &offset_=0);
+
+	// Return true if the entire input buffer has been decoded.
+	bool eof() const { return (offset >= length); }
+
+	// Decode the next block of the input buffer, about N_ frames, and append the packets to the
+	// output columns. Return the number of packets decoded, which is only zero at the end of the input.
+	size_t decode(PacketColumns &cols_, const size_t &N_=PACKET_BLOCK_SIZE);
+
+	// Decode len_ bytes of a stream and append the packets to the output columns.
+	// Return the number of packets decoded.
+	size_t decode(const char *data_, const size_t &len_, PacketColumns &cols_);
+
+	// Append the stage times of each timing frame to an output vector (may be NULL, in which case
+	// timing frames are only counted).
+	void setTimingOutput(std::vector<TimingRecord> *timing_){ timing = timing_; }
+
+	// Forget any partial frame and the last sequence number.
+	void reset();
+
+	// Return the offset of the first byte after the last frame delimiter of the input buffer. Decoding
+	// of a growing input resumes here, so that a partial frame at the end is decoded again.
+	size_t getResumeOffset() const { return offset-pending; }
+
+	// Continue decoding a stream from the state saved by an earlier decoder: synced_ if the input starts
+	// directly after a frame delimiter, and the sequence number of the last valid frame (if any).
+	void resume(const bool &synced_, const bool &haveSequence_, const uint32_t &sequence_);
+
+	// Return true if a frame delimiter has been found.
+	bool isSynced() const { return synced; }
+
+	// Return true if a valid frame has been decoded since the last reset.
+	bool haveLastSequence() const { return haveSequence; }
+
+	uint32_t getLastSequence() const { return lastSequence; }
+
+	// Number of valid frames decoded.
+	size_t getNumDecoded() const { return numDecoded; }
+
+	// Number of valid timing frames decoded.
+	size_t getNumTiming() const { return numTiming; }
+
+	// Number of frames which failed the COBS, length, version or CRC checks.
+	size_t getNumCorrupt() const { return numCorrupt; }
+
+	// Number of frames missing from the sequence (including corrupt frames).
+	size_t getNumLost() const { return numLost; }
+
+	// Number of times the sequence number went backwards (e.g. the device was reset).
+	size_t getNumResets() const { return numResets; }
+
+	// Number of frames skipped because they repeated the sequence number of the previous frame.
+	size_t getNumDuplicates() const { return numDuplicates; }
+
+	// Number of bytes discarded before the first frame delimiter.
+	size_t getNumDiscarded() const { return numDiscarded; }
+
+  private:
+	const char *data;
+	size_t length;
+	size_t offset;
+
+	uint8_t frame[FRAME_TIMING_MAX_LENGTH];
+	size_t fill;
+	size_t pending; // Number of bytes since the last frame delimiter.
+	bool overflow;
+	bool synced;
+
+	uint32_t lastSequence;
+	bool haveSequence;
+
+	std::vector<TimingRecord> *timing;
+
+	size_t numDecoded;
+	size_t numTiming;
+	size_t numCorrupt;
+	size_t numLost;
+	size_t numResets;
+	size_t numDuplicates;
+	size_t numDiscarded;
+
+	// Decode a complete frame (without the delimiter). Return true if the frame was valid. A repeated
+	// frame is valid, but is not appended to the output columns.
+	bool decodeFrame(PacketColumns &cols_);
+
+	// Decode a complete timing frame (without the delimiter). Return true if the frame was valid.
+	bool decodeTiming();
+};
+
+#endif
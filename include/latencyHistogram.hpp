@@ -0,0 +1,46 @@
+#ifndef LATENCY_HISTOGRAM_HPP
+#define LATENCY_HISTOGRAM_HPP
+
+#include <iostream>
+#include <string>
+
+// Number of power-of-two latency bins.
+#define LATENCY_BINS 32
+
+// Histogram of latencies (in microseconds) using logarithmic bins. Bin i
+// contains latencies in the range [2^(i-1), 2^i) us, with bin 0 holding zero.
+class LatencyHistogram{
+  public:
+	LatencyHistogram(const std::string &units_="us");
+
+	// Add a single latency measurement.
+	void fill(const unsigned long &value_);
+
+	// Reset the histogram.
+	void clear();
+
+	unsigned long getCount() const { return count; }
+
+	unsigned long getMinimum() const { return minimum; }
+
+	unsigned long getMaximum() const { return maximum; }
+
+	double getMean() const { return (count > 0 ? (double)total/count : 0); }
+
+	// Return the upper edge of the bin containing the requested fraction of measurements.
+	unsigned long getQuantile(const double &frac_) const ;
+
+	// Print the non-empty bins along with summary statistics.
+	void print(std::ostream &out_=std::cout, const std::string &prefix_="  ") const ;
+
+  private:
+	std::string units;
+
+	unsigned long bins[LATENCY_BINS];
+	unsigned long count;
+	unsigned long long total;
+	unsigned long minimum;
+	unsigned long maximum;
+};
+
+#endif
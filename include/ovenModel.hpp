@@ -0,0 +1,100 @@
+#ifndef OVEN_MODEL_HPP
+#define OVEN_MODEL_HPP
+
+#include <random>
+
+#include "ovenInterlock.h"
+
+// Default time between readings (ms).
+#define MODEL_PERIOD 1000
+
+// Oven control values used by the model (see oven_controller.ino).
+#define MODEL_MAX_TEMP 89.0 // (C)
+#define MODEL_MIN_TEMP 88.0 // (C)
+#define MODEL_MAX_PRESSURE 2.0017468 // (V)
+#define MODEL_PUMPED_DOWN_PRESSURE 1.8511003 // (V)
+
+// Thermal model of the oven.
+#define MODEL_AMBIENT_TEMP 20.0 // (C)
+#define MODEL_HEAT_RATE 0.2 // Rate of heating while the heater is on (C/s).
+#define MODEL_COOL_TIME 3600.0 // Time constant for cooling towards ambient (s).
+
+// Vacuum model of the oven, in pressure gauge voltage.
+#define MODEL_ATMOSPHERE_PRESSURE 4.5 // (V)
+#define MODEL_BASE_PRESSURE 1.7 // Base pressure of the pump (V).
+#define MODEL_PUMP_TIME 300.0 // Time constant for pumping down (s).
+
+// RMS noise of the thermocouple (C) and pressure gauge (V) readings.
+#define MODEL_TEMP_NOISE 0.1
+#define MODEL_PRESSURE_NOISE 0.002
+
+// Simple model of the oven and its controller, used to generate realistic packet streams.
+// The vacuum pump starts at atmospheric pressure and pumps down exponentially, while the
+// heater is switched by the same interlocks as the firmware, which gives the oven a heater
+// duty cycle around the temperature set point. Readings are quantized like the MAX31855
+// (0.25 C) and the 10-bit ADC of the pressure gauge.
+class OvenModel{
+  public:
+	OvenModel(const unsigned int &seed_=0);
+
+	// Restart the model from ambient temperature and atmospheric pressure.
+	void reset(const unsigned int &seed_=0);
+
+	// Advance the oven by period_ ms and take a new reading.
+	void step(const unsigned int &period_=MODEL_PERIOD);
+
+	unsigned int getTimestamp() const { return timestamp; }
+
+	float getTemperature() const { return temperature; }
+
+	float getPressure() const { return pressure; }
+
+	short getRelay1() const { return relay1; }
+
+	short getRelay2() const { return relay2; }
+
+  private:
+	std::mt19937 generator;
+	std::normal_distribution<double> noise;
+
+	OvenInterlock interlock;
+
+	double ovenTemp; // True temperature of the oven (C).
+	double ovenPressure; // True pressure of the oven (V).
+
+	// The latest reading.
+	unsigned int timestamp;
+	float temperature;
+	float pressure;
+	short relay1;
+	short relay2;
+};
+
+// Byte drops and noise on a serial line or in a stored file.
+class LineNoise{
+  public:
+	LineNoise(const double &drop_=0, const double &noise_=0, const unsigned int &seed_=0);
+
+	bool isEnabled() const { return (drop > 0 || noise > 0); }
+
+	// Apply drops and noise to len_ bytes in place. Return the number of bytes remaining.
+	size_t apply(char *data_, const size_t &len_);
+
+	// Number of bytes dropped.
+	size_t getNumDropped() const { return numDropped; }
+
+	// Number of bytes replaced with random values.
+	size_t getNumCorrupted() const { return numCorrupted; }
+
+  private:
+	double drop;
+	double noise;
+
+	std::mt19937 generator;
+	std::uniform_real_distribution<double> uniform;
+
+	size_t numDropped;
+	size_t numCorrupted;
+};
+
+#endif
@@ -0,0 +1,138 @@
+#ifndef PACKET_CODEC_HPP
+#define PACKET_CODEC_HPP
+
+#include <fstream>
+#include <vector>
+#include <string>
+#include <stdint.h>
+
+#include "packetDecoder.hpp"
+
+// Identifier at the start of every compressed packet file.
+#define CODEC_MAGIC "OVENCMP"
+
+#define CODEC_VERSION 1
+
+// Default number of records per block.
+#define CODEC_BLOCK_SIZE 65536
+
+// Compressed file layout (all values little-endian):
+//  CodecHeader
+//  block 0: CodecBlock, time stream, temperature stream, pressure stream, relay stream
+//  block 1: ...
+// Each stream is padded to an 8 byte boundary. Blocks are written as soon as they are full and
+// each one may be decoded on its own, so a file which is still being written (or was cut short)
+// can be read up to its last complete block.
+//
+// Streams:
+//  time        | Bit stream. The first timestamp (32 bits), then the delta-of-delta of every
+//              | timestamp (zigzag encoded): '0' for zero, '10'+7 bits, '110'+9 bits, '1110'+12 bits
+//              | or '1111'+32 bits. Deltas wrap with the 32 bit millis() counter.
+//  temperature | Bit stream. The first value (32 bits), then each value XOR the previous value:
+//  pressure    | '0' if identical, '10'+bits if the meaningful bits fit within the previous window,
+//              | or '11'+leading zeros (5 bits)+length-1 (5 bits)+bits. Values are stored exactly,
+//              | and the pressure is the raw gauge voltage.
+//  relays      | Byte stream of runs: relay1 (2 bytes), relay2 (2 bytes), run length (varint).
+
+struct CodecHeader{
+	char magic[8];
+	uint32_t version;
+	uint32_t blockSize;
+	char title[64];
+};
+
+struct CodecBlock{
+	uint32_t numRecords;
+	uint32_t timeLength; // Length of each stream, before padding (bytes).
+	uint32_t tempLength;
+	uint32_t presLength;
+	uint32_t relayLength;
+	uint32_t reserved;
+};
+
+// Streaming encoder for compressed packet files.
+class CodecWriter{
+  public:
+	CodecWriter(const size_t &blockSize_=CODEC_BLOCK_SIZE);
+
+	~CodecWriter();
+
+	// Create a new compressed file. Return true if the file was opened successfully.
+	bool open(const std::string &fname_, const char *title_=NULL);
+
+	// Open an existing compressed file to add more records. An incomplete last block is decoded and
+	// written again with the new records. Return false if the file is not a valid compressed file.
+	bool append(const std::string &fname_);
+
+	bool isOpen() const { return file.is_open(); }
+
+	// Add a single record. The pressure is the raw gauge voltage.
+	void add(const unsigned int &timestamp_, const float &temperature_, const float &pressure_, const short &relay1_, const short &relay2_);
+
+	// Write any remaining records and close the file.
+	void close();
+
+	size_t getNumRecords() const { return numRecords+block.size(); }
+
+	// Number of bytes written to the file so far.
+	size_t getNumBytes() const { return numBytes; }
+
+	// Encode a block of records and append it to out_. Return the number of bytes added.
+	static size_t encodeBlock(const PacketColumns &cols_, const size_t &start_, const size_t &N_, std::vector<char> &out_);
+
+  private:
+	std::ofstream file;
+
+	PacketColumns block;
+
+	std::vector<char> buffer;
+
+	size_t blockSize;
+	size_t numRecords;
+	size_t numBytes;
+
+	// Encode and write the current block.
+	void flush();
+};
+
+// Decoder for compressed packet files held in memory (e.g. a MappedFile).
+class CodecReader{
+  public:
+	CodecReader();
+
+	// Check the file header and set the input buffer. Return false if it is not a compressed file.
+	bool setInput(const char *data_, const size_t &len_);
+
+	// Return true if len_ bytes starting at data_ begin with a compressed file header.
+	static bool isCompressed(const char *data_, const size_t &len_);
+
+	const char *getTitle() const { return title; }
+
+	// Return true if there is no more data to decode.
+	bool eof() const { return (offset+sizeof(CodecBlock) > length); }
+
+	size_t getOffset() const { return offset; }
+
+	// Decode the next block and append its records to the output columns. Return the number of
+	// records decoded, which is only zero at the end of the input or at a truncated or corrupt block.
+	// Nothing after a corrupt block is decoded.
+	size_t decode(PacketColumns &cols_);
+
+	// Decode the block starting at data_ and append its records to the output columns. Return the
+	// total length of the block (bytes), or zero if the block is incomplete or corrupt.
+	static size_t decodeBlock(const char *data_, const size_t &len_, PacketColumns &cols_);
+
+	// Total number of records decoded.
+	size_t getNumDecoded() const { return numDecoded; }
+
+  private:
+	const char *data;
+	size_t length;
+	size_t offset;
+
+	size_t numDecoded;
+
+	char title[64];
+};
+
+#endif
@@ -0,0 +1,204 @@
+#ifndef PACKET_DECODER_HPP
+#define PACKET_DECODER_HPP
+
+#include <vector>
+#include <string>
+#include <string.h>
+
+// The delimiter between data packets.
+#define PACKET_DELIMITER 0xFFFFFFFF
+
+// Length of a single data packet (bytes).
+// delimiter(4) + timestamp(4) + temperature(4) + pressure(4) + relay1(2) + relay2(2)
+#define PACKET_LENGTH 20
+
+// Default number of packets to decode per block.
+#define PACKET_BLOCK_SIZE 4096
+
+// Maximum forward jump in time between consecutive packets in resync mode (ms).
+#define RESYNC_MAX_GAP 3600000
+
+// Limits on the values of a plausible packet in resync mode.
+#define RESYNC_MIN_TEMP -100.0
+#define RESYNC_MAX_TEMP 2000.0
+#define RESYNC_MIN_VOLTAGE -0.5
+#define RESYNC_MAX_VOLTAGE 5.5
+
+// Unpack the fields of a single packet. ptr_ points to the packet delimiter.
+inline void unpackPacket(const char *ptr_, unsigned int &timestamp_, float &temperature_, float &pressure_, short &relay1_, short &relay2_){
+	memcpy((char*)&timestamp_, &ptr_[4], 4);
+	memcpy((char*)&temperature_, &ptr_[8], 4);
+	memcpy((char*)&pressure_, &ptr_[12], 4);
+	memcpy((char*)&relay1_, &ptr_[16], 2);
+	memcpy((char*)&relay2_, &ptr_[18], 2);
+}
+
+// Pack the fields of a single packet, including the delimiter, into PACKET_LENGTH bytes.
+inline void packPacket(char *ptr_, const unsigned int &timestamp_, const float &temperature_, const float &pressure_, const short &relay1_, const short &relay2_){
+	const unsigned int delimiter = PACKET_DELIMITER;
+	memcpy(&ptr_[0], (const char*)&delimiter, 4);
+	memcpy(&ptr_[4], (const char*)&timestamp_, 4);
+	memcpy(&ptr_[8], (const char*)&temperature_, 4);
+	memcpy(&ptr_[12], (const char*)&pressure_, 4);
+	memcpy(&ptr_[16], (const char*)&relay1_, 2);
+	memcpy(&ptr_[18], (const char*)&relay2_, 2);
+}
+
+// Read the title from the start of a file buffer. The title is truncated to len_-1
+// characters. Return the offset of the first byte after the title.
+size_t readTitle(const char *data_, const size_t &size_, char *buf_, const char &len_);
+
+// A region of the input which was skipped while searching for a packet.
+struct SkippedRegion{
+	size_t offset;
+	size_t length;
+};
+
+// Structure-of-arrays storage for decoded data packets.
+class PacketColumns{
+  public:
+	std::vector<unsigned int> timestamp;
+	std::vector<float> temperature;
+	std::vector<float> pressure;
+	std::vector<short> relay1;
+	std::vector<short> relay2;
+
+	PacketColumns(){ }
+
+	size_t size() const { return timestamp.size(); }
+
+	// Resize all columns to N_ entries.
+	void resize(const size_t &N_);
+
+	// Reserve space for N_ entries in all columns.
+	void reserve(const size_t &N_);
+
+	// Clear all columns.
+	void clear();
+};
+
+// Read-only view of an entire input file. The file is memory mapped
+// if possible, otherwise it is read into memory using large buffered reads.
+class MappedFile{
+  public:
+	MappedFile();
+
+	~MappedFile();
+
+	// Open a file. Return true if the file was opened successfully.
+	bool open(const std::string &fname_);
+
+	// Release the file.
+	void close();
+
+	bool isOpen() const { return opened; }
+
+	bool isMapped() const { return mapped; }
+
+	const char *getData() const { return data; }
+
+	size_t getSize() const { return length; }
+
+  private:
+	const char *data;
+	size_t length;
+	bool opened;
+	bool mapped;
+	std::vector<char> buffer;
+};
+
+// Batch decoder for blocks of packed 20 byte data packets. Packets are
+// located using the same rules as the original sequential reader, i.e. the
+// input is scanned in 4 byte steps for the packet delimiter and the 16 bytes
+// following a delimiter are taken as a packet.
+class BatchDecoder{
+  public:
+	BatchDecoder();
+
+	// Set the input buffer and the offset of the first packet delimiter.
+	BatchDecoder(const char *data_, const size_t &len_, const size_t &offset_=0);
+
+	void setInput(const char *data_, const size_t &len_, const size_t &offset_=0);
+
+	// Use the scalar decoder even when the SIMD kernel is available.
+	void setScalar(const bool &state_=true){ scalar = state_; }
+
+	bool getScalar() const { return scalar; }
+
+	// Search for packets at byte granularity instead of in 4 byte steps when the input is
+	// misaligned, and only accept packets with plausible values. Every packet is checked, so the
+	// SIMD kernel is not used in resync mode.
+	void setResync(const bool &state_=true){ resync = state_; }
+
+	bool getResync() const { return resync; }
+
+	// Return true if the SIMD kernel was compiled in.
+	static bool haveSIMD();
+
+	// Return true if there is no more data to decode.
+	bool eof() const { return (offset+4 > length); }
+
+	size_t getOffset() const { return offset; }
+
+	// Return the offset at which to resume decoding once more data has been appended to the input,
+	// i.e. the start of an incomplete packet at the end of the input, or the current offset.
+	size_t getResumeOffset() const { return (tail < offset ? tail : offset); }
+
+	// Total number of packets decoded.
+	size_t getNumDecoded() const { return numDecoded; }
+
+	// Total number of 4 byte words skipped while searching for a delimiter.
+	size_t getNumSkipped() const { return numSkipped; }
+
+	// Total number of bytes skipped in resync mode.
+	size_t getNumSkippedBytes() const { return numSkippedBytes; }
+
+	// Regions of the input skipped in resync mode.
+	const std::vector<SkippedRegion> &getSkippedRegions() const { return skipped; }
+
+	// Decode up to N_ packets and append them to the output columns.
+	// Return the number of packets decoded.
+	size_t decode(PacketColumns &cols_, const size_t &N_=PACKET_BLOCK_SIZE);
+
+  private:
+	const char *data;
+	size_t length;
+	size_t offset;
+	size_t tail; // Offset of the incomplete data at the end of the input.
+
+	size_t numDecoded;
+	size_t numSkipped;
+	size_t numSkippedBytes;
+
+	bool scalar;
+	bool resync;
+
+	unsigned int lastTime; // Timestamp of the last decoded packet.
+	bool haveTime;
+
+	std::vector<SkippedRegion> skipped;
+
+	// Decode packets one at a time starting at the current offset.
+	size_t decodeScalar(PacketColumns &cols_, const size_t &start_, const size_t &N_);
+
+	// Decode packets one at a time starting at the current offset, searching for the next
+	// plausible packet at byte granularity whenever the current offset is not a packet.
+	size_t decodeResync(PacketColumns &cols_, const size_t &start_, const size_t &N_);
+
+	// Return true if the packet at offset_ begins with a delimiter and has plausible values.
+	bool isPlausible(const size_t &offset_, unsigned int &timestamp_) const ;
+
+	// Return true if the packet at offset_ is plausible and its timestamp follows the last decoded
+	// packet. A packet with an unexpected timestamp is still accepted if the following packet is
+	// plausible and follows it in time.
+	bool isAcceptable(const size_t &offset_) const ;
+
+	// Return the offset of the next delimiter at or after offset_, or the length of the input.
+	size_t findDelimiter(const size_t &offset_) const ;
+
+	// Decode N_ packets with a stride of 20 bytes starting at the current offset.
+	// Return false if any of the packets does not begin with a delimiter.
+	bool decodeBlock(PacketColumns &cols_, const size_t &start_, const size_t &N_);
+};
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef PACKET_FORMAT_HPP
+#define PACKET_FORMAT_HPP
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// Voltage divider ratio between the pressure gauge and the arduino.
+#define RPRIME 0.5004367
+
+// Default size of the csv output buffer (bytes).
+#define CSV_BUFFER_SIZE 65536
+
+// Maximum length of a single csv row (bytes).
+#define CSV_MAX_ROW_LENGTH 256
+
+// Convert a pressure gauge voltage (as read by the arduino) to a pressure (Torr).
+float calibratePressure(const float &voltage_);
+
+// Return the order of magnitude of a number
+float getOrder(const float &input_, int &power);
+
+// Write a scientific notation representation of an input number to a buffer
+// which must be at least 32 bytes long. Return a pointer to the end of the output.
+char *sciNotation(char *buf_, const float &input_, const size_t &N_=2);
+
+// Return a scientific notation representation of an input number.
+std::string sciNotation(const float &input_, const size_t &N_=2);
+
+// Write a float to a buffer, identical to the default formatting of std::ostream.
+// The buffer must be at least 32 bytes long. Return a pointer to the end of the output.
+char *formatFloat(char *buf_, const float &input_);
+
+// Buffered writer for csv data rows. Values are formatted directly into a
+// reusable buffer so that no memory is allocated for each row.
+class CsvWriter{
+  public:
+	CsvWriter(std::ostream *out_=NULL, const size_t &size_=CSV_BUFFER_SIZE);
+
+	~CsvWriter();
+
+	void setOutput(std::ostream *out_);
+
+	// Add a data packet to the current row in the format "time(ms),T(C),P(Torr),R1,R2".
+	// The pressure is given in Torr.
+	void addPacket(const unsigned int &timestamp_, const float &temperature_, const float &pressure_, const short &relay1_, const short &relay2_);
+
+	// Add a data packet with a 64 bit time (e.g. a merged time which does not wrap).
+	void addPacket(const uint64_t &timestamp_, const float &temperature_, const float &pressure_, const short &relay1_, const short &relay2_);
+
+	// Add a comma followed by an integer value to the current row.
+	void addField(const long long &value_);
+
+	// Add a comma followed by a float value to the current row.
+	void addField(const float &value_);
+
+	// Add raw text to the current row.
+	void addText(const char *str_, const size_t &len_);
+
+	// Terminate the current row.
+	void endRow();
+
+	// Write all buffered rows to the output stream.
+	void flush();
+
+  private:
+	std::ostream *out;
+
+	std::vector<char> buffer;
+
+	size_t used;
+
+	// Flush the buffer if there is not enough space left for a row.
+	void reserve(const size_t &len_=CSV_MAX_ROW_LENGTH);
+};
+
+#endif
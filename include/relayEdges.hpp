@@ -0,0 +1,140 @@
+#ifndef RELAY_EDGES_HPP
+#define RELAY_EDGES_HPP
+
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+// Tracks the state of a relay over consecutive blocks of relay samples. The relay
+// turns on when a sample equals 1 while it is off, and turns off when a sample
+// equals 0 while it is on. All other values leave the state unchanged.
+class RelayTracker{
+  public:
+	RelayTracker();
+
+	// Use the scalar search even when the SIMD kernel is available.
+	void setScalar(const bool &state_=true){ scalar = state_; }
+
+	// Return true if the relay is currently on.
+	bool getState() const { return state; }
+
+	// Return true if the SSE2 kernel was compiled in.
+	static bool haveSIMD();
+
+	// Reset the tracker to its initial (off) state.
+	void reset();
+
+	// Return the last sample processed.
+	short getLast() const { return prev; }
+
+	// Continue tracking from a saved state and last sample.
+	void restore(const bool &state_, const short &last_);
+
+	// Process the next N_ samples. The indices (relative to relay_) at which the relay
+	// turns on and off are appended to on_ and off_.
+	void process(const short *relay_, const size_t &N_, std::vector<size_t> &on_, std::vector<size_t> &off_);
+
+  private:
+	bool state;
+	bool first;
+	bool scalar;
+
+	short prev;
+
+	// Apply a single sample to the relay state.
+	void update(const short &value_, const size_t &index_, std::vector<size_t> &on_, std::vector<size_t> &off_){
+		if(!state && value_ == 1){
+			on_.push_back(index_);
+			state = true;
+		}
+		else if(state && value_ == 0){
+			off_.push_back(index_);
+			state = false;
+		}
+	}
+};
+
+// Saved state of a RelayIntervals, used to continue over a growing input in a later run.
+struct RelayState{
+	double firstTime;
+	double lastTime;
+	double onTime; // Total time of the completed intervals.
+	double openTime; // Time at which the relay turned on, if it is still on.
+	uint64_t numSamples;
+	uint64_t numIntervals; // Number of times the relay turned on.
+	int16_t last; // Last sample.
+	uint8_t on;
+	uint8_t reserved[5];
+};
+
+// On/off intervals and duty cycle of a single relay.
+class RelayIntervals{
+  public:
+	std::vector<double> open; // Times at which the relay turned on.
+	std::vector<double> close; // Times at which the relay turned off.
+
+	RelayIntervals() : firstTime(0), lastTime(0), onTime(0), numSamples(0), numPrevious(0) { }
+
+	void setScalar(const bool &state_=true){ tracker.setScalar(state_); }
+
+	// Add the next N_ relay samples and their times.
+	template <typename T>
+	void add(const short *relay_, const T *time_, const size_t &N_){
+		if(N_ == 0){ return; }
+		if(numSamples == 0){ firstTime = time_[0]; }
+		lastTime = time_[N_-1];
+		numSamples += N_;
+
+		on.clear();
+		off.clear();
+		tracker.process(relay_, N_, on, off);
+
+		// The relay always turns off after it turns on, so each close matches the open with the same index.
+		for(size_t i = 0; i < on.size(); i++){ open.push_back(time_[on[i]]); }
+		for(size_t i = 0; i < off.size(); i++){
+			close.push_back(time_[off[i]]);
+			onTime += close.back()-open[close.size()-1];
+		}
+	}
+
+	// Return true if the relay was still on after the last sample.
+	bool isOn() const { return tracker.getState(); }
+
+	// Return the total time the relay was on (up to the last sample).
+	double getOnTime() const { return onTime+(isOn() ? lastTime-open.back() : 0); }
+
+	// Return the time between the first and last samples.
+	double getTotalTime() const { return lastTime-firstTime; }
+
+	// Return the fraction of the time the relay was on.
+	double getDutyCycle() const { return (getTotalTime() > 0 ? getOnTime()/getTotalTime() : 0); }
+
+	size_t getNumSamples() const { return numSamples; }
+
+	// Return the total number of intervals, including those before the state was restored.
+	size_t getNumIntervals() const { return numPrevious+open.size(); }
+
+	void clear();
+
+	// Save the current state.
+	void save(RelayState &state_) const ;
+
+	// Clear the intervals and continue from a saved state. If the relay is still on, the time at
+	// which it turned on is the only entry of open.
+	void restore(const RelayState &state_);
+
+  private:
+	RelayTracker tracker;
+
+	std::vector<size_t> on;
+	std::vector<size_t> off;
+
+	double firstTime;
+	double lastTime;
+	double onTime;
+
+	size_t numSamples;
+	size_t numPrevious; // Number of intervals before the state was restored.
+};
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef SERIAL_BUFFER_HPP
+#define SERIAL_BUFFER_HPP
+
+#include <vector>
+#include <sys/types.h>
+
+// Default capacity of the serial receive buffer (bytes).
+#define SERIAL_BUFFER_SIZE 4096
+
+// Fixed capacity receive buffer for binary serial data. Unread bytes are always
+// stored contiguously so that packets may be decoded directly from the buffer.
+class SerialBuffer{
+  public:
+	SerialBuffer(const size_t &capacity_=SERIAL_BUFFER_SIZE);
+
+	// Return the number of unread bytes in the buffer.
+	size_t size() const { return (tail-head); }
+
+	size_t capacity() const { return buffer.size(); }
+
+	bool empty() const { return (head == tail); }
+
+	// Return a pointer to the first unread byte.
+	const char *data() const { return &buffer[head]; }
+
+	// Total number of bytes discarded while searching for a packet delimiter.
+	size_t getNumDiscarded() const { return numDiscarded; }
+
+	// Read as many bytes as will fit into the buffer with a single call to read().
+	// Return the number of bytes read or -1 on error.
+	ssize_t fill(const int &fd_);
+
+	// Append len_ bytes to the buffer. Return the number of bytes copied.
+	size_t append(const char *data_, const size_t &len_);
+
+	// Search for the next complete packet. Return a pointer to the packet delimiter
+	// and remove the packet from the buffer, or return NULL if no packet is ready.
+	// The returned pointer is valid until the next call to fill() or append().
+	const char *nextPacket();
+
+	// Discard all unread bytes.
+	void clear();
+
+  private:
+	std::vector<char> buffer;
+
+	size_t head;
+	size_t tail;
+
+	size_t numDiscarded;
+
+	// Move unread bytes to the front of the buffer.
+	void compact();
+};
+
+#endif
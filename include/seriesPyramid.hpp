@@ -0,0 +1,67 @@
+#ifndef SERIES_PYRAMID_HPP
+#define SERIES_PYRAMID_HPP
+
+#include <vector>
+#include <cstddef>
+
+// Default number of samples in each bucket of the finest pyramid level.
+#define PYRAMID_BASE_SIZE 4
+
+// Minimum and maximum of a range of consecutive samples.
+struct PyramidBucket{
+	double xLow; // x of the first sample in the bucket.
+	double xHigh; // x of the last sample in the bucket.
+	double xMin; // x of the minimum sample.
+	double yMin;
+	double xMax; // x of the maximum sample.
+	double yMax;
+	size_t count; // Number of non-NaN samples.
+};
+
+// Multi-resolution min/max pyramid over a series sorted by x. Each level merges pairs of
+// buckets from the level below it, so a plot of any width may be drawn from the level
+// with about one bucket per output pixel while still showing every peak.
+class MinMaxPyramid{
+  public:
+	MinMaxPyramid(const size_t &baseSize_=PYRAMID_BASE_SIZE);
+
+	// Build the pyramid for a series. The series is not copied.
+	void build(const double *x_, const double *y_, const size_t &N_);
+
+	void clear();
+
+	size_t getNumSamples() const { return numSamples; }
+
+	size_t getNumLevels() const { return levels.size(); }
+
+	const std::vector<PyramidBucket> &getLevel(const size_t &level_) const { return levels[level_]; }
+
+	// Return the finest level with at most width_ buckets between xLow_ and xHigh_ (the coarsest level
+	// if none has so few), or -1 if the raw series should be used instead.
+	int getBestLevel(const size_t &width_, const double &xLow_, const double &xHigh_) const ;
+
+	// Fill x_ and y_ with at most 2*width_ points between xLow_ and xHigh_ which trace the envelope of
+	// the series. Return the number of points.
+	size_t sample(std::vector<double> &x_, std::vector<double> &y_, const size_t &width_, const double &xLow_, const double &xHigh_) const ;
+
+	// Sample the entire series.
+	size_t sample(std::vector<double> &x_, std::vector<double> &y_, const size_t &width_) const ;
+
+  private:
+	size_t baseSize;
+	size_t numSamples;
+
+	const double *xdata;
+	const double *ydata;
+
+	std::vector<std::vector<PyramidBucket> > levels;
+
+	// Return the number of buckets in a level which overlap with [xLow_, xHigh_] and set first_ to the first.
+	size_t findRange(const std::vector<PyramidBucket> &level_, const double &xLow_, const double &xHigh_, size_t &first_) const ;
+};
+
+// Merge intervals which are separated by less than minGap_ (e.g. the width of one output pixel).
+// Open intervals without a matching close are dropped. Return the number of merged intervals.
+size_t mergeIntervals(const std::vector<double> &open_, const std::vector<double> &close_, const double &minGap_, std::vector<double> &mergedOpen_, std::vector<double> &mergedClose_);
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef STAGE_TIMING_HPP
+#define STAGE_TIMING_HPP
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "frameDecoder.hpp"
+#include "latencyHistogram.hpp"
+
+// Return the name of a stage of the firmware control loop (see packetFrame.h).
+const char *getTimingStageName(const unsigned int &stage_);
+
+// Latency histograms of the stages of the firmware control loop, filled from the timing frames
+// sent by an oven controller built with USE_TIMING_TELEMETRY. Each timing frame adds the longest
+// time spent in each stage since the previous frame, so the histograms show the worst case of
+// every interval between packets rather than every call.
+class StageTiming{
+  public:
+	StageTiming();
+
+	// Add the stage times of a single timing frame.
+	void add(const TimingRecord &record_);
+
+	// Add the stage times of several timing frames.
+	void add(const std::vector<TimingRecord> &records_);
+
+	// Reset all histograms.
+	void clear();
+
+	size_t getNumRecords() const { return numRecords; }
+
+	const LatencyHistogram &getHistogram(const unsigned int &stage_) const { return stages[stage_]; }
+
+	// Print the histogram of each stage.
+	void print(std::ostream &out_=std::cout, const std::string &prefix_="  ") const ;
+
+  private:
+	LatencyHistogram stages[FRAME_TIMING_STAGES];
+
+	size_t numRecords;
+};
+
+#endif
@@ -0,0 +1,154 @@
+#ifndef TELEMETRY_RING_HPP
+#define TELEMETRY_RING_HPP
+
+#include <atomic>
+#include <string>
+#include <stdint.h>
+#include <sys/types.h>
+
+// Identifier at the start of every telemetry ring.
+#define TELEMETRY_MAGIC "OVENSHM"
+
+#define TELEMETRY_VERSION 1
+
+// Default name of the shared memory object.
+#define TELEMETRY_DEFAULT_NAME "/ovenTelemetry"
+
+// Default number of samples kept in the ring (must be a power of two).
+#define TELEMETRY_DEFAULT_CAPACITY 65536
+
+// A single decoded packet, as published to the ring.
+struct TelemetrySample{
+	uint64_t hostTime; // Host arrival time (ms since epoch).
+	uint32_t timestamp; // Oven controller time (ms).
+	float temperature; // (C)
+	float pressure; // (Torr)
+	int16_t relay1;
+	int16_t relay2;
+};
+
+// Shared memory layout:
+//  TelemetryHeader (one cache line for the constant fields, one for the write index)
+//  TelemetrySlot[capacity]
+// Sample n is written to slot n&(capacity-1). Each slot carries a sequence number which is odd
+// while the writer is modifying it and 2n+2 once sample n is complete, so that a reader can detect
+// a slot which was overwritten while it was being copied (a per slot seqlock). The writer never
+// waits on the readers, and readers which fall more than capacity samples behind lose the oldest
+// samples instead.
+
+struct TelemetryHeader{
+	char magic[8];
+	uint32_t version;
+	uint32_t capacity;
+	uint32_t sampleSize;
+	int32_t writerPid;
+	std::atomic<uint32_t> closed; // Set by the writer when it stops publishing.
+	uint32_t reserved;
+	char title[32];
+
+	alignas(64) std::atomic<uint64_t> writeIndex; // Number of samples published.
+};
+
+struct TelemetrySlot{
+	std::atomic<uint64_t> sequence;
+	std::atomic<uint64_t> words[3]; // The sample, copied word by word.
+};
+
+static_assert(sizeof(TelemetrySample) == sizeof(TelemetrySlot::words), "TelemetrySample must fill the slot");
+
+// Single writer for a telemetry ring. Publishing a sample is a few stores to shared memory, with
+// no system calls or locks.
+class TelemetryWriter{
+  public:
+	TelemetryWriter();
+
+	~TelemetryWriter();
+
+	// Create (or replace) a named ring with room for capacity_ samples, rounded up to a power of two.
+	// Return true if the ring was created successfully.
+	bool open(const std::string &name_, const uint32_t &capacity_=TELEMETRY_DEFAULT_CAPACITY, const char *title_=NULL);
+
+	bool isOpen() const { return (header != NULL); }
+
+	// Publish a single sample to all readers.
+	void publish(const TelemetrySample &sample_);
+
+	// Publish a single packet. The pressure is given in Torr.
+	void publish(const uint64_t &hostTime_, const unsigned int &timestamp_, const float &temperature_, const float &pressure_, const short &relay1_, const short &relay2_);
+
+	// Mark the ring as closed and remove its name. Readers which already have it open may still
+	// read any remaining samples.
+	void close();
+
+	uint64_t getNumPublished() const { return writeIndex; }
+
+	const std::string &getName() const { return name; }
+
+  private:
+	std::string name;
+
+	TelemetryHeader *header;
+	TelemetrySlot *slots;
+
+	size_t mappedSize;
+
+	uint64_t writeIndex;
+	uint64_t mask;
+};
+
+enum TelemetryStatus {TELEMETRY_NONE, TELEMETRY_SAMPLE, TELEMETRY_CLOSED};
+
+// One of any number of readers of a telemetry ring. Samples are read directly from the mapped
+// ring, with no system calls.
+class TelemetryReader{
+  public:
+	TelemetryReader();
+
+	~TelemetryReader();
+
+	// Open a named ring for reading. If fromStart_ is set, start with the oldest sample still in the
+	// ring, otherwise only read samples published after opening. Return true if the ring was opened.
+	bool open(const std::string &name_, const bool &fromStart_=false);
+
+	bool isOpen() const { return (header != NULL); }
+
+	// Read the next sample. Return TELEMETRY_SAMPLE if a sample was read, TELEMETRY_NONE if no
+	// new sample is available yet, and TELEMETRY_CLOSED if the writer closed the ring and all
+	// samples have been read.
+	TelemetryStatus read(TelemetrySample &sample_);
+
+	// Number of samples published but not yet read (including any which will be lost).
+	uint64_t getNumAvailable() const;
+
+	// Number of samples which were overwritten before they could be read.
+	uint64_t getNumLost() const { return numLost; }
+
+	// Number of samples read.
+	uint64_t getNumRead() const { return numRead; }
+
+	// Return true if the process which created the ring is still running.
+	bool isWriterAlive() const;
+
+	const char *getTitle() const { return (header ? header->title : ""); }
+
+	uint32_t getCapacity() const { return (header ? header->capacity : 0); }
+
+	void close();
+
+  private:
+	TelemetryHeader *header;
+	TelemetrySlot *slots;
+
+	size_t mappedSize;
+
+	uint64_t readIndex;
+	uint64_t mask;
+
+	uint64_t numLost;
+	uint64_t numRead;
+};
+
+// Return the shared memory name for a ring, adding the leading '/' if it is missing.
+std::string getTelemetryName(const std::string &name_);
+
+#endif
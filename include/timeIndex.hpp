@@ -0,0 +1,77 @@
+#ifndef TIME_INDEX_HPP
+#define TIME_INDEX_HPP
+
+#include <vector>
+#include <string>
+#include <stdint.h>
+
+// Identifier at the start of every time index file.
+#define TIME_INDEX_MAGIC "OVENIDX"
+
+#define TIME_INDEX_VERSION 1
+
+// Default number of packets between index entries.
+#define TIME_INDEX_STRIDE 1024
+
+// Time index file layout (all values little-endian):
+//  TimeIndexHeader
+//  TimeIndexEntry[numEntries]
+// The index is a sidecar to a DAT file and is only valid while the size and modification
+// time of the DAT file match the values in the header.
+
+struct TimeIndexHeader{
+	char magic[8];
+	uint32_t version;
+	uint32_t stride;
+	uint64_t fileSize; // Size of the indexed DAT file.
+	int64_t fileTime; // Modification time of the indexed DAT file.
+	uint64_t dataOffset; // Offset of the first byte after the title.
+	uint64_t numRecords;
+	uint32_t numEntries;
+	uint32_t monotonic; // Non-zero if the timestamps never decrease (ignoring the first record).
+};
+
+struct TimeIndexEntry{
+	uint64_t offset; // Decoder offset at the start of a block of packets.
+	uint32_t timestamp; // Timestamp of the first packet in the block (ms).
+	uint32_t reserved;
+};
+
+// Sparse map from packet timestamps to byte offsets within a DAT file. Each entry records the
+// decoder offset at the start of a block of packets, so decoding may resume from any entry and
+// produce exactly the same packets as decoding the whole file from the start.
+class TimeIndex{
+  public:
+	TimeIndex(const size_t &stride_=TIME_INDEX_STRIDE);
+
+	// Build the index for a DAT file buffer. offset_ is the offset of the first byte after the title.
+	void build(const char *data_, const size_t &size_, const size_t &offset_);
+
+	// Load the sidecar index of a DAT file. Return false if the index is missing or out of date.
+	bool load(const std::string &fname_, const std::string &datname_);
+
+	// Write the index to a sidecar file. Return true if the file was written successfully.
+	bool save(const std::string &fname_, const std::string &datname_);
+
+	// Return the offset at which to start decoding to find the first packet with a timestamp of
+	// at least time_ (ms). The offset after the title is returned if the file may not be searched.
+	size_t find(const unsigned int &time_) const ;
+
+	size_t getDataOffset() const { return header.dataOffset; }
+
+	size_t getNumEntries() const { return entries.size(); }
+
+	size_t getNumRecords() const { return header.numRecords; }
+
+	bool isMonotonic() const { return (header.monotonic != 0); }
+
+	// Return the default sidecar filename for a DAT file.
+	static std::string getSidecarName(const std::string &datname_){ return datname_+".idx"; }
+
+  private:
+	TimeIndexHeader header;
+
+	std::vector<TimeIndexEntry> entries;
+};
+
+#endif
@@ -0,0 +1,163 @@
+#ifndef WINDOW_STATS_HPP
+#define WINDOW_STATS_HPP
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <stdint.h>
+
+// Default window length (s).
+#define STATS_WINDOW 3600
+
+// Default temperature limit (C), the same as OVEN_MAX_TEMP in oven_controller.ino.
+#define STATS_MAX_TEMP 89.0
+
+// Maximum time between packets which is counted towards the duty cycles (ms). Longer gaps are
+// treated as missing data.
+#define STATS_MAX_GAP 10000
+
+// Count, minimum, maximum, mean and variance of a stream of values, using Welford's online
+// algorithm. Summaries of separate streams are combined with the pairwise update of Chan et al.,
+// so that the variance stays accurate for long runs at a constant temperature.
+class RunningStats{
+  public:
+	RunningStats(){ clear(); }
+
+	void clear();
+
+	// Add a single value. NaN and infinite values (e.g. corrupt packets) are ignored.
+	void add(const double &value_){
+		if(!std::isfinite(value_)){ return; }
+		count++;
+		const double delta = value_-mean;
+		mean += delta/count;
+		m2 += delta*(value_-mean);
+		if(value_ < min){ min = value_; }
+		if(value_ > max){ max = value_; }
+	}
+
+	// Add the values of another summary.
+	void merge(const RunningStats &other_);
+
+	uint64_t getCount() const { return count; }
+
+	// The minimum, maximum and mean are NaN if there are no values.
+	double getMin() const ;
+
+	double getMax() const ;
+
+	double getMean() const ;
+
+	// Return the sample variance.
+	double getVariance() const { return (count > 1 ? m2/(count-1) : 0); }
+
+	double getStdDev() const ;
+
+  private:
+	uint64_t count;
+	double mean;
+	double m2; // Sum of the squared differences from the mean.
+	double min;
+	double max;
+};
+
+// Statistics of the packets within a range of time. Times are in ms.
+struct WindowSummary{
+	uint64_t start;
+	uint64_t end;
+
+	RunningStats temperature;
+	RunningStats pressure;
+
+	uint64_t duration; // Time covered by the packets, excluding gaps longer than STATS_MAX_GAP.
+	uint64_t relay1On; // Time with relay 1 on.
+	uint64_t relay2On; // Time with relay 2 on.
+	uint64_t overTemp; // Time above the maximum temperature.
+
+	WindowSummary(){ clear(); }
+
+	void clear();
+
+	// Add the packets of another summary.
+	void merge(const WindowSummary &other_);
+
+	double getDutyCycle1() const { return (duration > 0 ? (double)relay1On/duration : 0); }
+
+	double getDutyCycle2() const { return (duration > 0 ? (double)relay2On/duration : 0); }
+};
+
+// Single pass tumbling or sliding window statistics of temperature, pressure, relay duty cycles and
+// time above the maximum temperature. Time is split into panes of one slide length, and each window
+// is the combination of the last window/slide panes, so memory does not depend on the length of the
+// run or the packet rate. A window is written to the output table as soon as its last pane ends.
+//
+// The time between two packets is assigned to the state of the first packet. Windows are aligned to
+// multiples of the slide length, and the panes are cleared when the time goes backwards (e.g. the
+// controller was reset).
+class WindowStats{
+  public:
+	WindowStats();
+
+	// Set the window length and the time between windows (s). The slide is the window length for
+	// tumbling windows, and the window must be a multiple of the slide. Return false if the lengths
+	// are invalid.
+	bool setWindow(const double &window_, const double &slide_=0);
+
+	void setMaxTemp(const double &maxTemp_){ maxTemp = maxTemp_; }
+
+	// Write each window to an output table (may be NULL). The column names are written first.
+	void setOutput(std::ostream *output_);
+
+	// Add a single packet with a calibrated pressure (Torr).
+	void add(const uint64_t &time_, const float &temperature_, const float &pressure_, const short &relay1_, const short &relay2_);
+
+	// Write the window ending with the current (incomplete) pane, i.e. at the end of the run.
+	void flush();
+
+	// Return the statistics of the entire run.
+	const WindowSummary &getTotal() const { return total; }
+
+	size_t getNumWindows() const { return numWindows; }
+
+	size_t getNumPackets() const { return numPackets; }
+
+	double getMaxTemp() const { return maxTemp; }
+
+	// Print the statistics of the entire run.
+	void print(std::ostream &out_=std::cout, const std::string &prefix_="  ") const ;
+
+	// Write a single window to an output table.
+	static void write(std::ostream &output_, const WindowSummary &window_);
+
+	// Write the names of the columns of an output table.
+	static void writeHeader(std::ostream &output_);
+
+  private:
+	uint64_t slideLength; // ms
+	size_t numPanes; // Number of panes in each window.
+
+	double maxTemp;
+
+	std::vector<WindowSummary> panes; // Ring of the last numPanes panes.
+	WindowSummary total;
+	size_t numPackets;
+
+	uint64_t currentPane; // Index of the pane containing the last packet.
+	uint64_t lastTime;
+	short lastRelay1;
+	short lastRelay2;
+	bool lastOver;
+	bool haveLast;
+
+	std::ostream *output;
+	size_t numWindows;
+
+	// Combine the panes of the window ending with pane_ and write it.
+	void emit(const uint64_t &pane_);
+
+	// Clear all panes.
+	void reset();
+};
+
+#endif
@@ -25,6 +25,8 @@ extern "C" {
 #endif
 
 extern int   serialOpen      (const char *device, const int baud) ;
+extern int   serialSetBaud   (const int fd, const int baud) ;
+extern int   serialGetBaud   (const int fd) ;
 extern void  serialClose     (const int fd) ;
 extern void  serialFlush     (const int fd) ;
 extern void  serialPutchar   (const int fd, const unsigned char c) ;
@@ -32,6 +34,8 @@ extern void  serialPuts      (const int fd, const char *s) ;
 extern void  serialPrintf    (const int fd, const char *message, ...) ;
 extern int   serialDataAvail (const int fd) ;
 extern int   serialGetchar   (const int fd) ;
+extern int   serialSetTimeouts (const int fd, const int vmin, const int vtime) ;
+extern int   serialWait      (const int fd, const int timeout) ;
 
 #ifdef __cplusplus
 }
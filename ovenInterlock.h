@@ -0,0 +1,83 @@
+#ifndef OVEN_INTERLOCK_H
+#define OVEN_INTERLOCK_H
+
+#include "sensorConvert.h"
+
+// Oven and vacuum pump relay interlocks. The oven (relay 1) may only run while the vacuum
+// pump (relay 2) is on, below the maximum temperature and below the maximum pressure. Once
+// the oven has been pumped down, a loss of vacuum also shuts down the pump.
+//
+// The readings and thresholds are either calibrated (OvenInterlock: temperature in C and pressure
+// gauge voltage in V) or fixed-point (FixedInterlock: quarter degrees and summed ADC counts, see
+// sensorConvert.h). An invalid temperature (thermocouple fault) never changes the over temperature
+// state.
+template <typename Temp, typename Pressure>
+class OvenInterlockBase{
+ public:
+  OvenInterlockBase(Temp maxTemp_, Temp minTemp_, Pressure maxPressure_, Pressure pumpedDownPressure_) :
+    maxTemp(maxTemp_), minTemp(minTemp_), maxPressure(maxPressure_), pumpedDownPressure(pumpedDownPressure_), overTemp(false), pumpedDown(false) { }
+
+  // Evaluate the requested relay states (from the relay inputs) against the latest temperature
+  // and pressure readings, and set the allowed relay output states.
+  void evaluate(int relay1Request_, int relay2Request_, Temp temp_, Pressure pres_, int &relay1_, int &relay2_){
+    relay1_ = relay1Request_;
+    relay2_ = relay2Request_;
+
+    // Do not allow the oven to run without the vacuum pump.
+    if(relay2_ == 0){
+      relay1_ = 0; // Disable the oven relay.
+      pumpedDown = false; // Reset the vacuum pressure interlock.
+    }
+    else if(pres_ <= pumpedDownPressure){
+      pumpedDown = true; // Start the vacuum pressure interlock.
+    }
+
+    // Check for oven over temp.
+    if(!overTemp){
+      if(isValidTemp(temp_) && temp_ >= maxTemp){
+        // Force the oven off.
+        relay1_ = 0;
+        overTemp = true;
+      }
+      else{ relay1_ = relay1Request_; }
+    }
+    else if(isValidTemp(temp_) && temp_ <= minTemp){
+      relay1_ = relay1Request_;
+      overTemp = false;
+    }
+    else{ relay1_ = 0; }
+
+    // Check for over pressure state.
+    if(pres_ > maxPressure){
+      if(pumpedDown){
+        // LOSS OF VACUUM PRESSURE! EMERGENCY PUMP SHUTDOWN!
+        relay2_ = 0;
+      }
+      // Shut down the oven if the pressure is too high.
+      relay1_ = 0;
+    }
+  }
+
+  bool isOverTemp() const { return overTemp; }
+
+  bool isPumpedDown() const { return pumpedDown; }
+
+ private:
+  Temp maxTemp;
+  Temp minTemp;
+  Pressure maxPressure;
+  Pressure pumpedDownPressure;
+
+  bool overTemp;
+  bool pumpedDown;
+};
+
+// Interlocks on the calibrated readings.
+typedef OvenInterlockBase<double, double> OvenInterlock;
+
+// Interlocks on the fixed-point readings. Build the thresholds with TEMP_QUARTERS_UP(maxTemp),
+// TEMP_QUARTERS(minTemp) and PRESSURE_COUNTS(), so that every decision is the same as for the
+// calibrated readings.
+typedef OvenInterlockBase<int16_t, uint16_t> FixedInterlock;
+
+#endif
@@ -2,9 +2,27 @@
 #include "SdFat.h"
 #include "Adafruit_MAX31855.h"
 
+#include "sdLogger.h"
+#include "packetFrame.h"
+#include "taskScheduler.h"
+#include "ovenInterlock.h"
+#include "sensorConvert.h"
+
 //#define USE_SERIAL_ASCII
 #define USE_SERIAL_BINARY
 
+// Send packets as COBS frames with a CRC and sequence number (see packetFrame.h).
+// Comment this out to write the original delimited packets.
+#define USE_FRAMED_PACKETS
+
+// Send the longest time (us) spent in each stage of the control loop as a timing frame after each
+// packet (see packetFrame.h). Requires USE_SERIAL_BINARY and USE_FRAMED_PACKETS.
+//#define USE_TIMING_TELEMETRY
+
+#if defined(USE_TIMING_TELEMETRY) && (!defined(USE_SERIAL_BINARY) || !defined(USE_FRAMED_PACKETS))
+#error "USE_TIMING_TELEMETRY requires USE_SERIAL_BINARY and USE_FRAMED_PACKETS"
+#endif
+
 // Set the chip select pins.
 #define THERMO_CHIPSELECT 4
 #define SD_CHIPSELECT 10
@@ -34,20 +52,49 @@
 #define OVEN_MAX_PRESSURE 2.0017468
 #define PUMPED_DOWN_PRESSURE 1.8511003
 
-// Time (in milliseconds) to wait between read cycles.
+// Serial baud rate. Any rate supported by the host serial port may be used, and the host can find
+// it with 'loggerUnpacker --baud auto'. 250000, 500000 and 1000000 baud are exact at 16 MHz.
+#define SERIAL_BAUD 9600
+
+// Time (in milliseconds) between logged packets.
 #define READ_DELAY 1000
 
+// Time (in microseconds) between pressure gauge samples.
+#define PRESSURE_PERIOD 2000
+
+// Time (in microseconds) between thermocouple reads. The MAX31855 converts once every 100 ms.
+#define THERMO_PERIOD 100000
+
+// Time (in microseconds) between relay interlock evaluations.
+#define RELAY_PERIOD 10000
+
 // Maximum time to write to SD file output (ms).
 #define MAX_WRITE_TIME 86400000
 
+// Size of the preallocated SD file (bytes). This holds MAX_WRITE_TIME of framed packets at one per READ_DELAY.
+#define SD_PREALLOCATE_SIZE 3145728
+
 // The delimiter between data packets.
 const unsigned long delimiter = 0xFFFFFFFF;
 
+// Sequence number of the next framed packet.
+unsigned long sequence = 0;
+
 // The time since the program started.
 unsigned long timestamp = 0;
-unsigned long new_time = 0;
+
+// Latest temperature (quarter degrees C) and pressure (sum of PRESSURE_OVERSAMPLE ADC readings)
+// readings. The host converts them to C and V, see sensorConvert.h.
+int16_t temp = 0;
+uint16_t pres = 0;
+
+// Sum of the pressure gauge samples for the current reading.
+uint16_t pres_sum = 0;
+byte pres_count = 0;
 
 // Variables to track 120V relay states.
+int relay1_state = 0;
+int relay2_state = 0;
 int prev_relay1_state = 0;
 int prev_relay2_state = 0;
 
@@ -58,8 +105,25 @@ char filename[13] = "DATA0001.DAT";
 char title[30] = "JUN062016_Tmin=88.0,Tmax=89.0";
 
 bool sd_card_okay = false;
-bool over_temp = false;
-bool pumped_down = false;
+
+// Oven temperature and vacuum pressure interlocks, on the fixed-point readings. The thresholds are
+// converted when compiling.
+FixedInterlock interlock(TEMP_QUARTERS_UP(OVEN_MAX_TEMP), TEMP_QUARTERS(OVEN_MIN_TEMP), PRESSURE_COUNTS(OVEN_MAX_PRESSURE), PRESSURE_COUNTS(PUMPED_DOWN_PRESSURE));
+
+// Scheduler for the sampling, interlock and logging tasks.
+TaskScheduler scheduler;
+
+#ifdef USE_TIMING_TELEMETRY
+// Longest time (us) spent in each stage since the last timing frame.
+uint32_t stage_times[FRAME_TIMING_STAGES];
+
+// Record the time since start_ (from micros()) for a stage.
+#define TIMING_START(start_) unsigned long start_ = micros()
+#define TIMING_STOP(stage_, start_) { unsigned long elapsed = micros()-start_; if(elapsed > stage_times[stage_]){ stage_times[stage_] = elapsed; } }
+#else
+#define TIMING_START(start_)
+#define TIMING_STOP(stage_, start_)
+#endif
 
 // File system object.
 SdFat sd;
@@ -67,23 +131,12 @@ SdFat sd;
 // Log file.
 SdFile file;
 
+// Sector buffered writer for the log file.
+SdLogger<SdFile> logger;
+
 // initialize the Thermocouple.
 Adafruit_MAX31855 thermocouple(CLK_PIN, THERMO_CHIPSELECT, DO_PIN);
 
-// Write len_ bytes to the SD file.
-void writeBytes(byte *val_, const byte &len_){
-  if(!file.isOpen() || !val_ || len_==0){ return; }
-  
-  long container;
-  memcpy((byte*)&container, val_, len_);
-  
-  byte current;
-  for(byte index = 0; index < len_; index++){
-    current = (container >> 8*index) & 0xFF;
-    file.write(current);
-  }
-}
-
 // Write len_ bytes to the Serial output.
 void writeBytesSerial(byte *val_, const byte &len_){
 #ifdef USE_SERIAL_BINARY
@@ -124,17 +177,30 @@ void openFile(){
   Serial.print("... ");
 #endif
      
-  // Open the file. note that only one file can be open at a time,
+  // Create a contiguous file. note that only one file can be open at a time,
   // so you have to close this one before opening another.
-  if (file.open(filename, O_CREAT | O_WRITE | O_EXCL)) {
+  if (file.createContiguous(sd.vwd(), filename, SD_PREALLOCATE_SIZE)) {
+    // Erase the preallocated blocks so no stale data from deleted files is left in the file.
+    uint32_t bgnBlock, endBlock;
+    if(file.contiguousRange(&bgnBlock, &endBlock)){
+      sd.card()->erase(bgnBlock, endBlock);
+    }
+    
+    logger.begin(&file);
+    
     // Write the length of the title.
-    file.write(30);
+    byte titleLength = 30;
+    logger.write(&titleLength, 1);
     // Write the file title.
-    for(byte index = 0; index < 30; index++){
-      file.write(title[index]);
-    }
+    logger.write(title, 30);
+#ifdef USE_FRAMED_PACKETS
+    // End the title with a frame delimiter so the first frame starts cleanly.
+    byte frameDelimiter = FRAME_DELIMITER;
+    logger.write(&frameDelimiter, 1);
+#else
     // Write the packet delimiter to start the file.
-    writeBytes((byte*)&delimiter, 4);
+    logger.write(&delimiter, 4);
+#endif
 #ifdef USE_SERIAL_ASCII     
     Serial.println("done.");
 #endif
@@ -173,149 +239,110 @@ void initSD(){
   openFile();
 }
 
-void setup() {
-  // Wait for MAX chip to stabilize
-  delay(500);
-
-  // Initialize the digital input pins.
-  pinMode(RELAY_1_IN, INPUT);
-  pinMode(RELAY_2_IN, INPUT);
-  pinMode(CARD_DETECT_PIN, INPUT);
-  
-  // Initialize the digital output pins.
-  pinMode(RELAY_1_OUT, OUTPUT);
-  pinMode(RELAY_2_OUT, OUTPUT);
-
-#if defined(USE_SERIAL_ASCII) || defined(USE_SERIAL_BINARY)
-  // Open serial communications and wait for port to open.
-  Serial.begin(9600);
-
-  #ifdef USE_SERIAL_ASCII  
-  // Inform the user that we've started.
-  Serial.print("time(ms)\tT(C)\tP(V)\tR1\tR2\n");
-  #endif
-#endif
-
-  // Check for inserted SD card.
-  if(digitalRead(CARD_DETECT_PIN)){
-    initSD();
+// Sample the pressure gauge. Every PRESSURE_OVERSAMPLE samples are summed into a new pressure reading.
+void samplePressure(unsigned long now_){
+  TIMING_START(start);
+  pres_sum += analogRead(PRESSURE_PIN);
+  if(++pres_count >= PRESSURE_OVERSAMPLE){
+    pres = pres_sum;
+    pres_sum = 0;
+    pres_count = 0;
   }
+  TIMING_STOP(TIMING_PRESSURE, start);
 }
 
-void loop() {
-  // Get the current time (ms).
-  timestamp = millis();
+// Read the temperature from the thermocouple.
+void readTemperature(unsigned long now_){
+  TIMING_START(start);
+  temp = celsiusToQuarters(thermocouple.readCelsius());
+  TIMING_STOP(TIMING_THERMO, start);
+}
 
-  // Read the digital pins.
-  int relay1_state = digitalRead(RELAY_1_IN);
-  int relay2_state = digitalRead(RELAY_2_IN);
-  int card_detect = digitalRead(CARD_DETECT_PIN);
+// Read the relay inputs and set the relay outputs allowed by the interlocks.
+void evaluateRelays(unsigned long now_){
+  TIMING_START(start);
+  interlock.evaluate(digitalRead(RELAY_1_IN), digitalRead(RELAY_2_IN), temp, pres, relay1_state, relay2_state);
 
-  // Read the temperature from the thermocouple.
-  double temp = thermocouple.readCelsius();
-  
-  // Read the pressure from the pressure gauge.
-  double pres = 5.0*analogRead(PRESSURE_PIN)/1023.0;
-  
-  // Do not allow the oven to run without the vacuum pump.
-  if(relay2_state == 0){
-    relay1_state = 0; // Disable the oven relay.
-    pumped_down = false; // Reset the vacuum pressure interlock.
-  }
-  else if(pres <= PUMPED_DOWN_PRESSURE){
-    pumped_down = true; // Start the vacuum pressure interlock.
-  }
-  
-  // Check for oven over temp.
-  if(!over_temp){
-    if(temp >= OVEN_MAX_TEMP){
-      // Force the oven off.
-      relay1_state = 0;
-      over_temp = true;
-    }
-    else{ relay1_state = digitalRead(RELAY_1_IN); }
-  }
-  else if(temp <= OVEN_MIN_TEMP){
-    relay1_state = digitalRead(RELAY_1_IN);
-    over_temp = false;
-  }
-  else{ relay1_state = 0; }
-  
-  // Check for over pressure state.
-  if(pres > OVEN_MAX_PRESSURE){
-    if(pumped_down){
-      // LOSS OF VACUUM PRESSURE! EMERGENCY PUMP SHUTDOWN!
-      relay2_state = 0;
-    }
-    // Shut down the oven if the pressure is too high.
-    relay1_state = 0;
-  }
-  
   // Set the relay states.
   if(relay1_state != prev_relay1_state){
-    digitalWrite(RELAY_1_OUT, relay1_state); 
+    digitalWrite(RELAY_1_OUT, relay1_state);
     prev_relay1_state = relay1_state;
   }
   if(relay2_state != prev_relay2_state){
     digitalWrite(RELAY_2_OUT, relay2_state);
     prev_relay2_state = relay2_state;
-  }    
-     
+  }
+  TIMING_STOP(TIMING_RELAYS, start);
+}
+
+// Handle the SD card and write the latest readings to file/serial.
+void logPacket(unsigned long now_){
+  TIMING_START(start);
+
+  // Get the current time (ms).
+  timestamp = millis();
+
+  int card_detect = digitalRead(CARD_DETECT_PIN);
+
   // Hot-swappable SD card handler.
   if(timestamp <= MAX_WRITE_TIME && (!sd_card_okay && card_detect == 1)){ // Check for newly inserted SD card.
     initSD();
   }
   else if(timestamp > MAX_WRITE_TIME || (sd_card_okay && card_detect == 0)){ // Check for removed SD card.
     sd_card_okay = false;
-    
-    // Force data to SD and update the directory entry to avoid data loss.
-    if (!file.sync() || file.getWriteError()) {
+
+    // Write the buffered data, trim the preallocated file to the data length, and close the SD file.
+    if (logger.isOpen() && (!logger.end() || file.getWriteError())) {
 #ifdef USE_SERIAL_ASCII
       Serial.println("Failed to sync to SD file!");
 #endif
     }
-    
-    // Close the SD file.
-    file.close();
   }
 
+#ifdef USE_FRAMED_PACKETS
+  // Build the frame once for both outputs.
+  byte frame[FRAME_MAX_LENGTH];
+  byte frameLength = buildCompactFrame(frame, sequence++, timestamp, temp, pres, relay1_state, relay2_state);
+#endif
+#if !defined(USE_FRAMED_PACKETS) || defined(USE_SERIAL_ASCII)
+  // The delimited and ascii packets hold the calibrated readings.
+  float temp_celsius = quartersToCelsius(temp);
+  float pres_volts = countsToVolts(pres);
+#endif
+
   // Write to file/serial.
   if(sd_card_okay){ // Write to the sd card.
-    // Write the packet delimiter.
-    writeBytes((byte*)&delimiter, 4);
-
-    // Write the time.
-    writeBytes((byte*)&timestamp, 4);
-  
-    // Write the temperature.
-    writeBytes((byte*)&temp, 4);
-  
-    // Write the pressure.
-    writeBytes((byte*)&pres, 4);
-  
-    // Write the relay states.
-    writeBytes((byte*)&relay1_state, 2);
-    writeBytes((byte*)&relay2_state, 2);
+    // Buffer the packet. Full sectors are written while no task is due.
+#ifdef USE_FRAMED_PACKETS
+    logger.write(frame, frameLength);
+#else
+    logger.writePacket(timestamp, temp_celsius, pres_volts, relay1_state, relay2_state);
+#endif
   }
+  TIMING_STOP(TIMING_LOG, start);
+  TIMING_START(serial_start);
 #ifdef USE_SERIAL_ASCII
   // Print the time.
   Serial.print(timestamp);
   Serial.print("\t");
-  
+
   // Print the temperature.
-  if(isnan(temp)){ Serial.print("nan"); }
-  else{ Serial.print(temp); }
+  if(isnan(temp_celsius)){ Serial.print("nan"); }
+  else{ Serial.print(temp_celsius); }
   Serial.print("\t");
-  
+
   // Print the pressure.
-  Serial.print(pres);
+  Serial.print(pres_volts);
   Serial.print("\t");
-  
+
   // Print the relay states.
   Serial.print(relay1_state);
   Serial.print("\t");
   Serial.print(relay2_state);
   Serial.print("\n");
+#elif defined(USE_SERIAL_BINARY) && defined(USE_FRAMED_PACKETS)
+  // Write the entire frame.
+  Serial.write(frame, frameLength);
 #elif defined(USE_SERIAL_BINARY)
   // Write the packet delimiter.
   writeBytesSerial((byte*)&delimiter, 4);
@@ -324,19 +351,82 @@ void loop() {
   writeBytesSerial((byte*)&timestamp, 4);
 
   // Write the temperature.
-  writeBytesSerial((byte*)&temp, 4);
+  writeBytesSerial((byte*)&temp_celsius, 4);
 
   // Write the pressure.
-  writeBytesSerial((byte*)&pres, 4);
+  writeBytesSerial((byte*)&pres_volts, 4);
 
   // Write the relay states.
   writeBytesSerial((byte*)&relay1_state, 2);
   writeBytesSerial((byte*)&relay2_state, 2);
 #endif
+  TIMING_STOP(TIMING_SERIAL, serial_start);
+
+#ifdef USE_TIMING_TELEMETRY
+  // The worst loop overrun is the longest time any task waited after it was due.
+  for(uint8_t index = 0; index < scheduler.getNumTasks(); index++){
+    if(scheduler.getMaxLate(index) > stage_times[TIMING_LATE]){ stage_times[TIMING_LATE] = scheduler.getMaxLate(index); }
+  }
+  scheduler.clearMaxLate();
+
+  // Send the stage times since the last timing frame. The time taken to send this frame is
+  // included in the next one.
+  byte timing_frame[FRAME_TIMING_MAX_LENGTH];
+  byte timingLength = buildTimingFrame(timing_frame, timestamp, stage_times);
+  Serial.write(timing_frame, timingLength);
+  memset(stage_times, 0, sizeof(stage_times));
+#endif
+}
+
+void setup() {
+  // Wait for MAX chip to stabilize
+  delay(500);
+
+  // Initialize the digital input pins.
+  pinMode(RELAY_1_IN, INPUT);
+  pinMode(RELAY_2_IN, INPUT);
+  pinMode(CARD_DETECT_PIN, INPUT);
   
-  // Check if a delay is needed.
-  new_time = millis();
-  if(new_time-timestamp < READ_DELAY){
-    delay(READ_DELAY-(new_time-timestamp));
+  // Initialize the digital output pins.
+  pinMode(RELAY_1_OUT, OUTPUT);
+  pinMode(RELAY_2_OUT, OUTPUT);
+
+#if defined(USE_SERIAL_ASCII) || defined(USE_SERIAL_BINARY)
+  // Open serial communications and wait for port to open.
+  Serial.begin(SERIAL_BAUD);
+
+  #ifdef USE_SERIAL_ASCII  
+  // Inform the user that we've started.
+  Serial.print("time(ms)\tT(C)\tP(V)\tR1\tR2\n");
+  #endif
+#endif
+
+  // Check for inserted SD card.
+  if(digitalRead(CARD_DETECT_PIN)){
+    initSD();
   }
+
+  // Take the first readings so the interlocks never see an empty pressure average.
+  temp = celsiusToQuarters(thermocouple.readCelsius());
+  pres = PRESSURE_OVERSAMPLE*analogRead(PRESSURE_PIN);
+
+  // Start the tasks. The interlocks are evaluated more often than the pressure readings change.
+  unsigned long now = micros();
+  scheduler.add(samplePressure, PRESSURE_PERIOD, now);
+  scheduler.add(readTemperature, THERMO_PERIOD, now);
+  scheduler.add(evaluateRelays, RELAY_PERIOD, now);
+  scheduler.add(logPacket, 1000UL*READ_DELAY, now);
+}
+
+void loop() {
+  TIMING_START(start);
+
+  // Run any tasks which are due. Write any full sector to the SD card when no task was due.
+  if(scheduler.run(micros()) == 0 && sd_card_okay){
+    TIMING_START(sd_start);
+    logger.service();
+    TIMING_STOP(TIMING_SD, sd_start);
+  }
+
+  TIMING_STOP(TIMING_LOOP, start);
 }
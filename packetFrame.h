@@ -0,0 +1,180 @@
+#ifndef PACKET_FRAME_H
+#define PACKET_FRAME_H
+
+#include <stdint.h>
+#include <string.h>
+
+// Framed packet format, version 1. Each packet is sent as
+//  COBS( version(1) sequence(4) timestamp(4) temperature(4) pressure(4) relay1(2) relay2(2) crc(2) ) 0x00
+// COBS encoding removes every zero byte from the frame, so the trailing zero always marks the
+// end of a frame, no matter what the data contains. The CRC is CRC-16/CCITT-FALSE over the
+// version through relay2 bytes. The sequence number increases by one for every packet.
+// A framed file starts with the title followed by a single zero byte.
+#define FRAME_VERSION 1
+
+// Marks the end of a frame.
+#define FRAME_DELIMITER 0x00
+
+// Length of the frame contents before the CRC (bytes).
+#define FRAME_PAYLOAD_LENGTH 21
+
+// Length of the frame contents including the CRC (bytes).
+#define FRAME_DECODED_LENGTH 23
+
+// Maximum length of an encoded frame including the delimiter (bytes).
+#define FRAME_MAX_LENGTH 25
+
+// Compact framed packet format, version 2, with the fixed-point readings of the firmware (see
+// sensorConvert.h):
+//  COBS( version(1) sequence(4) timestamp(4) temperature(2) pressure(2) relays(1) crc(2) ) 0x00
+// The temperature is in quarter degrees C (signed) and the pressure is the sum of
+// PRESSURE_OVERSAMPLE ADC readings (unsigned). Bit 0 of the relays byte is relay 1 and bit 1 is
+// relay 2. Compact frames share the sequence numbers of version 1 frames.
+#define FRAME_COMPACT_VERSION 2
+
+// Length of the compact frame contents before the CRC (bytes).
+#define FRAME_COMPACT_PAYLOAD_LENGTH 14
+
+// Length of the compact frame contents including the CRC (bytes).
+#define FRAME_COMPACT_DECODED_LENGTH 16
+
+// Maximum length of an encoded compact frame including the delimiter (bytes).
+#define FRAME_COMPACT_MAX_LENGTH 18
+
+// Timing frame, sent on serial after each packet when the firmware is built with USE_TIMING_TELEMETRY:
+//  COBS( type(1) timestamp(4) stage times(4*FRAME_TIMING_STAGES) crc(2) ) 0x00
+// The type byte takes the place of the version. Each stage time is the longest time (us) spent in
+// that stage since the last timing frame. Timing frames have no sequence number, so they do not
+// change the loss count of the data packets.
+#define FRAME_TIMING 0x81
+
+// Number of stage times in a timing frame.
+#define FRAME_TIMING_STAGES 8
+
+// Stages of the firmware control loop.
+enum FrameTimingStage {
+  TIMING_PRESSURE, // samplePressure(), i.e. analogRead().
+  TIMING_THERMO, // readTemperature(), i.e. thermocouple.readCelsius().
+  TIMING_RELAYS, // evaluateRelays().
+  TIMING_LOG, // logPacket() before the serial output (SD card handling, building and buffering the packet).
+  TIMING_SERIAL, // Serial output of the packet.
+  TIMING_SD, // Writing buffered sectors to the SD card (SdLogger::service()).
+  TIMING_LOOP, // A single call to loop().
+  TIMING_LATE // Time a task was run after it was due, i.e. the loop overrun.
+};
+
+// Length of the timing frame contents before the CRC (bytes).
+#define FRAME_TIMING_PAYLOAD_LENGTH 37
+
+// Length of the timing frame contents including the CRC (bytes).
+#define FRAME_TIMING_DECODED_LENGTH 39
+
+// Maximum length of an encoded timing frame including the delimiter (bytes).
+#define FRAME_TIMING_MAX_LENGTH 41
+
+// Compute the CRC-16/CCITT-FALSE of len_ bytes (polynomial 0x1021, initial value 0xFFFF).
+static inline uint16_t frameCrc16(const uint8_t *data_, uint16_t len_){
+  uint16_t crc = 0xFFFF;
+  for(uint16_t index = 0; index < len_; index++){
+    crc ^= (uint16_t)data_[index] << 8;
+    for(uint8_t bit = 0; bit < 8; bit++){
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+    }
+  }
+  return crc;
+}
+
+// COBS encode len_ bytes. The output must have room for len_+len_/254+1 bytes.
+// Return the length of the encoded data (not including a delimiter).
+static inline uint16_t cobsEncode(const uint8_t *in_, uint16_t len_, uint8_t *out_){
+  uint16_t code_index = 0;
+  uint16_t write_index = 1;
+  uint8_t code = 1;
+  for(uint16_t index = 0; index < len_; index++){
+    if(in_[index] == 0){
+      out_[code_index] = code;
+      code_index = write_index++;
+      code = 1;
+      continue;
+    }
+    out_[write_index++] = in_[index];
+    if(++code == 0xFF && index+1 < len_){
+      out_[code_index] = code;
+      code_index = write_index++;
+      code = 1;
+    }
+  }
+  out_[code_index] = code;
+  return write_index;
+}
+
+// Decode len_ bytes of COBS data (not including the delimiter) into at most max_ bytes.
+// Return the length of the decoded data, or 0 if the data is not valid COBS.
+static inline uint16_t cobsDecode(const uint8_t *in_, uint16_t len_, uint8_t *out_, uint16_t max_){
+  uint16_t read_index = 0;
+  uint16_t write_index = 0;
+  while(read_index < len_){
+    uint8_t code = in_[read_index++];
+    if(code == 0 || read_index+code-1 > len_){ return 0; }
+    for(uint8_t index = 1; index < code; index++){
+      if(in_[read_index] == 0 || write_index >= max_){ return 0; }
+      out_[write_index++] = in_[read_index++];
+    }
+    if(code < 0xFF && read_index < len_){
+      if(write_index >= max_){ return 0; }
+      out_[write_index++] = 0;
+    }
+  }
+  return write_index;
+}
+
+// Build a complete frame, including the delimiter. The output must have room for
+// FRAME_MAX_LENGTH bytes. Return the length of the frame.
+static inline uint8_t buildFrame(uint8_t *frame_, uint32_t sequence_, uint32_t timestamp_, float temperature_, float pressure_, int16_t relay1_, int16_t relay2_){
+  uint8_t contents[FRAME_DECODED_LENGTH];
+  contents[0] = FRAME_VERSION;
+  memcpy(&contents[1], &sequence_, 4);
+  memcpy(&contents[5], &timestamp_, 4);
+  memcpy(&contents[9], &temperature_, 4);
+  memcpy(&contents[13], &pressure_, 4);
+  memcpy(&contents[17], &relay1_, 2);
+  memcpy(&contents[19], &relay2_, 2);
+  uint16_t crc = frameCrc16(contents, FRAME_PAYLOAD_LENGTH);
+  memcpy(&contents[21], &crc, 2);
+  uint8_t length = cobsEncode(contents, FRAME_DECODED_LENGTH, frame_);
+  frame_[length++] = FRAME_DELIMITER;
+  return length;
+}
+
+// Build a complete compact frame from fixed-point readings, including the delimiter. The output
+// must have room for FRAME_COMPACT_MAX_LENGTH bytes. Return the length of the frame.
+static inline uint8_t buildCompactFrame(uint8_t *frame_, uint32_t sequence_, uint32_t timestamp_, int16_t temperature_, uint16_t pressure_, int16_t relay1_, int16_t relay2_){
+  uint8_t contents[FRAME_COMPACT_DECODED_LENGTH];
+  contents[0] = FRAME_COMPACT_VERSION;
+  memcpy(&contents[1], &sequence_, 4);
+  memcpy(&contents[5], &timestamp_, 4);
+  memcpy(&contents[9], &temperature_, 2);
+  memcpy(&contents[11], &pressure_, 2);
+  contents[13] = (relay1_ ? 0x01 : 0) | (relay2_ ? 0x02 : 0);
+  uint16_t crc = frameCrc16(contents, FRAME_COMPACT_PAYLOAD_LENGTH);
+  memcpy(&contents[FRAME_COMPACT_PAYLOAD_LENGTH], &crc, 2);
+  uint8_t length = cobsEncode(contents, FRAME_COMPACT_DECODED_LENGTH, frame_);
+  frame_[length++] = FRAME_DELIMITER;
+  return length;
+}
+
+// Build a complete timing frame from FRAME_TIMING_STAGES stage times (us), including the delimiter.
+// The output must have room for FRAME_TIMING_MAX_LENGTH bytes. Return the length of the frame.
+static inline uint8_t buildTimingFrame(uint8_t *frame_, uint32_t timestamp_, const uint32_t *times_){
+  uint8_t contents[FRAME_TIMING_DECODED_LENGTH];
+  contents[0] = FRAME_TIMING;
+  memcpy(&contents[1], &timestamp_, 4);
+  memcpy(&contents[5], times_, 4*FRAME_TIMING_STAGES);
+  uint16_t crc = frameCrc16(contents, FRAME_TIMING_PAYLOAD_LENGTH);
+  memcpy(&contents[FRAME_TIMING_PAYLOAD_LENGTH], &crc, 2);
+  uint8_t length = cobsEncode(contents, FRAME_TIMING_DECODED_LENGTH, frame_);
+  frame_[length++] = FRAME_DELIMITER;
+  return length;
+}
+
+#endif
@@ -1,10 +1,10 @@
 #!/bin/bash
 
-LOGGER_EXE=./exec/loggerUnpacker
-READER_EXE=./exec/csvReader
+PIPELINE_EXE=./exec/ovenPipeline
 PROCESSOR_EXE=./exec/processor
+UNPACKER_EXE=./exec/loggerUnpacker
 
-if [[ ! -f $LOGGER_EXE || ! -f $READER_EXE || ! -f $PROCESSOR_EXE ]]; then
+if [[ ! -f $PIPELINE_EXE || ! -f $PROCESSOR_EXE || ! -f $UNPACKER_EXE ]]; then
 	make
 fi
 
@@ -23,26 +23,33 @@ fi
 if [ $# -lt 2 ]; then
 	echo " Error: Invalid number of arguments"
 	echo "  SYNTAX:";
-	echo "   "$0" <rawData> <tarFilename>";
+	echo "   "$0" <rawData> <tarFilename> [--follow]";
+	echo "  With --follow, only data appended since the last run is unpacked and the";
+	echo "  intermediate files (and their checkpoints) are kept for the next run.";
 	exit 3
 fi
 
-echo -e "\n--Unpacking binary data--"
-$LOGGER_EXE $1 tmp.csv
-
-if [ ! -f "tmp.csv" ]; then
-	echo " Error: Failed to generate file 'tmp.csv'"
-	exit 4
+FOLLOW=""
+if [ "$3" == "--follow" ]; then
+	FOLLOW="--follow"
 fi
 
-echo -e "\n--Prescanning .csv file--\n"
-$READER_EXE tmp.csv
+echo -e "\n--Unpacking binary data--\n"
+$PIPELINE_EXE $1 --output tmp.dat --relays relays.dat $FOLLOW
 
 if [ ! -f "tmp.dat" ]; then
 	echo " Error: Failed to generate file 'tmp.dat'"
 	exit 5
 fi
 
+echo -e "\n--Compressing binary data--\n"
+$UNPACKER_EXE $1 /dev/null --compress raw.ovz $FOLLOW --checkpoint raw.ovz.ckp
+
+if [ ! -f "raw.ovz" ]; then
+	echo " Error: Failed to generate file 'raw.ovz'"
+	exit 10
+fi
+
 echo -e "\n--Converting to root--\n"
 raw2root tmp.dat --names --delimiter 44
 
@@ -78,10 +85,12 @@ if [ ! -f "pres.pdf" ]; then
 fi
 
 # Tar up the resulting files.
-tar -cf $2 data.root graphs.root pres.pdf temp.pdf
+tar -cf $2 data.root graphs.root pres.pdf temp.pdf relays.dat raw.ovz
 
 # Cleanup
-rm -f data.tmp tmp.csv tmp.dat
+if [ -z "$FOLLOW" ]; then
+	rm -f data.tmp tmp.dat relays.dat raw.ovz
+fi
 rm -f data.root graphs.root
 
 exit 0
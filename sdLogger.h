@@ -0,0 +1,153 @@
+#ifndef SD_LOGGER_H
+#define SD_LOGGER_H
+
+#include <stdint.h>
+#include <string.h>
+
+// Size of a single SD card sector (bytes).
+#define SD_LOGGER_BLOCK_SIZE 512
+
+// Number of sector buffers. Two buffers use 1 kB of the 2 kB of SRAM on an Uno.
+#define SD_LOGGER_BUFFER_COUNT 2
+
+// Length of a single data packet (bytes).
+// delimiter(4) + timestamp(4) + temperature(4) + pressure(4) + relay1(2) + relay2(2)
+#define SD_LOGGER_PACKET_LENGTH 20
+
+// The delimiter between data packets.
+#define SD_LOGGER_DELIMITER 0xFFFFFFFF
+
+// Sector buffered logging to an SD file. Packets are assembled in RAM and only whole,
+// sector aligned 512 byte blocks are written to the file, so each write goes straight to
+// the card without a read-modify-write of the SdFat cache. The file should be
+// preallocated (e.g. with createContiguous()) so no clusters need to be allocated
+// while logging.
+//
+// FileType needs to provide write(const void*, size_t), truncate(uint32_t), sync()
+// and close(), so the logger may also be built on a host against a fake file.
+template <class FileType>
+class SdLogger{
+ public:
+  SdLogger() : file(0), active(0), numFull(0), fill(0), position(0), numWrites(0), numOverruns(0), writeError(false) { }
+
+  // Start logging to an open file. The file position must be zero.
+  void begin(FileType *file_){
+    file = file_;
+    active = 0;
+    numFull = 0;
+    fill = 0;
+    position = 0;
+    numWrites = 0;
+    numOverruns = 0;
+    writeError = false;
+  }
+
+  bool isOpen() const { return (file != 0); }
+
+  // Append bytes to the current sector buffer. Full sectors are queued and written by
+  // service(). If every buffer is full, the oldest sector is written immediately.
+  void write(const void *data_, uint16_t len_){
+    if(!file){ return; }
+    const uint8_t *ptr = (const uint8_t*)data_;
+    while(len_ > 0){
+      uint16_t count = SD_LOGGER_BLOCK_SIZE-fill;
+      if(count > len_){ count = len_; }
+      memcpy(&buffers[active][fill], ptr, count);
+      fill += count;
+      ptr += count;
+      len_ -= count;
+      position += count;
+      if(fill == SD_LOGGER_BLOCK_SIZE){ // Queue the full sector.
+        active = (active+1) % SD_LOGGER_BUFFER_COUNT;
+        fill = 0;
+        if(++numFull == SD_LOGGER_BUFFER_COUNT){ // No free buffer left.
+          numOverruns++;
+          writeBlock();
+        }
+      }
+    }
+  }
+
+  // Append a single data packet.
+  void writePacket(uint32_t timestamp_, float temperature_, float pressure_, int16_t relay1_, int16_t relay2_){
+    const uint32_t delimiter = SD_LOGGER_DELIMITER;
+    uint8_t packet[SD_LOGGER_PACKET_LENGTH];
+    memcpy(&packet[0], &delimiter, 4);
+    memcpy(&packet[4], &timestamp_, 4);
+    memcpy(&packet[8], &temperature_, 4);
+    memcpy(&packet[12], &pressure_, 4);
+    memcpy(&packet[16], &relay1_, 2);
+    memcpy(&packet[18], &relay2_, 2);
+    write(packet, SD_LOGGER_PACKET_LENGTH);
+  }
+
+  // Write one queued sector to the file. Call this when there is idle time in the loop.
+  // Return true if a sector was written.
+  bool service(){
+    if(!file || numFull == 0){ return false; }
+    return writeBlock();
+  }
+
+  // Write all queued sectors and any partial sector, truncate the preallocated file to
+  // the length of the data, and close it.
+  bool end(){
+    if(!file){ return false; }
+    while(numFull > 0){ writeBlock(); }
+    if(fill > 0){
+      numWrites++;
+      if(file->write(buffers[active], fill) != (int)fill){ writeError = true; }
+      fill = 0;
+    }
+    if(!file->truncate(position) || !file->sync()){ writeError = true; }
+    file->close();
+    file = 0;
+    return !writeError;
+  }
+
+  // Stop logging without writing anything else (e.g. when the card has been removed).
+  void abort(){
+    if(file){ file->close(); }
+    file = 0;
+    numFull = 0;
+    fill = 0;
+  }
+
+  // Total number of bytes logged.
+  uint32_t getPosition() const { return position; }
+
+  // Number of calls to write() on the file.
+  uint32_t getNumWrites() const { return numWrites; }
+
+  // Number of times a sector had to be written from write() because every buffer was full.
+  uint16_t getNumOverruns() const { return numOverruns; }
+
+  bool getWriteError() const { return writeError; }
+
+ private:
+  FileType *file;
+
+  uint8_t buffers[SD_LOGGER_BUFFER_COUNT][SD_LOGGER_BLOCK_SIZE];
+  uint8_t active; // Buffer currently being filled.
+  uint8_t numFull; // Number of full buffers waiting to be written.
+  uint16_t fill; // Number of bytes in the active buffer.
+
+  uint32_t position;
+  uint32_t numWrites;
+  uint16_t numOverruns;
+
+  bool writeError;
+
+  // Write the oldest full buffer to the file.
+  bool writeBlock(){
+    uint8_t oldest = (active+SD_LOGGER_BUFFER_COUNT-numFull) % SD_LOGGER_BUFFER_COUNT;
+    numFull--;
+    numWrites++;
+    if(file->write(buffers[oldest], SD_LOGGER_BLOCK_SIZE) != SD_LOGGER_BLOCK_SIZE){
+      writeError = true;
+      return false;
+    }
+    return true;
+  }
+};
+
+#endif
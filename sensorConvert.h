@@ -0,0 +1,61 @@
+#ifndef SENSOR_CONVERT_H
+#define SENSOR_CONVERT_H
+
+#include <stdint.h>
+#include <math.h>
+
+// Fixed-point sensor readings. The firmware keeps the raw integer readings, compares them with
+// integer thresholds and logs them in compact frames (see packetFrame.h). The host applies the
+// calibration:
+//  temperature: MAX31855 thermocouple reading in quarter degrees C (the LSB of the MAX31855), or
+//               TEMP_INVALID if the thermocouple reported a fault.
+//  pressure: sum of PRESSURE_OVERSAMPLE pressure gauge ADC readings, from 0 to
+//            ADC_FULL_SCALE*PRESSURE_OVERSAMPLE.
+// This header builds both for the Arduino and on Linux.
+
+// Number of pressure gauge samples averaged for each pressure reading.
+#define PRESSURE_OVERSAMPLE 8
+
+// Largest reading of the 10 bit ADC.
+#define ADC_FULL_SCALE 1023
+
+// ADC reference voltage (V).
+#define ADC_REFERENCE 5.0
+
+// Temperature reading of a thermocouple fault.
+#define TEMP_INVALID (-32767-1)
+
+// Convert a temperature (C) to quarter degrees, rounded down (positive temperatures only). These
+// are constant expressions, for thresholds which are computed when compiling.
+#define TEMP_QUARTERS(celsius_) ((int16_t)(4*(celsius_)))
+
+// Convert a temperature (C) to quarter degrees, rounded up (positive temperatures only).
+#define TEMP_QUARTERS_UP(celsius_) ((int16_t)(TEMP_QUARTERS(celsius_)+(4*(celsius_) > TEMP_QUARTERS(celsius_) ? 1 : 0)))
+
+// Convert a pressure gauge voltage (V) to the sum of PRESSURE_OVERSAMPLE ADC readings, rounded down.
+#define PRESSURE_COUNTS(volts_) ((uint16_t)((volts_)*(ADC_FULL_SCALE*PRESSURE_OVERSAMPLE)/ADC_REFERENCE))
+
+// Convert a thermocouple reading (C), which is always a whole number of quarter degrees, to
+// quarter degrees. A fault (NaN) is returned as TEMP_INVALID.
+static inline int16_t celsiusToQuarters(double celsius_){
+  if(celsius_ != celsius_){ return TEMP_INVALID; }
+  return (int16_t)(4*celsius_);
+}
+
+// Convert quarter degrees to a temperature (C). TEMP_INVALID is returned as NaN.
+static inline float quartersToCelsius(int16_t quarters_){
+  if(quarters_ == TEMP_INVALID){ return NAN; }
+  return 0.25f*quarters_;
+}
+
+// Convert the sum of PRESSURE_OVERSAMPLE ADC readings to the pressure gauge voltage (V).
+static inline float countsToVolts(uint16_t counts_){
+  return (float)(ADC_REFERENCE*counts_/(ADC_FULL_SCALE*(double)PRESSURE_OVERSAMPLE));
+}
+
+// Return true if a temperature reading is not a thermocouple fault.
+static inline bool isValidTemp(double celsius_){ return (celsius_ == celsius_); }
+
+static inline bool isValidTemp(int16_t quarters_){ return (quarters_ != TEMP_INVALID); }
+
+#endif
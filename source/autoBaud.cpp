@@ -0,0 +1,71 @@
+#include <chrono>
+#include <string.h>
+#include <unistd.h>
+
+#include "autoBaud.hpp"
+#include "wiringSerial.h"
+
+// Maximum number of bytes kept while searching for packets at a single rate.
+#define AUTOBAUD_BUFFER_SIZE 8192
+
+// Return the format of the packets in a buffer if it contains two consecutive valid packets.
+static PacketFormat findPackets(const char *data_, const size_t &len_){
+	// Framed packets must have a valid CRC and consecutive sequence numbers.
+	FrameDecoder frames;
+	PacketColumns cols;
+	if(frames.decode(data_, len_, cols) >= 2 && frames.getNumLost() == 0){ return FORMAT_FRAMED; }
+
+	// Legacy packets must start with three delimiters one packet apart.
+	unsigned int word;
+	for(size_t i = 0; i+2*PACKET_LENGTH+4 <= len_; i++){
+		bool found = true;
+		for(size_t j = 0; j < 3 && found; j++){
+			memcpy((char*)&word, &data_[i+j*PACKET_LENGTH], 4);
+			found = (word == PACKET_DELIMITER);
+		}
+		if(found){ return FORMAT_LEGACY; }
+	}
+
+	return FORMAT_UNKNOWN;
+}
+
+std::vector<int> getBaudRates(){
+	const int rates[] = {DEFAULT_BAUD, 19200, 38400, 57600, 115200, 230400, 250000, 460800, 500000, 921600, 1000000, 2000000};
+	return std::vector<int>(rates, rates+sizeof(rates)/sizeof(rates[0]));
+}
+
+int detectBaud(const int &fd_, const std::vector<int> &rates_, PacketFormat &format_, const int &timeout_/*=AUTOBAUD_TIMEOUT*/){
+	std::vector<char> data;
+	data.reserve(AUTOBAUD_BUFFER_SIZE);
+	char buffer[1024];
+
+	format_ = FORMAT_UNKNOWN;
+	for(std::vector<int>::const_iterator iter = rates_.begin(); iter != rates_.end(); iter++){
+		if(serialSetBaud(fd_, *iter) != 0){ continue; }
+
+		// Bytes received at the previous rate are not valid at this one.
+		serialFlush(fd_);
+		data.clear();
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		while(true){
+			int remaining = timeout_-(int)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now()-start).count();
+			if(remaining <= 0){ break; }
+
+			int status = serialWait(fd_, remaining);
+			if(status < 0){ return -1; }
+			else if(status == 0){ continue; } // Timed out or interrupted by a signal.
+
+			ssize_t count = read(fd_, buffer, sizeof(buffer));
+			if(count < 0){ return -1; }
+
+			// Keep the most recent bytes.
+			if(data.size()+count > AUTOBAUD_BUFFER_SIZE){ data.erase(data.begin(), data.begin()+(data.size()+count-AUTOBAUD_BUFFER_SIZE/2)); }
+			data.insert(data.end(), buffer, buffer+count);
+
+			if((format_ = findPackets(data.data(), data.size())) != FORMAT_UNKNOWN){ return *iter; }
+		}
+	}
+
+	return 0;
+}
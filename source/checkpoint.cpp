@@ -0,0 +1,87 @@
+#include <fstream>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "checkpoint.hpp"
+
+// 64 bit FNV-1a hash of len_ bytes, continuing from hash_.
+static uint64_t hashBytes(const char *data_, const size_t &len_, uint64_t hash_){
+	for(size_t i = 0; i < len_; i++){
+		hash_ ^= (uint8_t)data_[i];
+		hash_ *= 1099511628211ULL;
+	}
+	return hash_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// class Checkpoint
+///////////////////////////////////////////////////////////////////////////////
+
+Checkpoint::Checkpoint(){
+	reset();
+}
+
+void Checkpoint::reset(){
+	memset((char*)&header, 0, sizeof(CheckpointHeader));
+	strncpy(header.magic, CHECKPOINT_MAGIC, 8);
+	header.version = CHECKPOINT_VERSION;
+}
+
+bool Checkpoint::load(const std::string &fname_, const char *data_, const size_t &size_){
+	reset();
+
+	std::ifstream file(fname_.c_str(), std::ios::binary);
+	if(!file.is_open()){ return false; }
+
+	CheckpointHeader temp;
+	if(!file.read((char*)&temp, sizeof(CheckpointHeader))){ return false; }
+	if(strncmp(temp.magic, CHECKPOINT_MAGIC, 8) != 0 || temp.version != CHECKPOINT_VERSION){ return false; }
+
+	// Make sure the input is the same file, and has not been truncated or rewritten.
+	if(temp.inputOffset > size_ || temp.inputHash != hashInput(data_, temp.inputOffset)){ return false; }
+
+	header = temp;
+
+	return true;
+}
+
+bool Checkpoint::save(const std::string &fname_, const char *data_, const size_t &size_){
+	if(header.inputOffset > size_){ return false; }
+	header.inputHash = hashInput(data_, header.inputOffset);
+
+	std::ofstream file(fname_.c_str(), std::ios::binary | std::ios::trunc);
+	if(!file.is_open()){ return false; }
+
+	file.write((const char*)&header, sizeof(CheckpointHeader));
+	file.close();
+
+	return !file.fail();
+}
+
+bool Checkpoint::truncateOutput(const std::string &fname_, const uint64_t &size_){
+	struct stat info;
+	if(stat(fname_.c_str(), &info) != 0){ return false; }
+	if(!S_ISREG(info.st_mode)){ return true; }
+	if((uint64_t)info.st_size < size_){ return false; }
+	return ((uint64_t)info.st_size == size_ || truncate(fname_.c_str(), size_) == 0);
+}
+
+uint64_t Checkpoint::getFileSize(const std::string &fname_){
+	struct stat info;
+	if(stat(fname_.c_str(), &info) != 0 || !S_ISREG(info.st_mode)){ return 0; }
+	return info.st_size;
+}
+
+uint64_t Checkpoint::hashInput(const char *data_, const size_t &offset_){
+	uint64_t hash = 14695981039346656037ULL;
+	if(!data_){ return hash; }
+
+	// The start of the file holds the title and the first packets, which identify the capture.
+	const size_t head = (offset_ < CHECKPOINT_HASH_LENGTH ? offset_ : CHECKPOINT_HASH_LENGTH);
+	hash = hashBytes(data_, head, hash);
+
+	// The bytes before the resume offset change if the file was rewritten.
+	const size_t start = (offset_ > head+CHECKPOINT_HASH_LENGTH ? offset_-CHECKPOINT_HASH_LENGTH : head);
+	return hashBytes(data_+start, offset_-start, hash);
+}
@@ -0,0 +1,121 @@
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <string.h>
+#include <stdlib.h>
+#include <cmath>
+
+#include "columnStore.hpp"
+#include "packetFormat.hpp"
+
+void help(char * prog_name_){
+	std::cout << "  SYNTAX: " << prog_name_ << " <columnFile> [options]\n";
+	std::cout << "   Available options:\n";
+	std::cout << "    --time <low> <high> | Select records within a time range (in seconds).\n";
+	std::cout << "    --temp <low> <high> | Select records within a temperature range (in C).\n";
+	std::cout << "    --output <filename> | Write the selected records to a csv file.\n";
+	std::cout << "    --info              | Print the zone maps of all chunks.\n";
+}
+
+int main(int argc, char* argv[]){
+	if(argc > 1 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)){
+		help(argv[0]);
+		return 0;
+	}
+	else if(argc < 2){
+		std::cout << " Error: Invalid number of arguments to " << argv[0] << ". Expected 1, received " << argc-1 << ".\n";
+		help(argv[0]);
+		return 1;
+	}
+
+	uint32_t timeLow = 0;
+	uint32_t timeHigh = 0xFFFFFFFF;
+	float tempLow = -INFINITY;
+	float tempHigh = INFINITY;
+	std::string ofname;
+	bool printInfo = false;
+
+	int index = 2;
+	while(index < argc){
+		if(strcmp(argv[index], "--time") == 0 || strcmp(argv[index], "--temp") == 0){
+			if(index + 2 >= argc){
+				std::cout << " Error! Missing required arguments to '" << argv[index] << "'!\n";
+				help(argv[0]);
+				return 1;
+			}
+			if(strcmp(argv[index], "--time") == 0){
+				timeLow = (uint32_t)(1000*strtod(argv[index+1], NULL));
+				timeHigh = (uint32_t)(1000*strtod(argv[index+2], NULL));
+			}
+			else{
+				tempLow = strtof(argv[index+1], NULL);
+				tempHigh = strtof(argv[index+2], NULL);
+			}
+			index += 2;
+		}
+		else if(strcmp(argv[index], "--output") == 0){
+			if(index + 1 >= argc){
+				std::cout << " Error! Missing required argument to '--output'!\n";
+				help(argv[0]);
+				return 1;
+			}
+			ofname = argv[++index];
+		}
+		else if(strcmp(argv[index], "--info") == 0){
+			printInfo = true;
+		}
+		else{
+			std::cout << " Error! Unrecognized option '" << argv[index] << "'!\n";
+			help(argv[0]);
+			return 1;
+		}
+		index++;
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	ColumnReader reader;
+	if(!reader.open(argv[1])){
+		std::cout << " ERROR: Failed to open column file '" << argv[1] << "'!\n";
+		return 1;
+	}
+
+	std::cout << " Title: " << reader.getHeader().title << std::endl;
+	std::cout << " File contains " << reader.getNumRecords() << " records in " << reader.getNumChunks() << " chunks.\n";
+
+	if(printInfo){
+		for(size_t i = 0; i < reader.getNumChunks(); i++){
+			const ColumnChunk &info = reader.getChunk(i);
+			std::cout << "  chunk " << i << ": N=" << info.numRecords << ", time=[" << info.timeMin << ", " << info.timeMax << "] ms";
+			std::cout << ", T=[" << info.tempMin << ", " << info.tempMax << "] C, P=[" << info.presMin << ", " << info.presMax << "] Torr";
+			std::cout << ", R1=" << info.relay1On << ", R2=" << info.relay2On << std::endl;
+		}
+	}
+
+	PacketColumns cols;
+	size_t numSkipped = reader.select(cols, timeLow, timeHigh, tempLow, tempHigh);
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+	std::cout << " Selected " << cols.size() << " records in " << seconds*1000 << " ms (skipped " << numSkipped << " of " << reader.getNumChunks() << " chunks).\n";
+
+	if(!ofname.empty()){
+		std::ofstream output(ofname.c_str(), std::ios::binary);
+		if(!output.is_open()){
+			std::cout << " ERROR: Failed to open output file '" << ofname << "'!\n";
+			return 1;
+		}
+		output << "time(ms),T(C),P(Torr),R1,R2\n";
+
+		CsvWriter writer(&output);
+		for(size_t i = 0; i < cols.size(); i++){
+			writer.addPacket(cols.timestamp[i], cols.temperature[i], cols.pressure[i], cols.relay1[i], cols.relay2[i]);
+			writer.endRow();
+		}
+		writer.flush();
+		output.close();
+
+		std::cout << "  Wrote output file '" << ofname << "'\n";
+	}
+
+	return 0;
+}
@@ -0,0 +1,257 @@
+#include <string.h>
+#include <unistd.h>
+#include <cmath>
+
+#include "columnStore.hpp"
+
+///////////////////////////////////////////////////////////////////////////////
+// class ColumnWriter
+///////////////////////////////////////////////////////////////////////////////
+
+ColumnWriter::ColumnWriter(const size_t &chunkSize_/*=COLUMN_CHUNK_SIZE*/) : offset(0) {
+	memset((char*)&header, 0, sizeof(ColumnHeader));
+	header.chunkSize = (chunkSize_ > 0 ? chunkSize_ : COLUMN_CHUNK_SIZE);
+}
+
+ColumnWriter::~ColumnWriter(){
+	close();
+}
+
+bool ColumnWriter::open(const std::string &fname_, const char *title_/*=NULL*/){
+	close();
+
+	file.open(fname_.c_str(), std::ios::binary | std::ios::trunc);
+	if(!file.is_open()){ return false; }
+
+	uint32_t chunkSize = header.chunkSize;
+	memset((char*)&header, 0, sizeof(ColumnHeader));
+	strncpy(header.magic, COLUMN_MAGIC, 8);
+	header.version = COLUMN_VERSION;
+	header.chunkSize = chunkSize;
+	if(title_){ strncpy(header.title, title_, 63); }
+
+	// Write a placeholder header. It will be rewritten when the file is closed.
+	file.write((const char*)&header, sizeof(ColumnHeader));
+	offset = sizeof(ColumnHeader);
+
+	chunk.clear();
+	chunk.reserve(header.chunkSize);
+	index.clear();
+
+	return true;
+}
+
+bool ColumnWriter::append(const std::string &fname_){
+	close();
+
+	ColumnReader reader;
+	if(!reader.open(fname_)){ return false; }
+
+	header = reader.getHeader();
+	index.clear();
+	for(size_t i = 0; i < reader.getNumChunks(); i++){ index.push_back(reader.getChunk(i)); }
+	offset = header.indexOffset;
+
+	// Read back an incomplete last chunk, so that repeated appends do not leave many small chunks.
+	chunk.clear();
+	chunk.reserve(header.chunkSize);
+	if(!index.empty() && index.back().numRecords < header.chunkSize){
+		const size_t last = index.size()-1;
+		const size_t N = index.back().numRecords;
+		chunk.timestamp.assign(reader.getTime(last), reader.getTime(last)+N);
+		chunk.temperature.assign(reader.getTemperature(last), reader.getTemperature(last)+N);
+		chunk.pressure.assign(reader.getPressure(last), reader.getPressure(last)+N);
+		chunk.relay1.assign(reader.getRelay1(last), reader.getRelay1(last)+N);
+		chunk.relay2.assign(reader.getRelay2(last), reader.getRelay2(last)+N);
+		offset = index.back().offset;
+		header.numRecords -= N;
+		index.pop_back();
+	}
+	reader.close();
+
+	// Remove the chunk index, which is written again when the file is closed.
+	if(truncate(fname_.c_str(), offset) != 0){ return false; }
+	file.open(fname_.c_str(), std::ios::binary | std::ios::in | std::ios::out);
+	if(!file.is_open()){ return false; }
+	file.seekp(offset);
+
+	return true;
+}
+
+void ColumnWriter::add(const unsigned int &timestamp_, const float &temperature_, const float &pressure_, const short &relay1_, const short &relay2_){
+	if(!file.is_open()){ return; }
+
+	chunk.timestamp.push_back(timestamp_);
+	chunk.temperature.push_back(temperature_);
+	chunk.pressure.push_back(pressure_);
+	chunk.relay1.push_back(relay1_);
+	chunk.relay2.push_back(relay2_);
+
+	if(chunk.size() >= header.chunkSize){ writeChunk(); }
+}
+
+void ColumnWriter::close(){
+	if(!file.is_open()){ return; }
+
+	writeChunk();
+
+	// Write the chunk index.
+	header.indexOffset = offset;
+	header.numChunks = index.size();
+	if(!index.empty()){ file.write((const char*)&index[0], index.size()*sizeof(ColumnChunk)); }
+
+	// Rewrite the header.
+	file.seekp(0);
+	file.write((const char*)&header, sizeof(ColumnHeader));
+	file.close();
+}
+
+void ColumnWriter::writeChunk(){
+	size_t N = chunk.size();
+	if(N == 0){ return; }
+
+	ColumnChunk info;
+	memset((char*)&info, 0, sizeof(ColumnChunk));
+	info.offset = offset;
+	info.numRecords = N;
+	info.timeMin = info.timeMax = chunk.timestamp[0];
+	info.tempMin = info.tempMax = NAN;
+	info.presMin = info.presMax = NAN;
+
+	// Compute the zone maps.
+	for(size_t i = 0; i < N; i++){
+		if(chunk.timestamp[i] < info.timeMin){ info.timeMin = chunk.timestamp[i]; }
+		if(chunk.timestamp[i] > info.timeMax){ info.timeMax = chunk.timestamp[i]; }
+		if(!std::isnan(chunk.temperature[i])){
+			if(!(chunk.temperature[i] >= info.tempMin)){ info.tempMin = chunk.temperature[i]; }
+			if(!(chunk.temperature[i] <= info.tempMax)){ info.tempMax = chunk.temperature[i]; }
+		}
+		if(!std::isnan(chunk.pressure[i])){
+			if(!(chunk.pressure[i] >= info.presMin)){ info.presMin = chunk.pressure[i]; }
+			if(!(chunk.pressure[i] <= info.presMax)){ info.presMax = chunk.pressure[i]; }
+		}
+		if(chunk.relay1[i]){ info.relay1On++; }
+		if(chunk.relay2[i]){ info.relay2On++; }
+	}
+
+	file.write((const char*)&chunk.timestamp[0], 4*N);
+	file.write((const char*)&chunk.temperature[0], 4*N);
+	file.write((const char*)&chunk.pressure[0], 4*N);
+	file.write((const char*)&chunk.relay1[0], 2*N);
+	file.write((const char*)&chunk.relay2[0], 2*N);
+	offset += 16*N;
+
+	// Pad the chunk to an 8 byte boundary.
+	const char padding[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+	if(offset % 8 != 0){
+		file.write(padding, 8-offset%8);
+		offset += 8-offset%8;
+	}
+
+	index.push_back(info);
+	header.numRecords += N;
+	chunk.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// class ColumnReader
+///////////////////////////////////////////////////////////////////////////////
+
+bool ColumnReader::open(const std::string &fname_){
+	if(!file.open(fname_)){ return false; }
+
+	if(file.getSize() < sizeof(ColumnHeader)){
+		file.close();
+		return false;
+	}
+
+	// The file may be truncated or partly rewritten (e.g. copied while it is being appended to), so
+	// every offset is checked against the file size. The checks are written so they cannot overflow.
+	const size_t size = file.getSize();
+	header = (const ColumnHeader*)file.getData();
+	if(strncmp(header->magic, COLUMN_MAGIC, 8) != 0 || header->version != COLUMN_VERSION ||
+	   header->indexOffset < sizeof(ColumnHeader) || header->indexOffset > size ||
+	   header->numChunks > (size-header->indexOffset)/sizeof(ColumnChunk)){
+		file.close();
+		return false;
+	}
+
+	index = (const ColumnChunk*)(file.getData()+header->indexOffset);
+
+	// Each chunk holds 16 bytes per record.
+	for(uint32_t i = 0; i < header->numChunks; i++){
+		if(index[i].offset < sizeof(ColumnHeader) || index[i].offset > size || index[i].numRecords > (size-index[i].offset)/16){
+			file.close();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void ColumnReader::close(){
+	file.close();
+}
+
+const uint32_t *ColumnReader::getTime(const size_t &chunk_) const {
+	return (const uint32_t*)(file.getData()+index[chunk_].offset);
+}
+
+const float *ColumnReader::getTemperature(const size_t &chunk_) const {
+	return (const float*)(file.getData()+index[chunk_].offset+4*index[chunk_].numRecords);
+}
+
+const float *ColumnReader::getPressure(const size_t &chunk_) const {
+	return (const float*)(file.getData()+index[chunk_].offset+8*index[chunk_].numRecords);
+}
+
+const int16_t *ColumnReader::getRelay1(const size_t &chunk_) const {
+	return (const int16_t*)(file.getData()+index[chunk_].offset+12*index[chunk_].numRecords);
+}
+
+const int16_t *ColumnReader::getRelay2(const size_t &chunk_) const {
+	return (const int16_t*)(file.getData()+index[chunk_].offset+14*index[chunk_].numRecords);
+}
+
+// Return true if the temperature range does not exclude anything.
+static bool unbounded(const float &tempLow_, const float &tempHigh_){
+	return (std::isinf(tempLow_) && tempLow_ < 0 && std::isinf(tempHigh_) && tempHigh_ > 0);
+}
+
+bool ColumnReader::mayMatch(const size_t &chunk_, const uint32_t &timeLow_, const uint32_t &timeHigh_, const float &tempLow_, const float &tempHigh_) const {
+	const ColumnChunk &info = index[chunk_];
+	if(info.timeMax < timeLow_ || info.timeMin > timeHigh_){ return false; }
+	if(unbounded(tempLow_, tempHigh_)){ return true; }
+	if(std::isnan(info.tempMin)){ return false; } // No valid temperatures in chunk.
+	return !(info.tempMax < tempLow_ || info.tempMin > tempHigh_);
+}
+
+size_t ColumnReader::select(PacketColumns &cols_, const uint32_t &timeLow_, const uint32_t &timeHigh_, const float &tempLow_, const float &tempHigh_) const {
+	size_t numSkipped = 0;
+	for(size_t i = 0; i < header->numChunks; i++){
+		if(!mayMatch(i, timeLow_, timeHigh_, tempLow_, tempHigh_)){
+			numSkipped++;
+			continue;
+		}
+
+		const uint32_t *time = getTime(i);
+		const float *temp = getTemperature(i);
+		const float *pres = getPressure(i);
+		const int16_t *relay1 = getRelay1(i);
+		const int16_t *relay2 = getRelay2(i);
+
+		const ColumnChunk &info = index[i];
+		bool checkTemp = !unbounded(tempLow_, tempHigh_);
+		bool checkTime = (info.timeMin < timeLow_ || info.timeMax > timeHigh_);
+		for(size_t j = 0; j < info.numRecords; j++){
+			if(checkTime && (time[j] < timeLow_ || time[j] > timeHigh_)){ continue; }
+			if(checkTemp && !(temp[j] >= tempLow_ && temp[j] <= tempHigh_)){ continue; }
+			cols_.timestamp.push_back(time[j]);
+			cols_.temperature.push_back(temp[j]);
+			cols_.pressure.push_back(pres[j]);
+			cols_.relay1.push_back(relay1[j]);
+			cols_.relay2.push_back(relay2[j]);
+		}
+	}
+	return numSkipped;
+}
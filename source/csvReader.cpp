@@ -1,11 +1,237 @@
 #include <iostream>
 #include <fstream>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <charconv>
 #include <string.h>
 #include <stdlib.h>
 #include <sstream>
 
+#include "packetDecoder.hpp"
+
+// Size of the input block processed by each thread at a time (bytes).
+#define THREAD_BLOCK_SIZE 16777216
+
+// A line which was rejected or reported while processing a block.
+struct LineEvent{
+	size_t line; // Line number within the block.
+	const char *type;
+};
+
+// A newline aligned range of input lines and the corresponding output.
+class LineBlock{
+  public:
+	const char *begin;
+	const char *end;
+
+	size_t numLines;
+
+	std::vector<char> output;
+	std::vector<LineEvent> events;
+
+	LineBlock() : begin(NULL), end(NULL), numLines(0) { }
+
+	// Process all lines in the block.
+	void process();
+};
+
+void LineBlock::process(){
+	output.clear();
+	events.clear();
+	output.reserve((end-begin)+(end-begin)/4);
+
+	numLines = 0;
+	const char *ptr = begin;
+	while(ptr < end){
+		const char *eol = (const char*)memchr(ptr, '\n', end-ptr);
+		size_t len = eol-ptr;
+		numLines++;
+
+		if(memmem(ptr, len, "nan", 3)){
+			events.push_back({numLines, "nan"});
+		}
+		else if(memmem(ptr, len, "inf", 3)){
+			events.push_back({numLines, "inf"});
+		}
+		else{
+			// Read the time from the first column.
+			const char *comma = (const char*)memchr(ptr, ',', len);
+			size_t fieldLen = (comma ? comma-ptr : len);
+			char field[64];
+			if(fieldLen > 63){ fieldLen = 63; }
+			memcpy(field, ptr, fieldLen);
+			field[fieldLen] = '\0';
+			int msTime = atoi(field);
+
+			char seconds[16];
+			char *secondsEnd = std::to_chars(seconds, seconds+16, msTime/1000).ptr;
+
+			output.insert(output.end(), ptr, eol);
+			output.push_back(',');
+			output.insert(output.end(), seconds, secondsEnd);
+			output.push_back('\n');
+		}
+
+		ptr = eol+1;
+	}
+}
+
+// Return a pointer to the character following the first newline at or after ptr_.
+const char *nextLine(const char *ptr_, const char *end_){
+	const char *eol = (const char*)memchr(ptr_, '\n', end_-ptr_);
+	return (eol ? eol+1 : end_);
+}
+
+// Pool of persistent worker threads which process the newline aligned blocks of an input range. Each
+// worker takes the next block of the input, so blocks are claimed in order, and the output of each
+// block is handed back in order by next(). The workers keep processing the following blocks while the
+// output of a block is written. At most one block more than the number of workers is held at once.
+class BlockPool{
+  public:
+	BlockPool(const char *begin_, const char *end_, const unsigned int &numThreads_);
+
+	~BlockPool();
+
+	// Wait for the next block in input order. Return NULL once every block has been returned.
+	LineBlock *next();
+
+	// Release the block returned by next(), so that its slot may be used for a new block.
+	void release();
+
+  private:
+	const char *ptr; // Start of the next unclaimed block.
+	const char *end;
+
+	std::vector<LineBlock> slots;
+	std::vector<bool> done;
+	size_t numClaimed; // Number of blocks taken by the workers.
+	size_t numReleased; // Number of blocks released by the output thread.
+
+	std::mutex lock;
+	std::condition_variable slotFree;
+	std::condition_variable blockDone;
+
+	std::vector<std::thread> workers;
+
+	void work();
+};
+
+BlockPool::BlockPool(const char *begin_, const char *end_, const unsigned int &numThreads_) : ptr(begin_), end(end_), slots(numThreads_+1), done(numThreads_+1, false), numClaimed(0), numReleased(0) {
+	for(unsigned int i = 0; i < numThreads_; i++){
+		workers.push_back(std::thread(&BlockPool::work, this));
+	}
+}
+
+BlockPool::~BlockPool(){
+	for(size_t i = 0; i < workers.size(); i++){
+		workers[i].join();
+	}
+}
+
+LineBlock *BlockPool::next(){
+	std::unique_lock<std::mutex> guard(lock);
+	const size_t slot = numReleased%slots.size();
+	blockDone.wait(guard, [&](){ return done[slot] || (ptr >= end && numReleased == numClaimed); });
+	return (done[slot] ? &slots[slot] : NULL);
+}
+
+void BlockPool::release(){
+	std::lock_guard<std::mutex> guard(lock);
+	done[numReleased%slots.size()] = false;
+	numReleased++;
+	slotFree.notify_all();
+}
+
+void BlockPool::work(){
+	std::unique_lock<std::mutex> guard(lock);
+	while(true){
+		// Wait for a free slot, unless the whole input has been claimed.
+		slotFree.wait(guard, [&](){ return ptr >= end || numClaimed < numReleased+slots.size(); });
+		if(ptr >= end){ break; }
+
+		// Claim the next newline aligned block.
+		const size_t slot = numClaimed%slots.size();
+		LineBlock &block = slots[slot];
+		block.begin = ptr;
+		ptr = (size_t)(end-ptr) > THREAD_BLOCK_SIZE ? nextLine(ptr+THREAD_BLOCK_SIZE, end) : end;
+		block.end = ptr;
+		numClaimed++;
+		if(ptr >= end){ slotFree.notify_all(); } // Let the idle workers exit.
+
+		guard.unlock();
+		block.process();
+		guard.lock();
+
+		done[slot] = true;
+		blockDone.notify_all();
+	}
+
+	// Wake the output thread in case it is waiting for a block which will never come.
+	blockDone.notify_all();
+}
+
+// Process the input file by splitting it into newline aligned blocks which are processed in parallel.
+int processParallel(const char *fname_, const unsigned int &numThreads_){
+	MappedFile input;
+	if(!input.open(fname_)){
+		return 1;
+	}
+
+	std::ofstream output("tmp.dat", std::ios::binary);
+
+	const char *ptr = input.getData();
+	const char *end = ptr+input.getSize();
+
+	// Only complete lines are processed.
+	while(end > ptr && end[-1] != '\n'){ end--; }
+
+	// Replace the file header with a new one and skip the first line of data as it is usually junk.
+	size_t lineNumber = 0;
+	if(ptr < end){
+		output << "milliseconds,temperature,pressure,r1,r2,seconds\n";
+		ptr = nextLine(ptr, end);
+		lineNumber++;
+	}
+	if(ptr < end){
+		ptr = nextLine(ptr, end);
+		lineNumber++;
+	}
+
+	// Write the output of each block in order, while the workers process the following blocks.
+	BlockPool pool(ptr, end, numThreads_);
+	LineBlock *block;
+	while((block = pool.next())){
+		std::vector<LineEvent>::iterator iter = block->events.begin();
+		size_t nextPrint = (lineNumber/10000+1)*10000;
+		while(true){
+			size_t eventLine = (iter != block->events.end() ? lineNumber+iter->line : (size_t)-1);
+			if(nextPrint <= lineNumber+block->numLines && nextPrint <= eventLine){
+				std::cout << "  Line " << nextPrint << " of data file\n";
+				nextPrint += 10000;
+			}
+			else if(iter != block->events.end()){
+				std::cout << " Found " << iter->type << " on line " << eventLine << std::endl;
+				iter++;
+			}
+			else{ break; }
+		}
+
+		if(!block->output.empty()){ output.write(&block->output[0], block->output.size()); }
+		lineNumber += block->numLines;
+		pool.release();
+	}
+
+	output.close();
+
+	return 0;
+}
+
 void help(char * prog_name_){
-	std::cout << "  SYNTAX: " << prog_name_ << " <rawFile>\n";
+	std::cout << "  SYNTAX: " << prog_name_ << " <rawFile> [options]\n";
+	std::cout << "   Available options:\n";
+	std::cout << "    --threads <num> | Process the file in parallel using num threads (0 uses all cores).\n";
 }
 
 int main(int argc, char* argv[]){
@@ -18,6 +244,17 @@ int main(int argc, char* argv[]){
 		help(argv[0]);
 		return 1;
 	}
+	else if(argc > 2 && strcmp(argv[2], "--threads") == 0){
+		if(argc < 4){
+			std::cout << " Error! Missing required argument to '--threads'!\n";
+			help(argv[0]);
+			return 1;
+		}
+		int numThreads = atoi(argv[3]);
+		if(numThreads <= 0){ numThreads = std::thread::hardware_concurrency(); }
+		if(numThreads <= 0){ numThreads = 1; }
+		return processParallel(argv[1], numThreads);
+	}
 	
 	std::ifstream input(argv[1]);
 	if(!input.good()){
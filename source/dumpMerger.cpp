@@ -0,0 +1,223 @@
+#include <algorithm>
+#include <atomic>
+#include <queue>
+#include <thread>
+#include <string.h>
+#include <strings.h>
+#include <dirent.h>
+
+#include "dumpMerger.hpp"
+#include "packetCodec.hpp"
+
+bool decodeDataFile(const std::string &fname_, PacketColumns &cols_, char *title_, PacketFormat &format_, const bool &scalar_/*=false*/, const bool &resync_/*=false*/){
+	cols_.clear();
+	title_[0] = '\0';
+	format_ = FORMAT_UNKNOWN;
+
+	MappedFile file;
+	if(!file.open(fname_)){ return false; }
+
+	CodecReader compressed;
+	if(compressed.setInput(file.getData(), file.getSize())){
+		strcpy(title_, compressed.getTitle());
+		format_ = FORMAT_COMPRESSED;
+		while(compressed.decode(cols_)){ }
+		return true;
+	}
+
+	// Files which do not look framed are read with the legacy decoder.
+	size_t offset = readTitle(file.getData(), file.getSize(), title_, 64);
+	format_ = detectFormat(file.getData()+offset, file.getSize()-offset);
+	if(format_ != FORMAT_FRAMED){ format_ = FORMAT_LEGACY; }
+
+	if(format_ == FORMAT_FRAMED){
+		FrameDecoder frames;
+		frames.setInput(file.getData(), file.getSize(), offset);
+		cols_.reserve((file.getSize()-offset)/FRAME_MAX_LENGTH);
+		while(frames.decode(cols_)){ }
+		return true;
+	}
+
+	BatchDecoder decoder(file.getData(), file.getSize(), offset);
+	decoder.setScalar(scalar_ || !BatchDecoder::haveSIMD());
+	decoder.setResync(resync_);
+	cols_.reserve((file.getSize()-offset)/PACKET_LENGTH);
+	while(decoder.decode(cols_)){ }
+
+	// Remove the first legacy data entry, because it is usually junk.
+	if(cols_.size() > 0){
+		cols_.timestamp.erase(cols_.timestamp.begin());
+		cols_.temperature.erase(cols_.temperature.begin());
+		cols_.pressure.erase(cols_.pressure.begin());
+		cols_.relay1.erase(cols_.relay1.begin());
+		cols_.relay2.erase(cols_.relay2.begin());
+	}
+
+	return true;
+}
+
+// Compare filenames without case, because FAT file systems do not preserve it reliably.
+static bool lessNoCase(const std::string &a_, const std::string &b_){
+	return (strcasecmp(a_.c_str(), b_.c_str()) < 0);
+}
+
+// Return true if a filename has an extension of a data file written by the controller or loggerUnpacker.
+static bool isDataFile(const std::string &fname_){
+	if(fname_.size() < 4){ return false; }
+	const char *ext = fname_.c_str()+fname_.size()-4;
+	return (strcasecmp(ext, ".dat") == 0 || strcasecmp(ext, ".ovz") == 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// class DumpMerger
+///////////////////////////////////////////////////////////////////////////////
+
+DumpMerger::DumpMerger() : numPackets(0), scalar(false), resync(false) { }
+
+size_t DumpMerger::addDirectory(const std::string &dir_){
+	DIR *dir = opendir(dir_.c_str());
+	if(!dir){ return 0; }
+
+	std::vector<std::string> names;
+	struct dirent *entry;
+	while((entry = readdir(dir))){
+		if(entry->d_name[0] != '.' && isDataFile(entry->d_name)){ names.push_back(entry->d_name); }
+	}
+	closedir(dir);
+
+	// The firmware numbers the files in the order they were created.
+	std::sort(names.begin(), names.end(), lessNoCase);
+	for(std::vector<std::string>::iterator iter = names.begin(); iter != names.end(); iter++){
+		addFile(dir_ + "/" + *iter);
+	}
+
+	return names.size();
+}
+
+void DumpMerger::addFile(const std::string &fname_){
+	files.push_back(DumpFile());
+	DumpFile &file = files.back();
+	file.path = fname_;
+	file.title[0] = '\0';
+	file.format = FORMAT_UNKNOWN;
+	file.opened = false;
+	file.numWraps = 0;
+	file.numReboots = 0;
+	file.numOutOfOrder = 0;
+}
+
+size_t DumpMerger::decode(unsigned int numThreads_/*=0*/){
+	if(numThreads_ == 0){ numThreads_ = std::thread::hardware_concurrency(); }
+	if(numThreads_ == 0){ numThreads_ = 1; }
+	if(numThreads_ > files.size()){ numThreads_ = files.size(); }
+
+	// Each thread decodes the next file which has not been taken yet.
+	std::atomic<size_t> nextFile(0);
+	std::vector<std::thread> threads;
+	for(unsigned int i = 0; i < numThreads_; i++){
+		threads.push_back(std::thread([&](){
+			size_t index;
+			while((index = nextFile++) < files.size()){
+				DumpFile &file = files[index];
+				file.opened = decodeDataFile(file.path, file.cols, file.title, file.format, scalar, resync);
+			}
+		}));
+	}
+	for(size_t i = 0; i < threads.size(); i++){ threads[i].join(); }
+
+	buildTimeline();
+
+	return numPackets;
+}
+
+void DumpMerger::buildTimeline(){
+	segments.clear();
+	numPackets = 0;
+
+	bool haveTime = false;
+	uint32_t prevTime = 0;
+	const char *prevTitle = "";
+	uint64_t offset = 0;
+	uint64_t endTime = 0; // Latest merged time so far.
+	for(size_t index = 0; index < files.size(); index++){
+		DumpFile &file = files[index];
+		const PacketColumns &cols = file.cols;
+		const size_t N = cols.size();
+		file.numWraps = 0;
+		file.numReboots = 0;
+		file.numOutOfOrder = 0;
+
+		size_t begin = 0;
+		for(size_t i = 0; i < N; i++){
+			const uint32_t timestamp = cols.timestamp[i];
+			uint64_t next = offset;
+			bool split = false;
+			if(haveTime && (timestamp < prevTime || (i == 0 && strcmp(file.title, prevTitle) != 0))){
+				split = true;
+				if(i == 0 && strcmp(file.title, prevTitle) != 0){ // New firmware, so the controller was rebooted.
+					next = endTime+1;
+					file.numReboots++;
+				}
+				else if((uint32_t)(timestamp-prevTime) <= DUMP_MAX_WRAP_GAP){ // Wrapped around.
+					next = offset+(1ULL << 32);
+					file.numWraps++;
+				}
+				else if(i == 0){ // The controller only starts a new file after a reboot or a card swap.
+					next = endTime+1;
+					file.numReboots++;
+				}
+				else{ // Out of order packet (e.g. a corrupt timestamp) on the same clock.
+					file.numOutOfOrder++;
+				}
+			}
+
+			// Start a new segment, so that every segment is in time order.
+			if(split){
+				if(i > begin){ segments.push_back({index, begin, i, offset}); }
+				begin = i;
+				offset = next;
+			}
+
+			if(offset+timestamp > endTime){ endTime = offset+timestamp; }
+			prevTime = timestamp;
+			haveTime = true;
+		}
+		if(N > begin){ segments.push_back({index, begin, N, offset}); }
+		if(N > 0){ prevTitle = file.title; }
+		numPackets += N;
+	}
+}
+
+size_t DumpMerger::merge(CsvWriter &writer_) const {
+	// Min-heap of the merged time of the next packet of each segment. Ties are taken in file order.
+	typedef std::pair<uint64_t, size_t> MergeEntry;
+	std::priority_queue<MergeEntry, std::vector<MergeEntry>, std::greater<MergeEntry> > heap;
+	std::vector<size_t> next(segments.size());
+	for(size_t i = 0; i < segments.size(); i++){
+		next[i] = segments[i].begin;
+		heap.push(MergeEntry(segments[i].offset+files[segments[i].file].cols.timestamp[next[i]], i));
+	}
+
+	size_t count = 0;
+	while(!heap.empty()){
+		const size_t index = heap.top().second;
+		heap.pop();
+
+		// Write packets from this segment until another segment has an earlier packet.
+		const DumpSegment &segment = segments[index];
+		const PacketColumns &cols = files[segment.file].cols;
+		const uint64_t limit = (heap.empty() ? UINT64_MAX : heap.top().first);
+		size_t i = next[index];
+		do{
+			writer_.addPacket(segment.offset+cols.timestamp[i], cols.temperature[i], calibratePressure(cols.pressure[i]), cols.relay1[i], cols.relay2[i]);
+			writer_.endRow();
+			i++;
+		} while(i < segment.end && segment.offset+cols.timestamp[i] < limit);
+		count += i-next[index];
+		next[index] = i;
+
+		if(i < segment.end){ heap.push(MergeEntry(segment.offset+cols.timestamp[i], index)); }
+	}
+
+	return count;
+}
@@ -0,0 +1,219 @@
+#include "frameDecoder.hpp"
+#include "sensorConvert.h"
+
+#include <cmath>
+#include <algorithm>
+
+PacketFormat detectFormat(const char *data_, const size_t &len_){
+	const size_t len = (len_ < FORMAT_DETECT_LENGTH ? len_ : FORMAT_DETECT_LENGTH);
+	unsigned int word;
+
+	// Legacy files start with a delimiter after the title.
+	if(len >= 4){
+		memcpy((char*)&word, data_, 4);
+		if(word == PACKET_DELIMITER){ return FORMAT_LEGACY; }
+	}
+
+	// Search for a valid frame.
+	FrameDecoder frames;
+	PacketColumns cols;
+	if(frames.decode(data_, len, cols) > 0){ return FORMAT_FRAMED; }
+
+	// Search for two consecutive legacy packets.
+	unsigned int next;
+	for(size_t i = 0; i+PACKET_LENGTH+4 <= len; i++){
+		memcpy((char*)&word, &data_[i], 4);
+		memcpy((char*)&next, &data_[i+PACKET_LENGTH], 4);
+		if(word == PACKET_DELIMITER && next == PACKET_DELIMITER){ return FORMAT_LEGACY; }
+	}
+
+	return FORMAT_UNKNOWN;
+}
+
+const char *getFormatName(const PacketFormat &format_){
+	if(format_ == FORMAT_LEGACY){ return "legacy"; }
+	else if(format_ == FORMAT_FRAMED){ return "framed"; }
+	else if(format_ == FORMAT_COMPRESSED){ return "compressed"; }
+	return "unknown";
+}
+
+size_t encodePacket(const PacketFormat &format_, char *out_, const uint32_t &sequence_, const unsigned int &timestamp_, const float &temperature_, const float &pressure_, const short &relay1_, const short &relay2_, const bool &compact_/*=false*/){
+	if(format_ == FORMAT_FRAMED && compact_){
+		int16_t quarters = TEMP_INVALID;
+		if(std::isfinite(temperature_)){ quarters = (int16_t)std::max(-32767.0, std::min(32767.0, std::floor(4.0*temperature_+0.5))); }
+		double counts = (std::isfinite(pressure_) ? std::floor(pressure_*(ADC_FULL_SCALE*PRESSURE_OVERSAMPLE)/ADC_REFERENCE+0.5) : 0);
+		return buildCompactFrame((uint8_t*)out_, sequence_, timestamp_, quarters, (uint16_t)std::max(0.0, std::min(65535.0, counts)), relay1_, relay2_);
+	}
+	else if(format_ == FORMAT_FRAMED){
+		return buildFrame((uint8_t*)out_, sequence_, timestamp_, temperature_, pressure_, relay1_, relay2_);
+	}
+	packPacket(out_, timestamp_, temperature_, pressure_, relay1_, relay2_);
+	return PACKET_LENGTH;
+}
+
+size_t encodeHeader(const PacketFormat &format_, char *out_, const char *title_/*=DEFAULT_TITLE*/){
+	out_[0] = TITLE_LENGTH;
+	memset(&out_[1], 0, TITLE_LENGTH);
+	strncpy(&out_[1], title_, TITLE_LENGTH-1);
+	if(format_ == FORMAT_FRAMED){
+		out_[TITLE_LENGTH+1] = FRAME_DELIMITER;
+		return TITLE_LENGTH+2;
+	}
+	const unsigned int delimiter = PACKET_DELIMITER;
+	memcpy(&out_[TITLE_LENGTH+1], (const char*)&delimiter, 4);
+	return TITLE_LENGTH+5;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// class FrameDecoder
+///////////////////////////////////////////////////////////////////////////////
+
+FrameDecoder::FrameDecoder() : data(NULL), length(0), offset(0), timing(NULL), numDecoded(0), numTiming(0), numCorrupt(0), numLost(0), numResets(0), numDuplicates(0), numDiscarded(0) {
+	reset();
+}
+
+void FrameDecoder::setInput(const char *data_, const size_t &len_, const size_t &offset_/*=0*/){
+	data = data_;
+	length = (data_ ? len_ : 0);
+	offset = offset_;
+}
+
+size_t FrameDecoder::decode(PacketColumns &cols_, const size_t &N_/*=PACKET_BLOCK_SIZE*/){
+	size_t count = 0;
+	while(count == 0 && !eof()){
+		size_t len = N_*FRAME_MAX_LENGTH;
+		if(len > length-offset){ len = length-offset; }
+		count = decode(&data[offset], len, cols_);
+		offset += len;
+	}
+	return count;
+}
+
+size_t FrameDecoder::decode(const char *data_, const size_t &len_, PacketColumns &cols_){
+	const size_t start = cols_.size();
+	size_t count = 0;
+	const char *ptr = data_;
+	const char *end = data_+len_;
+	while(ptr < end){
+		// Find the end of the current frame.
+		const char *stop = (const char*)memchr(ptr, FRAME_DELIMITER, end-ptr);
+		size_t len = (stop ? stop : end)-ptr;
+
+		if(!synced){ // Discard everything up to the first delimiter.
+			numDiscarded += len;
+		}
+		else if(fill+len > FRAME_TIMING_MAX_LENGTH){ // Too long to be a frame.
+			overflow = true;
+			fill = 0;
+		}
+		else{
+			memcpy(&frame[fill], ptr, len);
+			fill += len;
+		}
+
+		if(!stop){
+			pending += len;
+			break;
+		}
+		ptr = stop+1;
+		pending = 0;
+
+		// End of a frame.
+		if(synced && (fill > 0 || overflow)){
+			if(overflow){ numCorrupt++; }
+			else if(decodeFrame(cols_)){ count = cols_.size()-start; }
+			else if(!decodeTiming()){ numCorrupt++; }
+		}
+		synced = true;
+		fill = 0;
+		overflow = false;
+	}
+	return count;
+}
+
+void FrameDecoder::reset(){
+	fill = 0;
+	pending = 0;
+	overflow = false;
+	synced = false;
+	lastSequence = 0;
+	haveSequence = false;
+}
+
+void FrameDecoder::resume(const bool &synced_, const bool &haveSequence_, const uint32_t &sequence_){
+	reset();
+	synced = synced_;
+	haveSequence = haveSequence_;
+	lastSequence = sequence_;
+}
+
+bool FrameDecoder::decodeFrame(PacketColumns &cols_){
+	uint8_t contents[FRAME_DECODED_LENGTH];
+	size_t len = cobsDecode(frame, fill, contents, FRAME_DECODED_LENGTH);
+
+	// Full frames hold the calibrated readings, and compact frames the fixed-point readings.
+	size_t payload;
+	if(len == FRAME_DECODED_LENGTH && contents[0] == FRAME_VERSION){ payload = FRAME_PAYLOAD_LENGTH; }
+	else if(len == FRAME_COMPACT_DECODED_LENGTH && contents[0] == FRAME_COMPACT_VERSION){ payload = FRAME_COMPACT_PAYLOAD_LENGTH; }
+	else{ return false; }
+
+	uint16_t crc;
+	memcpy((char*)&crc, &contents[payload], 2);
+	if(crc != frameCrc16(contents, payload)){ return false; }
+
+	uint32_t sequence;
+	memcpy((char*)&sequence, &contents[1], 4);
+	if(haveSequence){
+		if(sequence == lastSequence){ // The same frame was received twice.
+			numDuplicates++;
+			return true;
+		}
+		else if(sequence > lastSequence){ numLost += sequence-lastSequence-1; }
+		else{ numResets++; }
+	}
+	lastSequence = sequence;
+	haveSequence = true;
+
+	size_t index = cols_.size();
+	cols_.resize(index+1);
+	memcpy((char*)&cols_.timestamp[index], &contents[5], 4);
+	if(contents[0] == FRAME_VERSION){
+		memcpy((char*)&cols_.temperature[index], &contents[9], 4);
+		memcpy((char*)&cols_.pressure[index], &contents[13], 4);
+		memcpy((char*)&cols_.relay1[index], &contents[17], 2);
+		memcpy((char*)&cols_.relay2[index], &contents[19], 2);
+	}
+	else{ // Apply the calibration to the fixed-point readings.
+		int16_t quarters;
+		uint16_t counts;
+		memcpy((char*)&quarters, &contents[9], 2);
+		memcpy((char*)&counts, &contents[11], 2);
+		cols_.temperature[index] = quartersToCelsius(quarters);
+		cols_.pressure[index] = countsToVolts(counts);
+		cols_.relay1[index] = contents[13] & 0x01;
+		cols_.relay2[index] = (contents[13] >> 1) & 0x01;
+	}
+	numDecoded++;
+
+	return true;
+}
+
+bool FrameDecoder::decodeTiming(){
+	uint8_t contents[FRAME_TIMING_DECODED_LENGTH];
+	if(cobsDecode(frame, fill, contents, FRAME_TIMING_DECODED_LENGTH) != FRAME_TIMING_DECODED_LENGTH){ return false; }
+	if(contents[0] != FRAME_TIMING){ return false; }
+
+	uint16_t crc;
+	memcpy((char*)&crc, &contents[FRAME_TIMING_PAYLOAD_LENGTH], 2);
+	if(crc != frameCrc16(contents, FRAME_TIMING_PAYLOAD_LENGTH)){ return false; }
+
+	if(timing){
+		TimingRecord record;
+		memcpy((char*)&record.timestamp, &contents[1], 4);
+		memcpy((char*)record.stages, &contents[5], 4*FRAME_TIMING_STAGES);
+		timing->push_back(record);
+	}
+	numTiming++;
+
+	return true;
+}
@@ -0,0 +1,61 @@
+#include <iomanip>
+
+#include "latencyHistogram.hpp"
+
+LatencyHistogram::LatencyHistogram(const std::string &units_/*="us"*/) : units(units_) {
+	clear();
+}
+
+void LatencyHistogram::fill(const unsigned long &value_){
+	unsigned int bin = 0;
+	unsigned long value = value_;
+	while(value > 0 && bin < LATENCY_BINS-1){
+		value >>= 1;
+		bin++;
+	}
+	bins[bin]++;
+
+	if(count == 0 || value_ < minimum){ minimum = value_; }
+	if(count == 0 || value_ > maximum){ maximum = value_; }
+	total += value_;
+	count++;
+}
+
+void LatencyHistogram::clear(){
+	for(unsigned int i = 0; i < LATENCY_BINS; i++){ bins[i] = 0; }
+	count = 0;
+	total = 0;
+	minimum = 0;
+	maximum = 0;
+}
+
+unsigned long LatencyHistogram::getQuantile(const double &frac_) const {
+	unsigned long target = (unsigned long)(frac_*count+0.5);
+	unsigned long sum = 0;
+	for(unsigned int i = 0; i < LATENCY_BINS; i++){
+		sum += bins[i];
+		if(sum >= target && sum > 0){ return (i == 0 ? 0 : (1UL << i)-1); }
+	}
+	return maximum;
+}
+
+void LatencyHistogram::print(std::ostream &out_/*=std::cout*/, const std::string &prefix_/*="  "*/) const {
+	if(count == 0){
+		out_ << prefix_ << "No entries.\n";
+		return;
+	}
+
+	out_ << prefix_ << "N=" << count << ", min=" << minimum << " " << units << ", mean=" << getMean() << " " << units;
+	out_ << ", p50<=" << getQuantile(0.5) << " " << units << ", p99<=" << getQuantile(0.99) << " " << units;
+	out_ << ", max=" << maximum << " " << units << "\n";
+
+	for(unsigned int i = 0; i < LATENCY_BINS; i++){
+		if(bins[i] == 0){ continue; }
+		unsigned long low = (i == 0 ? 0 : 1UL << (i-1));
+		unsigned long high = (i == 0 ? 1 : 1UL << i);
+		out_ << prefix_ << " [" << std::setw(10) << low << ", " << std::setw(10) << high << ") " << units << " ";
+		out_ << std::setw(10) << bins[i] << " (" << std::fixed << std::setprecision(2) << 100.0*bins[i]/count << "%)\n";
+		out_.unsetf(std::ios::fixed);
+		out_ << std::setprecision(6);
+	}
+}
@@ -1,6 +1,5 @@
 #include <iostream>
 #include <fstream>
-#include <deque>
 #include <string.h>
 #include <cmath>
 #include <stdio.h>
@@ -10,12 +9,31 @@
 
 #include <signal.h>
 #include <stdexcept>
+#include <chrono>
+#include <sys/stat.h>
 
 #include "wiringSerial.h"
+#include "packetDecoder.hpp"
+#include "frameDecoder.hpp"
+#include "serialBuffer.hpp"
+#include "latencyHistogram.hpp"
+#include "stageTiming.hpp"
+#include "autoBaud.hpp"
+#include "packetFormat.hpp"
+#include "columnStore.hpp"
+#include "timeIndex.hpp"
+#include "telemetryRing.hpp"
+#include "packetCodec.hpp"
+#include "dumpMerger.hpp"
+#include "checkpoint.hpp"
+#include "windowStats.hpp"
+
+// Maximum time to sleep while waiting for serial data (ms).
+#define SERIAL_TIMEOUT 500
+
+// Maximum number of skipped regions to print in resync mode.
+#define MAX_PRINTED_REGIONS 10
 
-#define RPRIME 0.5004367
-
-unsigned int delimiter;
 unsigned int timestamp;
 float temperature;
 float pressure;
@@ -38,22 +56,6 @@ void setup_signal_handlers(){
 	}
 }
 
-char readTitle(std::ifstream *f_, char *buf_, const char &len_){
-	if(!f_){ return 0; }
-
-	char titleLen;
-	f_->read(&titleLen, 1);
-
-	if(titleLen > len_){
-		titleLen = len_;
-		f_->read(buf_, len_-1);
-		buf_[len_-1] = '\0';
-		return len_;
-	}
-	f_->read(buf_, titleLen);
-	return titleLen;
-}
-
 size_t serialGets(const int &fd_, char *buf_, const size_t &len_){
 	int numBytes = read(fd_, buf_, len_-1);
 	if(numBytes >= 0){ buf_[len_-1] = '\0'; }
@@ -64,88 +66,136 @@ size_t serialRead(const int &fd_, char *val_, const size_t &len_){
 	return read(fd_, val_, len_);
 }
 
-size_t serialRead(const int &fd_, std::deque<char> &data_, const size_t &len_){
-	char dummy;
-	size_t values = 0;
-	for(size_t i = 0; i < len_; i++){
-		if(read(fd_, &dummy, 1) == 1){ 
-			data_.push_back(dummy); 
-			values++;
-		}
+void replaceChar(char *str_, const size_t &len_, const char &c1_, const char &c2_){
+	for(size_t index = 0; index < len_; index++){
+		if(str_[index] == c1_){ str_[index] = c2_; }
 	}
-	return values;
 }
 
-void getDataWord(const std::deque<char> &data_, const size_t &offset_, char *val_, const size_t &len_=4){
-	if(offset_+len_ > data_.size()){ return; }
-	
-	char temp[len_];
-	for(size_t i = 0; i < len_; i++){
-		temp[i] = data_[offset_+i];
-	}
-	memcpy(val_, temp, len_);
+// Copy a single decoded packet into the global packet variables.
+void readRow(const PacketColumns &cols_, size_t &row_){
+	timestamp = cols_.timestamp[row_];
+	temperature = cols_.temperature[row_];
+	pressure = cols_.pressure[row_];
+	relay1 = cols_.relay1[row_];
+	relay2 = cols_.relay2[row_];
+	row_++;
 }
 
-void popQueue(std::deque<char> &data_, const size_t &len_){
-	size_t count = 0;
-	while(!data_.empty() && count < len_){
-		data_.pop_front();
-		count++;
+// Print the frame and loss counts of the framed packet decoder, and the firmware stage times of any
+// timing frames.
+void printFrameStats(const FrameDecoder &frames_, const StageTiming &timing_){
+	std::cout << "  Decoded " << frames_.getNumDecoded() << " frames, lost " << frames_.getNumLost() << " frames (" << frames_.getNumCorrupt() << " corrupt)";
+	if(frames_.getNumResets() > 0){ std::cout << ", sequence reset " << frames_.getNumResets() << " times"; }
+	if(frames_.getNumDuplicates() > 0){ std::cout << ", skipped " << frames_.getNumDuplicates() << " repeated frames"; }
+	std::cout << ".\n";
+	if(frames_.getNumTiming() > 0){
+		std::cout << "  Firmware stage times from " << frames_.getNumTiming() << " timing frames (longest time between packets):\n";
+		timing_.print(std::cout, "   ");
 	}
 }
 
-void replaceChar(char *str_, const size_t &len_, const char &c1_, const char &c2_){
-	for(size_t index = 0; index < len_; index++){
-		if(str_[index] == c1_){ str_[index] = c2_; }
+// Decode every data file in an SD card dump directory in parallel and write all packets to a
+// single output file in time order.
+int unpackDirectory(const std::string &dir_, const std::string &ofname_, const unsigned int &numThreads_, const bool &scalar_, const bool &resync_){
+	DumpMerger merger;
+	merger.setScalar(scalar_);
+	merger.setResync(resync_);
+	if(merger.addDirectory(dir_) == 0){
+		std::cout << " ERROR: No data files found in directory '" << dir_ << "'!\n";
+		return 1;
+	}
+
+	std::ofstream output(ofname_.c_str(), std::ios::binary);
+	if(!output.is_open()){
+		std::cout << " ERROR: Failed to open output file '" << ofname_ << "'!\n";
+		return 1;
 	}
-}
 
-// Return the order of magnitude of a number
-float getOrder(const float &input_, int &power){
-	float test = 1E-10;
-	for(int i = -10; i < 10; i++){
-		if(input_/test <= 1){ 
-			power = i;
-			return test; 
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	merger.decode(numThreads_);
+	std::chrono::duration<double> decodeTime = std::chrono::steady_clock::now()-start;
+
+	const std::vector<DumpFile> &files = merger.getFiles();
+	for(std::vector<DumpFile>::const_iterator iter = files.begin(); iter != files.end(); iter++){
+		std::cout << "  " << iter->path.substr(iter->path.find_last_of('/')+1) << ": ";
+		if(!iter->opened){
+			std::cout << "failed to open!\n";
+			continue;
 		}
-		test *= 10.0;
+		std::cout << iter->cols.size() << " " << getFormatName(iter->format) << " packets, title: " << iter->title;
+		if(iter->numReboots > 0){ std::cout << ", " << iter->numReboots << " reboots"; }
+		if(iter->numWraps > 0){ std::cout << ", " << iter->numWraps << " millis() wraparounds"; }
+		if(iter->numOutOfOrder > 0){ std::cout << ", " << iter->numOutOfOrder << " out of order packets"; }
+		std::cout << "\n";
 	}
-	return 1.0;
+
+	output << "time(ms),T(C),P(Torr),R1,R2\n";
+	CsvWriter writer(&output);
+	size_t count = merger.merge(writer);
+	writer.flush();
+	output.close();
+
+	std::cout << "\n Done! Read " << count << " data entries from " << files.size() << " files.\n";
+	std::cout << "  Decoded " << merger.getNumPackets() << " packets in " << decodeTime.count() << " s";
+	if(decodeTime.count() > 0){ std::cout << " (" << merger.getNumPackets()/decodeTime.count() << " packets/s)"; }
+	std::cout << ", merged " << merger.getSegments().size() << " time segments.\n";
+	std::cout << "  Wrote output file '" << ofname_ << "'\n";
+
+	return 0;
 }
 
-// Return a scientific notation representation of an input number.
-std::string sciNotation(const float &input_, const size_t &N_=2){
-	int power = 0;
-	double order = getOrder(input_, power);
-	
-	std::stringstream stream;
-	stream << 10*input_/order;
-	
-	// Limit to N_ decimal places due to space constraints
-	std::string output = stream.str();
-	size_t find_index = output.find('.');
-	if(find_index != std::string::npos){
-		std::string temp;
-		temp = output.substr(0, find_index);
-		temp += output.substr(find_index, N_+1);
-		output = temp;
+// Load the checkpoint of an earlier follow mode run and extend its outputs in place. Return true if
+// the run may resume from the checkpoint, or false to start again from the beginning of the input.
+bool resumeCheckpoint(Checkpoint &ckp_, const std::string &ckpname_, const MappedFile &file_, const PacketFormat &format_, const std::string &ofname_, 
+                      const std::string &colname_, ColumnWriter &colfile_, const std::string &cmpname_, CodecWriter &codec_){
+	if(!ckp_.load(ckpname_, file_.getData(), file_.getSize())){
+		std::cout << " No checkpoint '" << ckpname_ << "' for this input file, reading from the start.\n";
+		return false;
 	}
 
-	std::stringstream stream2;
-	stream2 << output << "E" << power-1; 
-	output = stream2.str();
+	std::string mismatch;
+	if(ckp_.header.format != format_){ mismatch = "input file"; }
+	else if(!Checkpoint::truncateOutput(ofname_, ckp_.header.outputSize[0])){ mismatch = "output file '"+ofname_+"'"; }
+	else if(!colname_.empty() && (!colfile_.append(colname_) || colfile_.getNumRecords() != ckp_.header.numRecords)){ mismatch = "column file '"+colname_+"'"; }
+	else if(!cmpname_.empty() && (!codec_.append(cmpname_) || codec_.getNumRecords() != ckp_.header.numRecords)){ mismatch = "compressed file '"+cmpname_+"'"; }
+
+	if(!mismatch.empty()){
+		std::cout << " Warning! The " << mismatch << " does not match checkpoint '" << ckpname_ << "', reading from the start.\n";
+		ckp_.reset();
+		return false;
+	}
 
-	return output;
+	return true;
 }
 
 void help(char * prog_name_){
 	std::cout << "  SYNTAX: " << prog_name_ << " <filename> [options] [output]\n";
+	std::cout << "          " << prog_name_ << " <directory> [--threads <num>] [--scalar] [--resync] [output]\n";
+	std::cout << "   A directory is read as an SD card dump, all DAT files are decoded in parallel and merged by time.\n";
 	std::cout << "   Available options:\n";
 	std::cout << "    --print       | Print unpacked data to stdout.\n";
 	std::cout << "    --serial      | Read data from a serial port.\n";
 	std::cout << "    --ascii       | Read ascii from the serial port.\n";
 	std::cout << "    --ping <num>  | Ping serial port and display readings.\n";
 	std::cout << "    --time <time> | Read up until a maximum time (in seconds).\n";
+	std::cout << "    --from <time> | Start reading at a minimum time (in seconds) using the sidecar time index.\n";
+	std::cout << "    --to <time>   | Same as --time.\n";
+	std::cout << "    --index       | Rebuild the sidecar time index of the input file.\n";
+	std::cout << "    --scalar      | Do not use the SIMD packet decoder.\n";
+	std::cout << "    --resync      | Resynchronize on corrupted data at byte granularity, skipping implausible packets.\n";
+	std::cout << "    --baud <rate> | Serial port baud rate, any rate supported by the port or 'auto' to detect it (default=" << DEFAULT_BAUD << ").\n";
+	std::cout << "    --host-time   | Add the host arrival time (ms since epoch) of serial packets to the output.\n";
+	std::cout << "    --follow      | Only decode packets appended since the last run and extend the outputs in place.\n";
+	std::cout << "    --threads <num>       | Number of threads used to decode a directory (default=0, all cores).\n";
+	std::cout << "    --checkpoint <filename> | Checkpoint file used in follow mode (default=<output>.ckp).\n";
+	std::cout << "    --columnar <filename> | Also write the data to a memory mappable column file.\n";
+	std::cout << "    --compress <filename> | Also write the raw packets to a compressed file, which may be read back as the input file.\n";
+	std::cout << "    --stats <filename>    | Write window statistics (T, P, relay duty cycles, time above --max-temp) to a table.\n";
+	std::cout << "    --window <time>       | Length of each statistics window (in seconds, default=" << STATS_WINDOW << ").\n";
+	std::cout << "    --slide <time>        | Time between statistics windows (in seconds, default=window length).\n";
+	std::cout << "    --max-temp <temp>     | Temperature limit for the statistics (in C, default=" << STATS_MAX_TEMP << ").\n";
+	std::cout << "    --publish <name>      | Publish serial packets to a shared memory telemetry ring (see telemetryReader).\n";
 }
 
 int main(int argc, char *argv[]){
@@ -157,15 +207,41 @@ int main(int argc, char *argv[]){
 	
 	std::string ifname = std::string(argv[1]);
 	std::string ofname; 
+	std::string colname;
+	std::string shmname;
+	std::string cmpname;
+	std::string ckpname;
+	std::string statname;
 	
 	bool serial_mode = false;
 	bool ascii_mode = false;
 	bool ping_mode = false;
 	bool printout = false;
+	bool scalar_mode = false;
+	bool host_time = false;
+	bool auto_baud = false;
+	bool build_index = false;
+	bool resync_mode = false;
+	bool dir_mode = false;
+	bool follow_mode = false;
 	int num_ping = -1;
+	int num_threads = 0;
 	int max_time = -1;
+	int min_time = -1;
+	int baud = DEFAULT_BAUD;
+	double window_len = STATS_WINDOW;
+	double slide_len = 0;
+	double max_temp = STATS_MAX_TEMP;
 	
-	if(ifname.find("/dev/") == std::string::npos){
+	// Serial ports are character devices, including links to them (e.g. made by ovenSimulator --link).
+	struct stat inputStat;
+	bool haveStat = (stat(ifname.c_str(), &inputStat) == 0);
+	if(haveStat && S_ISDIR(inputStat.st_mode)){
+		while(ifname.size() > 1 && ifname[ifname.size()-1] == '/'){ ifname.erase(ifname.size()-1); }
+		ofname = ifname+".csv";
+		dir_mode = true;
+	}
+	else if(haveStat ? !S_ISCHR(inputStat.st_mode) : ifname.find("/dev/") == std::string::npos){
 		ofname = ifname.substr(0, ifname.find_last_of('.'))+".csv";
 	}
 	else{
@@ -207,9 +283,9 @@ int main(int argc, char *argv[]){
 			}
 			std::cout << "--Pinging device " << num_ping << " times.--\n";
 		}
-		else if(strcmp(argv[index], "--time") == 0){
+		else if(strcmp(argv[index], "--time") == 0 || strcmp(argv[index], "--to") == 0){
 			if(index + 1 >= argc){
-				std::cout << " Error! Missing required argument to '--time'!\n";
+				std::cout << " Error! Missing required argument to '" << argv[index] << "'!\n";
 				help(argv[0]);
 				return 1;
 			}
@@ -220,77 +296,383 @@ int main(int argc, char *argv[]){
 			}
 			std::cout << " Reading up to maximum data time of " << max_time << " seconds.\n";
 		}
+		else if(strcmp(argv[index], "--from") == 0){
+			if(serial_mode){
+				std::cout << " Error! May only use a minimum time with an input file.\n";
+				return 1;
+			}
+			else if(index + 1 >= argc){
+				std::cout << " Error! Missing required argument to '--from'!\n";
+				help(argv[0]);
+				return 1;
+			}
+			min_time = atoi(argv[++index]);
+			if(min_time < 0){
+				std::cout << " Error! Minimum read time may not be negative!\n";
+				return 1;
+			}
+			std::cout << " Reading from minimum data time of " << min_time << " seconds.\n";
+		}
+		else if(strcmp(argv[index], "--index") == 0){
+			if(serial_mode){
+				std::cout << " Error! May only build a time index for an input file.\n";
+				return 1;
+			}
+			build_index = true;
+		}
+		else if(strcmp(argv[index], "--scalar") == 0){
+			scalar_mode = true;
+		}
+		else if(strcmp(argv[index], "--resync") == 0){
+			if(serial_mode){
+				std::cout << " Error! May only use resync mode with an input file.\n";
+				return 1;
+			}
+			resync_mode = true;
+		}
+		else if(strcmp(argv[index], "--columnar") == 0){
+			if(index + 1 >= argc){
+				std::cout << " Error! Missing required argument to '--columnar'!\n";
+				help(argv[0]);
+				return 1;
+			}
+			colname = std::string(argv[++index]);
+		}
+		else if(strcmp(argv[index], "--compress") == 0){
+			if(index + 1 >= argc){
+				std::cout << " Error! Missing required argument to '--compress'!\n";
+				help(argv[0]);
+				return 1;
+			}
+			cmpname = std::string(argv[++index]);
+		}
+		else if(strcmp(argv[index], "--host-time") == 0){
+			if(!serial_mode){
+				std::cout << " Error! May only use host time with serial port.\n";
+				return 1;
+			}
+			host_time = true;
+		}
+		else if(strcmp(argv[index], "--baud") == 0){
+			if(index + 1 >= argc){
+				std::cout << " Error! Missing required argument to '--baud'!\n";
+				help(argv[0]);
+				return 1;
+			}
+			if(!serial_mode){
+				std::cout << " Error! May only set the baud rate of a serial port.\n";
+				return 1;
+			}
+			index++;
+			if(strcmp(argv[index], "auto") == 0){ auto_baud = true; }
+			else if((baud = atoi(argv[index])) <= 0){
+				std::cout << " Error! Baud rate must be greater than zero!\n";
+				return 1;
+			}
+		}
+		else if(strcmp(argv[index], "--follow") == 0){
+			if(serial_mode || dir_mode){
+				std::cout << " Error! May only use follow mode with an input file.\n";
+				return 1;
+			}
+			follow_mode = true;
+		}
+		else if(strcmp(argv[index], "--checkpoint") == 0){
+			if(index + 1 >= argc){
+				std::cout << " Error! Missing required argument to '--checkpoint'!\n";
+				help(argv[0]);
+				return 1;
+			}
+			ckpname = std::string(argv[++index]);
+		}
+		else if(strcmp(argv[index], "--stats") == 0){
+			if(index + 1 >= argc){
+				std::cout << " Error! Missing required argument to '--stats'!\n";
+				help(argv[0]);
+				return 1;
+			}
+			statname = std::string(argv[++index]);
+		}
+		else if(strcmp(argv[index], "--window") == 0 || strcmp(argv[index], "--slide") == 0 || strcmp(argv[index], "--max-temp") == 0){
+			if(index + 1 >= argc){
+				std::cout << " Error! Missing required argument to '" << argv[index] << "'!\n";
+				help(argv[0]);
+				return 1;
+			}
+			if(strcmp(argv[index], "--window") == 0){ window_len = atof(argv[++index]); }
+			else if(strcmp(argv[index], "--slide") == 0){ slide_len = atof(argv[++index]); }
+			else{ max_temp = atof(argv[++index]); }
+		}
+		else if(strcmp(argv[index], "--threads") == 0){
+			if(!dir_mode){
+				std::cout << " Error! May only use multiple threads with an input directory.\n";
+				return 1;
+			}
+			else if(index + 1 >= argc){
+				std::cout << " Error! Missing required argument to '--threads'!\n";
+				help(argv[0]);
+				return 1;
+			}
+			num_threads = atoi(argv[++index]);
+			if(num_threads < 0){
+				std::cout << " Error! Number of threads may not be negative!\n";
+				return 1;
+			}
+		}
+		else if(strcmp(argv[index], "--publish") == 0){
+			if(!serial_mode){
+				std::cout << " Error! May only publish packets from a serial port.\n";
+				return 1;
+			}
+			else if(index + 1 >= argc){
+				std::cout << " Error! Missing required argument to '--publish'!\n";
+				help(argv[0]);
+				return 1;
+			}
+			shmname = std::string(argv[++index]);
+		}
 		else{ // Unrecognized command, must be the output filename.
 			ofname = std::string(argv[index]); 
 		}
 		index++;
 	}
 
-	// Load the output file.
-	std::ofstream output;
-	
-	if(!ping_mode){
-		output.open(ofname.c_str(), std::ios::binary);
-		if(!output.is_open()){ 
-			std::cout << " ERROR: Failed to open output file '" << ofname << "'!\n";
-			return 1; 
+	if(resync_mode && (min_time > 0 || build_index)){
+		std::cout << " Error! The time index may not be used in resync mode.\n";
+		return 1;
+	}
+
+	if(follow_mode && (max_time > 0 || min_time > 0 || build_index || resync_mode || !statname.empty())){
+		std::cout << " Error! May not use --time, --from, --index, --resync or --stats in follow mode.\n";
+		return 1;
+	}
+
+	if(auto_baud && ascii_mode){
+		std::cout << " Error! May only detect the baud rate of binary packets.\n";
+		return 1;
+	}
+
+	WindowStats stats;
+	if(!statname.empty() && !stats.setWindow(window_len, slide_len)){
+		std::cout << " Error! The statistics window must be a positive multiple of the slide time!\n";
+		return 1;
+	}
+	stats.setMaxTemp(max_temp);
+	if(ckpname.empty()){ ckpname = Checkpoint::getSidecarName(ofname); }
+
+	if(dir_mode){
+		if(printout || max_time > 0 || min_time > 0 || build_index || !colname.empty() || !cmpname.empty() || !statname.empty()){
+			std::cout << " Error! Only --threads, --scalar and --resync may be used with an input directory.\n";
+			return 1;
 		}
+		std::cout << " Using directory mode.\n";
+		return unpackDirectory(ifname, ofname, num_threads, scalar_mode, resync_mode);
 	}
 
 	// Load the input file.
-	std::ifstream file;
+	MappedFile file;
+	BatchDecoder decoder;
+	FrameDecoder frames;
+	std::vector<TimingRecord> timingRecords;
+	StageTiming timing;
+	frames.setTimingOutput(&timingRecords);
+	CodecReader compressed;
+	CodecWriter codec;
+	PacketFormat format = FORMAT_UNKNOWN;
+	PacketColumns columns;
+	ColumnWriter colfile;
+	TelemetryWriter telemetry;
+	Checkpoint ckp;
+	char title[64] = "";
+	size_t row = 0;
+	unsigned int count = 0;
+	unsigned int startCount = 0;
+	size_t numWritten = 0;
+	bool resume = false;
 	int fd = 0;
 
 	if(!serial_mode){
-		file.open(argv[1], std::ios::binary);
-		if(!file.is_open()){ 
+		if(!file.open(argv[1])){ 
 			std::cout << " ERROR: Failed to open input file '" << argv[1] << "'!\n";
-			output.close();
 			return 1; 
 		}
-		// Read the title.
-		char title[64];
-		readTitle(&file, title, 64);
+		size_t offset = 0;
+		if(compressed.setInput(file.getData(), file.getSize())){
+			strcpy(title, compressed.getTitle());
+			format = FORMAT_COMPRESSED;
+		}
+		else{
+			// Read the title.
+			offset = readTitle(file.getData(), file.getSize(), title, 64);
+		
+			// Files which do not look framed are read with the legacy decoder.
+			format = detectFormat(file.getData()+offset, file.getSize()-offset);
+			if(format != FORMAT_FRAMED){ format = FORMAT_LEGACY; }
+		}
 		printf(" Title: %s\n", title);
+		std::cout << " Using " << getFormatName(format) << " packet format.\n";
+		
+		if(format != FORMAT_LEGACY && (min_time > 0 || build_index)){
+			std::cout << " Error! The time index may only be used with legacy files.\n";
+			return 1;
+		}
+		
+		if(min_time > 0 || build_index){
+			// Load the sidecar time index, or build it if it does not exist yet.
+			std::string idxname = TimeIndex::getSidecarName(ifname);
+			TimeIndex tindex;
+			if(build_index || !tindex.load(idxname, ifname)){
+				tindex.build(file.getData(), file.getSize(), offset);
+				if(tindex.save(idxname, ifname)){ std::cout << " Wrote time index '" << idxname << "' (" << tindex.getNumEntries() << " entries).\n"; }
+				else{ std::cout << " Warning! Failed to write time index '" << idxname << "'.\n"; }
+			}
+			
+			if(!tindex.isMonotonic()){
+				std::cout << " Warning! Timestamps are not monotonic, reading from the start of the file.\n";
+			}
+			else if(min_time > 0){
+				// Seek to the last block which starts before the minimum time.
+				size_t start = tindex.find(1000*(unsigned int)min_time);
+				if(start > offset){
+					std::cout << " Skipped " << start-offset << " of " << file.getSize()-offset << " bytes using the time index.\n";
+					offset = start;
+					count = 1; // The junk first packet has already been skipped.
+				}
+			}
+		}
+		
+		if(follow_mode){
+			if(format == FORMAT_COMPRESSED){
+				std::cout << " Error! Follow mode may only be used with legacy or framed input files.\n";
+				return 1;
+			}
+
+			// Skip everything which was decoded by the last run.
+			if((resume = resumeCheckpoint(ckp, ckpname, file, format, ofname, colname, colfile, cmpname, codec))){
+				offset = ckp.header.inputOffset;
+				count = startCount = ckp.header.numPackets;
+				frames.resume(ckp.header.synced != 0, ckp.header.haveSequence != 0, ckp.header.lastSequence);
+				std::cout << " Resuming at offset " << offset << " after " << ckp.header.numRecords << " records (time " << ckp.header.lastTimestamp/1000 << " s).\n";
+			}
+		}
+
+		decoder.setInput(file.getData(), file.getSize(), offset);
+		decoder.setScalar(scalar_mode || !BatchDecoder::haveSIMD());
+		decoder.setResync(resync_mode);
+		frames.setInput(file.getData(), file.getSize(), offset);
+		columns.reserve(PACKET_BLOCK_SIZE);
 	}
 	else{
-		fd = serialOpen(argv[1], 9600);
-		if(fd < 0){
+		fd = serialOpen(argv[1], baud);
+		if(fd == -2){
+			std::cout << " ERROR: Serial port '" << argv[1] << "' does not support " << baud << " baud!\n";
+			return 1;
+		}
+		else if(fd < 0){
 			std::cout << " ERROR: Failed to open serial port '" << argv[1] << "'!\n";
-			output.close();
 			return 1; 
 		}
-		else{ std::cout << " Connected to " << argv[1] << " (fd=" << fd << ")\n"; }
+
+		// Listen at each rate until valid packets arrive.
+		if(auto_baud){
+			std::cout << " Detecting baud rate of " << argv[1] << "..." << std::endl;
+			if((baud = detectBaud(fd, getBaudRates(), format)) <= 0){
+				std::cout << " ERROR: Failed to detect the baud rate of serial port '" << argv[1] << "'!\n";
+				serialClose(fd);
+				return 1;
+			}
+			std::cout << " Detected " << getFormatName(format) << " packets at " << baud << " baud.\n";
+		}
+		std::cout << " Connected to " << argv[1] << " (fd=" << fd << ") at " << serialGetBaud(fd) << " baud\n";
+		
+		// Wake up as soon as any bytes are waiting on the port. Packets are assembled from partial reads,
+		// and waiting for more bytes would hold a short (compact) frame until the next one arrives.
+		serialSetTimeouts(fd, 1, 0);
+	}
+
+	// Load the output file. A resumed run adds to the end of the existing output.
+	std::ofstream output;
+	
+	if(!ping_mode){
+		output.open(ofname.c_str(), (resume ? std::ios::binary | std::ios::app : std::ios::binary));
+		if(!output.is_open()){ 
+			std::cout << " ERROR: Failed to open output file '" << ofname << "'!\n";
+			return 1; 
+		}
+	}
+
+	if(!colname.empty() && !ping_mode && !ascii_mode && !colfile.isOpen()){
+		if(!colfile.open(colname, title)){
+			std::cout << " ERROR: Failed to open column file '" << colname << "'!\n";
+			return 1;
+		}
+	}
+
+	if(!cmpname.empty() && !ping_mode && !ascii_mode && !codec.isOpen()){
+		if(!codec.open(cmpname, title)){
+			std::cout << " ERROR: Failed to open compressed file '" << cmpname << "'!\n";
+			return 1;
+		}
+	}
+
+	std::ofstream statsOutput;
+	if(!statname.empty() && !ping_mode && !ascii_mode){
+		statsOutput.open(statname.c_str());
+		if(!statsOutput.is_open()){
+			std::cout << " ERROR: Failed to open statistics file '" << statname << "'!\n";
+			return 1;
+		}
+		stats.setOutput(&statsOutput);
+	}
+
+	if(!shmname.empty() && !ascii_mode){
+		if(!telemetry.open(shmname)){
+			std::cout << " ERROR: Failed to create telemetry ring '" << getTelemetryName(shmname) << "'!\n";
+			return 1;
+		}
+		std::cout << " Publishing packets to telemetry ring '" << telemetry.getName() << "'\n";
 	}
 
 	setup_signal_handlers();
 	
-	output << "time(ms),T(C),P(Torr),R1,R2\n";
+	if(resume){ }
+	else if(!host_time){ output << "time(ms),T(C),P(Torr),R1,R2\n"; }
+	else{ output << "time(ms),T(C),P(Torr),R1,R2,host(ms)\n"; }
 	
 	bool firstRun = true;
-	unsigned int count = 0;
-	std::deque<char> data;
+	SerialBuffer data;
+	std::chrono::duration<double> decodeTime(0);
+	std::chrono::steady_clock::time_point arrival;
+	std::chrono::system_clock::time_point arrivalHost;
+	LatencyHistogram latency;
+	CsvWriter writer(&output);
 	while(true){
 		if(SIGNAL_INTERRUPT){
-			break;
+			// Finish the decoded block in follow mode, so that the checkpoint follows the last record written.
+			if(!follow_mode || row >= columns.size()){ break; }
 		}
 
 		if(!serial_mode){ // Reading from a binary file. Standard operation.
-			file.read((char*)(&delimiter), 4);
-		
-			if(file.eof()){ break; }
-	
-			// Check for the beginning of a new packet.
-			if(delimiter != 0xFFFFFFFF){ continue; }
+			if(row >= columns.size()){ // Decode the next block of packets.
+				columns.clear();
+				row = 0;
+
+				std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+				size_t numDecoded;
+				if(format == FORMAT_FRAMED){
+					numDecoded = frames.decode(columns);
+					timing.add(timingRecords);
+					timingRecords.clear();
+				}
+				else if(format == FORMAT_COMPRESSED){ numDecoded = compressed.decode(columns); }
+				else{ numDecoded = decoder.decode(columns); }
+				decodeTime += std::chrono::steady_clock::now()-start;
+
+				if(numDecoded == 0){ break; }
+			}
 	
-			// Read data from the file.
-			file.read((char*)(&timestamp), 4);
-			file.read((char*)(&temperature), 4);
-			file.read((char*)(&pressure), 4);
-			file.read((char*)(&relay1), 2);
-			file.read((char*)(&relay2), 2);
-		
-			if(file.eof()){ break; }
+			// Read data from the decoded block.
+			readRow(columns, row);
 		}
 		else{ // Reading from serial.
 			if(firstRun){
@@ -299,87 +681,97 @@ int main(int argc, char *argv[]){
 				firstRun = false;
 			}
 			
-			int bytesReady = serialDataAvail(fd);
-			if(bytesReady == 0){ // Not enough bytes waiting to be read.
-				// Wait for 10 ms for some bytes to read.
-				usleep(10000);
-				continue;
-			}
-			else if(bytesReady < 0){ // Error on port.
-				std::cout << " ERROR: Encountered error on serial port!\n";
-				break;
-			}		
-
-			if(ping_mode && num_ping-- <= 0){
-				break;
-			}
-
-			if(!ascii_mode){ // Reading binary from serial.
-				// Check that we are not out of sync by up to 3 bytes.
-				// Check for 4 0xFF bytes in a row. This will signify
-				// the beginning of a data packet.
-				if(serialRead(fd, data, bytesReady) < 0){
-					std::cout << " ERROR: Encountered error reading on serial port!\n";
+			// Decode any complete packets remaining in the buffer before reading more data.
+			const char *packet = NULL;
+			bool ready = false;
+			if(format == FORMAT_FRAMED){ ready = (row < columns.size()); }
+			else if(format == FORMAT_LEGACY){ ready = ((packet = data.nextPacket()) != NULL); }
+			if(!ready){
+				// Write any buffered rows to the output file while waiting.
+				writer.flush();
+
+				// Sleep until there are bytes waiting to be read.
+				int status = serialWait(fd, SERIAL_TIMEOUT);
+				if(status == 0){ // Timed out or interrupted by a signal.
+					continue;
+				}
+				else if(status < 0){ // Error on port.
+					std::cout << " ERROR: Encountered error on serial port!\n";
 					break;
 				}
-
-				if(data.size() >= 20){ // Scan the data.				
-					while(!data.empty()){
-						if(SIGNAL_INTERRUPT){
-							break;
-						}
 				
-						unsigned int dummy;
-						getDataWord(data, 0, (char*)&dummy);
-						if(dummy == 0xFFFFFFFF){
-							break;
-						} 
-						else{ data.pop_front(); }
-					}
-					
-					if(data.size() >= 20){ // Read the data.
-						getDataWord(data, 0, (char*)&delimiter);
-						getDataWord(data, 4, (char*)&timestamp);
-						getDataWord(data, 8, (char*)&temperature);
-						getDataWord(data, 12, (char*)&pressure);
-						getDataWord(data, 16, (char*)&relay1, 2);
-						getDataWord(data, 18, (char*)&relay2, 2);
-						
-						// Remove the data from the queue.
-						popQueue(data, 20);
-					}
-					else{ continue; }
+				// Record the host arrival time of the data.
+				arrival = std::chrono::steady_clock::now();
+				arrivalHost = std::chrono::system_clock::now();
+
+				int bytesReady = serialDataAvail(fd);
+				if(bytesReady == 0){ // Spurious wakeup.
+					continue;
 				}
-				else{ continue; }
-			}
-			else{ // Reading ascii from serial.
-				char *msg = new char[bytesReady+1];
-				if(serialGets(fd, msg, bytesReady+1) < 0){
-					std::cout << " ERROR: Encountered error reading on serial port!\n";
+				else if(bytesReady < 0){ // Error on port.
+					std::cout << " ERROR: Encountered error on serial port!\n";
 					break;
+				}		
+
+				if(!ascii_mode){ // Reading binary from serial.
+					// Read everything waiting on the port with a single call and search
+					// for 4 0xFF bytes in a row. This will signify the beginning of a data packet.
+					if(data.fill(fd) < 0){
+						std::cout << " ERROR: Encountered error reading on serial port!\n";
+						break;
+					}
+
+					// Detect the packet format from the first bytes received.
+					if(format == FORMAT_UNKNOWN){
+						if((format = detectFormat(data.data(), data.size())) == FORMAT_UNKNOWN){ continue; }
+						std::cout << " Detected " << getFormatName(format) << " packet format.\n";
+					}
+
+					if(format == FORMAT_FRAMED){
+						columns.clear();
+						row = 0;
+						frames.decode(data.data(), data.size(), columns);
+						data.clear();
+						timing.add(timingRecords);
+						timingRecords.clear();
+						if(columns.size() == 0){ continue; }
+					}
+					else if(!(packet = data.nextPacket())){ continue; }
 				}
+				else{ // Reading ascii from serial.
+					char *msg = new char[bytesReady+1];
+					if(serialGets(fd, msg, bytesReady+1) < 0){
+						std::cout << " ERROR: Encountered error reading on serial port!\n";
+						break;
+					}
 	
-				// Print data to the screen.
-				if(printout){
-					printf("%s", msg);
-				}
+					// Print data to the screen.
+					if(printout){
+						printf("%s", msg);
+					}
 
-				// Do no processing of the incoming data.
-				// Insert commas and write to the output file.
-				replaceChar(msg, bytesReady+1, '\t', ',');
-				output << msg;
+					// Do no processing of the incoming data.
+					// Insert commas and write to the output file.
+					replaceChar(msg, bytesReady+1, '\t', ',');
+					output << msg;
 
-				// Delete the string.
-				delete[] msg;
+					// Delete the string.
+					delete[] msg;
 
-				// Do no further processing.
-				count++;
-				continue;
+					// Do no further processing.
+					count++;
+					if(ping_mode && --num_ping <= 0){ break; }
+					continue;
+				}
 			}
+
+			// Read the data directly from the buffer.
+			if(format == FORMAT_FRAMED){ readRow(columns, row); }
+			else{ unpackPacket(packet, timestamp, temperature, pressure, relay1, relay2); }
 		}
 		
-		// Skip the first data entry, because it is usually junk.
-		if(count == 0){
+		// Skip the first legacy data entry, because it is usually junk.
+		if(count == 0 && format == FORMAT_LEGACY){
 			count++;
 			continue;
 		}
@@ -390,48 +782,135 @@ int main(int argc, char *argv[]){
 			break;
 		}
 		
-		// A voltage divider is used in order to get the full
-		// range of 1-8 V from the pressure gauge using the
-		// 5 V arduino. Convert the pressure voltage to the real voltage.
-		pressure = pressure/RPRIME;
-	
-		// Convert the pressure voltage to an actual pressure.
-		pressure = pow(10.0, (pressure-5.0));
+		// Skip entries before the minimum time.
+		if(min_time > 0 && (int)(timestamp/1000) < min_time){
+			continue;
+		}
+		
+		// Archive the raw packet before the pressure is calibrated.
+		if(!ping_mode){ codec.add(timestamp, temperature, pressure, relay1, relay2); }
 
-		// Get a string of the pressure in scientific notation.
-		std::string pressureString = sciNotation(pressure);
+		// Convert the pressure gauge voltage to an actual pressure.
+		pressure = calibratePressure(pressure);
 
 		// Print data to the screen.
 		if(printout){
-			if(ping_mode){ std::cout << " ping " << num_ping+1 << ":"; }
+			if(ping_mode){ std::cout << " ping " << num_ping << ":"; }
 			std::cout << " time = " << timestamp/1000 << " s, temp = " << temperature << " C, pres = ";
-			std::cout << pressureString << " Torr, R1 = " << relay1 << ", R2 = " << relay2;
+			std::cout << sciNotation(pressure) << " Torr, R1 = " << relay1 << ", R2 = " << relay2;
 			if(!ping_mode){ std::cout << "\r" << std::flush; }
 			else{ std::cout << "\n"; }
 		}
 		
+		// Publish the packet to any live readers.
+		if(telemetry.isOpen()){
+			telemetry.publish(std::chrono::duration_cast<std::chrono::milliseconds>(arrivalHost.time_since_epoch()).count(), timestamp, temperature, pressure, relay1, relay2);
+		}
+
 		if(!ping_mode){
 			// Write ascii data to the output file.
-			output << timestamp << ",";
-			output << temperature << ",";
-			output << pressureString << ",";
-			output << relay1 << ",";
-			output << relay2 << "\n";
+			writer.addPacket(timestamp, temperature, pressure, relay1, relay2);
+			if(host_time){ writer.addField((long long)std::chrono::duration_cast<std::chrono::milliseconds>(arrivalHost.time_since_epoch()).count()); }
+			writer.endRow();
+
+			// Write binary data to the column file.
+			colfile.add(timestamp, temperature, pressure, relay1, relay2);
+			numWritten++;
+
+			// Add the packet to the window statistics.
+			if(statsOutput.is_open()){ stats.add(timestamp, temperature, pressure, relay1, relay2); }
 		}
 
+		// Record the time between the arrival of the packet and the end of its processing.
+		if(serial_mode){ latency.fill(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now()-arrival).count()); }
+
 		count++;
+
+		// Stop after the requested number of packets. Each read may return a partial packet.
+		if(ping_mode && --num_ping <= 0){ break; }
 	}
 	
-	std::cout << "\n Done! Read " << count << " data entries.\n";
+	if(!follow_mode){ std::cout << "\n Done! Read " << count << " data entries.\n"; }
+	else{ std::cout << "\n Done! Read " << count-startCount << " new data entries (" << count << " total).\n"; }
 	
 	// Close the input file/port.
-	if(!serial_mode){ file.close(); }
-	else{ serialClose(fd); }
+	if(!serial_mode){ 
+		if(format == FORMAT_FRAMED){ printFrameStats(frames, timing); }
+		else if(format == FORMAT_COMPRESSED){
+			std::cout << "  Decoded " << compressed.getNumDecoded() << " packets in " << decodeTime.count() << " s";
+			if(decodeTime.count() > 0){ std::cout << " (" << compressed.getNumDecoded()/decodeTime.count() << " packets/s)"; }
+			std::cout << ".\n";
+			if(compressed.getOffset() < file.getSize()){ std::cout << "  Ignored " << file.getSize()-compressed.getOffset() << " bytes of incomplete or corrupt data.\n"; }
+		}
+		else{
+			std::cout << "  Decoded " << decoder.getNumDecoded() << " packets in " << decodeTime.count() << " s";
+			if(decodeTime.count() > 0){ std::cout << " (" << decoder.getNumDecoded()/decodeTime.count() << " packets/s)"; }
+			std::cout << " using the " << (decoder.getScalar() ? "scalar" : "SIMD") << " decoder.\n";
+			if(decoder.getNumSkipped() > 0){ std::cout << "  Skipped " << 4*decoder.getNumSkipped() << " bytes of unaligned data.\n"; }
+			if(decoder.getNumSkippedBytes() > 0){
+				const std::vector<SkippedRegion> &regions = decoder.getSkippedRegions();
+				std::cout << "  Skipped " << decoder.getNumSkippedBytes() << " bytes of corrupted data in " << regions.size() << " regions:\n";
+				for(size_t i = 0; i < regions.size() && i < MAX_PRINTED_REGIONS; i++){
+					std::cout << "   offset " << regions[i].offset << ": " << regions[i].length << " bytes\n";
+				}
+				if(regions.size() > MAX_PRINTED_REGIONS){ std::cout << "   ...\n"; }
+			}
+		}
+	}
+	else{ 
+		if(!ascii_mode){
+			std::cout << "  Arrival to decode latency:\n";
+			latency.print(std::cout, "   ");
+			if(format == FORMAT_FRAMED){ printFrameStats(frames, timing); }
+			else if(data.getNumDiscarded() > 0){ std::cout << "  Discarded " << data.getNumDiscarded() << " bytes of unaligned data.\n"; }
+		}
+		if(telemetry.isOpen()){
+			std::cout << "  Published " << telemetry.getNumPublished() << " packets to telemetry ring '" << telemetry.getName() << "'\n";
+			telemetry.close();
+		}
+		serialClose(fd); 
+	}
 
 	if(!ping_mode){
 		std::cout << "  Wrote output file '" << ofname << "'\n";
+		writer.flush();
 		output.close();
+		if(colfile.isOpen()){
+			std::cout << "  Wrote " << colfile.getNumRecords() << " records to column file '" << colname << "'\n";
+			colfile.close();
+		}
+		if(codec.isOpen()){
+			codec.close();
+			std::cout << "  Wrote " << codec.getNumRecords() << " records to compressed file '" << cmpname << "' (" << codec.getNumBytes() << " bytes";
+			if(codec.getNumRecords() > 0){ std::cout << ", " << (double)codec.getNumBytes()/codec.getNumRecords() << " bytes/record"; }
+			std::cout << ")\n";
+		}
+		if(statsOutput.is_open()){
+			stats.flush();
+			statsOutput.close();
+			std::cout << "  Wrote " << stats.getNumWindows() << " windows to statistics file '" << statname << "'\n";
+			stats.print(std::cout, "   ");
+		}
 	}
 
+	// Save the state needed to continue from the end of this run.
+	if(follow_mode){
+		ckp.header.format = format;
+		ckp.header.inputOffset = (format == FORMAT_FRAMED ? frames.getResumeOffset() : decoder.getResumeOffset());
+		ckp.header.numPackets = count;
+		ckp.header.numRecords += numWritten;
+		ckp.header.outputSize[0] = Checkpoint::getFileSize(ofname);
+		if(count > startCount){ ckp.header.lastTimestamp = timestamp; }
+		ckp.header.lastSequence = frames.getLastSequence();
+		ckp.header.haveSequence = (frames.haveLastSequence() ? 1 : 0);
+		ckp.header.synced = (frames.isSynced() ? 1 : 0);
+		strncpy(ckp.header.title, title, 63);
+		if(ckp.save(ckpname, file.getData(), file.getSize())){ std::cout << "  Wrote checkpoint '" << ckpname << "' at offset " << ckp.header.inputOffset << " of " << file.getSize() << " bytes\n"; }
+		else{ std::cout << " Warning! Failed to write checkpoint '" << ckpname << "'.\n"; }
+	}
+
+	// Close the input file.
+	file.close();
+
 	return 0;
 }
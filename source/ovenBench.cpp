@@ -0,0 +1,1865 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <string.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <dirent.h>
+
+#include "packetDecoder.hpp"
+#include "serialBuffer.hpp"
+#include "packetFormat.hpp"
+#include "frameDecoder.hpp"
+#include "packetCodec.hpp"
+#include "windowStats.hpp"
+#include "timeIndex.hpp"
+#include "dumpMerger.hpp"
+#include "checkpoint.hpp"
+#include "ovenModel.hpp"
+#include "sdLogger.h"
+#include "packetFrame.h"
+#include "taskScheduler.h"
+#include "ovenInterlock.h"
+#include "sensorConvert.h"
+#include "relayEdges.hpp"
+#include "telemetryRing.hpp"
+
+#define DEFAULT_PACKETS 100000
+
+// Default number of times each file benchmark is repeated. The fastest run is reported.
+#define DEFAULT_REPEAT 3
+
+// Modelled SD card timings (us).
+#define SD_CALL_TIME 10 // Overhead of a single call to write().
+#define SD_SECTOR_TIME 1000 // Time to write a single 512 byte sector to the card.
+#define SD_ALLOCATE_TIME 3000 // Time to allocate a new cluster (read and update both FATs).
+
+// Size of a FAT cluster (bytes).
+#define SD_CLUSTER_SIZE 32768
+
+// Modelled firmware timings (us).
+#define SIM_ANALOG_TIME 112 // Single analogRead() of the pressure gauge.
+#define SIM_THERMO_TIME 1100 // Single readCelsius() of the MAX31855.
+#define SIM_LOG_TIME 300 // Building a packet and queueing it for the serial port.
+
+// Firmware settings (see oven_controller.ino).
+#define SIM_READ_DELAY 1000000 // (us)
+#define SIM_PRESSURE_PERIOD 2000 // (us)
+#define SIM_PRESSURE_OVERSAMPLE 8
+#define SIM_THERMO_PERIOD 100000 // (us)
+#define SIM_RELAY_PERIOD 10000 // (us)
+#define SIM_MAX_TEMP 89.0 // (C)
+#define SIM_MIN_TEMP 88.0 // (C)
+#define SIM_MAX_PRESSURE 2.0017468 // (V)
+#define SIM_PUMPED_DOWN_PRESSURE 1.8511003 // (V)
+
+// Simulated pressure gauge readings before and after the loss of vacuum (V).
+#define SIM_VACUUM_PRESSURE 1.7
+#define SIM_LEAK_PRESSURE 3.0
+
+// Longest allowed time from the loss of vacuum to the pump shutdown with the scheduler (us). The
+// leak is seen by the second full pressure reading after the loss at the latest, and the
+// interlocks must be evaluated within a period of being due.
+#define SIM_SHUTDOWN_DEADLINE (2*SIM_PRESSURE_OVERSAMPLE*SIM_PRESSURE_PERIOD+2*SIM_RELAY_PERIOD)
+
+typedef std::chrono::steady_clock benchClock;
+
+// Machine-readable results, one csv row per benchmark.
+std::ofstream results;
+
+// Name of the input file of the file benchmarks, written with the results.
+std::string inputName = "generated";
+
+// Number of times each file benchmark is repeated.
+int numRepeat = DEFAULT_REPEAT;
+
+// Reset the peak resident set size of the process, so that the peak of the next benchmark
+// can be measured on its own. Only supported on Linux.
+void resetPeakRSS(){
+	std::ofstream clear("/proc/self/clear_refs");
+	clear << "5";
+}
+
+// Return the peak resident set size of the process (kB).
+long getPeakRSS(){
+	std::ifstream status("/proc/self/status");
+	std::string line;
+	while(getline(status, line)){
+		if(line.compare(0, 6, "VmHWM:") == 0){ return strtol(line.c_str()+6, NULL, 10); }
+	}
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+}
+
+// Print the result of a single benchmark, and write it to the results file if there is one.
+// bytes_ is the size of the input, if known. The peak RSS of the process is used if peakRSS_ < 0.
+void report(const std::string &name_, const size_t &records_, const double &seconds_, const size_t &bytes_=0, long peakRSS_=-1){
+	if(peakRSS_ < 0){ peakRSS_ = getPeakRSS(); }
+	std::cout << "  " << name_ << ": " << records_ << " records in " << seconds_ << " s";
+	if(seconds_ > 0){
+		std::cout << " (" << records_/seconds_ << " records/s";
+		if(bytes_ > 0){ std::cout << ", " << bytes_/seconds_/1E6 << " MB/s"; }
+		std::cout << ")";
+	}
+	std::cout << ", peak RSS " << peakRSS_/1024.0 << " MB" << std::endl;
+
+	if(results.is_open()){
+		results << time(NULL) << "," << inputName << "," << name_ << "," << records_ << "," << bytes_ << "," << seconds_ << ",";
+		results << (seconds_ > 0 ? records_/seconds_ : 0) << "," << (seconds_ > 0 ? bytes_/seconds_/1E6 : 0) << "," << peakRSS_ << std::endl;
+	}
+}
+
+// Reset the peak RSS and return the start time of a benchmark.
+benchClock::time_point startTimer(){
+	resetPeakRSS();
+	return benchClock::now();
+}
+
+double elapsed(const benchClock::time_point &start_){
+	return std::chrono::duration<double>(benchClock::now()-start_).count();
+}
+
+// Run a benchmark numRepeat times and report the fastest run. stage_ returns the number of records.
+template <typename Stage>
+void runStage(const std::string &name_, const size_t &bytes_, Stage stage_){
+	size_t records = 0;
+	double best = -1;
+	long peakRSS = 0;
+	for(int i = 0; i < numRepeat; i++){
+		benchClock::time_point start = startTimer();
+		records = stage_();
+		double seconds = elapsed(start);
+		if(best < 0 || seconds < best){ best = seconds; }
+		long peak = getPeakRSS();
+		if(peak > peakRSS){ peakRSS = peak; }
+	}
+	report(name_, records, best, bytes_, peakRSS);
+}
+
+// Generate a stream of N_ data packets.
+void generatePackets(std::vector<char> &data_, const size_t &N_){
+	const unsigned int delimiter = PACKET_DELIMITER;
+	data_.resize(N_*PACKET_LENGTH);
+	char *ptr = &data_[0];
+	for(size_t i = 0; i < N_; i++, ptr += PACKET_LENGTH){
+		unsigned int timestamp = i*1000;
+		float temperature = 20.0+(i%700)/10.0;
+		float pressure = 1.85;
+		short relay1 = (i/100)%2;
+		short relay2 = 1;
+		memcpy(&ptr[0], (const char*)&delimiter, 4);
+		memcpy(&ptr[4], (const char*)&timestamp, 4);
+		memcpy(&ptr[8], (const char*)&temperature, 4);
+		memcpy(&ptr[12], (const char*)&pressure, 4);
+		memcpy(&ptr[16], (const char*)&relay1, 2);
+		memcpy(&ptr[18], (const char*)&relay2, 2);
+	}
+}
+
+// Write a packet stream to a temporary file and return a descriptor opened for reading.
+int openStream(const std::vector<char> &data_){
+	char fname[] = "/tmp/ovenBenchXXXXXX";
+	int fd = mkstemp(fname);
+	if(fd < 0){ return -1; }
+	unlink(fname);
+	if(write(fd, &data_[0], data_.size()) != (ssize_t)data_.size()){
+		close(fd);
+		return -1;
+	}
+	lseek(fd, 0, SEEK_SET);
+	return fd;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Original std::deque serial reader
+///////////////////////////////////////////////////////////////////////////////
+
+size_t dequeRead(const int &fd_, std::deque<char> &data_, const size_t &len_){
+	char dummy;
+	size_t values = 0;
+	for(size_t i = 0; i < len_; i++){
+		if(read(fd_, &dummy, 1) == 1){
+			data_.push_back(dummy);
+			values++;
+		}
+	}
+	return values;
+}
+
+void dequeDataWord(const std::deque<char> &data_, const size_t &offset_, char *val_, const size_t &len_=4){
+	if(offset_+len_ > data_.size()){ return; }
+	for(size_t i = 0; i < len_; i++){
+		val_[i] = data_[offset_+i];
+	}
+}
+
+void dequePop(std::deque<char> &data_, const size_t &len_){
+	size_t count = 0;
+	while(!data_.empty() && count < len_){
+		data_.pop_front();
+		count++;
+	}
+}
+
+size_t benchSerialDeque(const int &fd_){
+	unsigned int delimiter, timestamp;
+	float temperature, pressure;
+	short relay1, relay2;
+
+	size_t count = 0;
+	std::deque<char> data;
+	while(true){
+		int bytesReady;
+		if(ioctl(fd_, FIONREAD, &bytesReady) == -1 || bytesReady <= 0){ break; }
+		dequeRead(fd_, data, bytesReady);
+		while(data.size() >= PACKET_LENGTH){
+			while(!data.empty()){
+				unsigned int dummy;
+				dequeDataWord(data, 0, (char*)&dummy);
+				if(dummy == PACKET_DELIMITER){ break; }
+				data.pop_front();
+			}
+			if(data.size() < PACKET_LENGTH){ break; }
+			dequeDataWord(data, 0, (char*)&delimiter);
+			dequeDataWord(data, 4, (char*)&timestamp);
+			dequeDataWord(data, 8, (char*)&temperature);
+			dequeDataWord(data, 12, (char*)&pressure);
+			dequeDataWord(data, 16, (char*)&relay1, 2);
+			dequeDataWord(data, 18, (char*)&relay2, 2);
+			dequePop(data, PACKET_LENGTH);
+			count++;
+		}
+	}
+	return count;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Contiguous ring buffer serial reader
+///////////////////////////////////////////////////////////////////////////////
+
+size_t benchSerialRing(const int &fd_){
+	unsigned int timestamp;
+	float temperature, pressure;
+	short relay1, relay2;
+
+	size_t count = 0;
+	SerialBuffer data;
+	while(data.fill(fd_) > 0){
+		const char *packet;
+		while((packet = data.nextPacket())){
+			unpackPacket(packet, timestamp, temperature, pressure, relay1, relay2);
+			count++;
+		}
+	}
+	return count;
+}
+
+bool benchSerial(const size_t &N_){
+	std::vector<char> stream;
+	generatePackets(stream, N_);
+
+	int fd = openStream(stream);
+	if(fd < 0){
+		std::cout << " ERROR: Failed to create temporary stream file!\n";
+		return false;
+	}
+
+	benchClock::time_point start = startTimer();
+	size_t count = benchSerialDeque(fd);
+	report("serial deque", count, elapsed(start));
+
+	lseek(fd, 0, SEEK_SET);
+	start = startTimer();
+	count = benchSerialRing(fd);
+	report("serial ring", count, elapsed(start));
+
+	close(fd);
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Original std::stringstream csv formatting
+///////////////////////////////////////////////////////////////////////////////
+
+float legacyOrder(const float &input_, int &power){
+	float test = 1E-10;
+	for(int i = -10; i < 10; i++){
+		if(input_/test <= 1){
+			power = i;
+			return test;
+		}
+		test *= 10.0;
+	}
+	return 1.0;
+}
+
+std::string legacySciNotation(const float &input_, const size_t &N_=2){
+	int power = 0;
+	double order = legacyOrder(input_, power);
+
+	std::stringstream stream;
+	stream << 10*input_/order;
+
+	std::string output = stream.str();
+	size_t find_index = output.find('.');
+	if(find_index != std::string::npos){
+		std::string temp;
+		temp = output.substr(0, find_index);
+		temp += output.substr(find_index, N_+1);
+		output = temp;
+	}
+
+	std::stringstream stream2;
+	stream2 << output << "E" << power-1;
+	output = stream2.str();
+
+	return output;
+}
+
+void legacyFormat(std::ostream &output_, const PacketColumns &cols_){
+	for(size_t i = 0; i < cols_.size(); i++){
+		output_ << cols_.timestamp[i] << ",";
+		output_ << cols_.temperature[i] << ",";
+		output_ << legacySciNotation(calibratePressure(cols_.pressure[i])) << ",";
+		output_ << cols_.relay1[i] << ",";
+		output_ << cols_.relay2[i] << "\n";
+	}
+}
+
+void writerFormat(std::ostream &output_, const PacketColumns &cols_){
+	CsvWriter writer(&output_);
+	for(size_t i = 0; i < cols_.size(); i++){
+		writer.addPacket(cols_.timestamp[i], cols_.temperature[i], calibratePressure(cols_.pressure[i]), cols_.relay1[i], cols_.relay2[i]);
+		writer.endRow();
+	}
+}
+
+bool benchFormat(const size_t &N_){
+	std::vector<char> stream;
+	generatePackets(stream, N_);
+
+	PacketColumns cols;
+	BatchDecoder decoder(&stream[0], stream.size());
+	decoder.decode(cols, N_);
+
+	// Check that both methods produce identical output.
+	std::stringstream legacyOutput, writerOutput;
+	legacyFormat(legacyOutput, cols);
+	writerFormat(writerOutput, cols);
+	bool passed = (legacyOutput.str() == writerOutput.str());
+	if(!passed){
+		std::cout << " ERROR: CsvWriter output does not match std::ostream output!\n";
+	}
+
+	std::ofstream null("/dev/null");
+
+	benchClock::time_point start = startTimer();
+	legacyFormat(null, cols);
+	null.flush();
+	report("format ostream", cols.size(), elapsed(start));
+
+	start = startTimer();
+	writerFormat(null, cols);
+	null.flush();
+	report("format to_chars", cols.size(), elapsed(start));
+	return passed;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Firmware SD logging
+///////////////////////////////////////////////////////////////////////////////
+
+// Stand-in for the SdFat SdFile class. The file is stored in memory and the time taken by the
+// card is modelled the same way SdFat writes: partial sectors go to a single sector cache which
+// is written to the card when a different sector is accessed, while whole, aligned sectors are
+// written directly. Clusters are allocated as the file grows unless the file was preallocated.
+class FakeSdFile{
+  public:
+	std::vector<char> data;
+
+	size_t numWrites; // Number of calls to write().
+	double elapsed; // Modelled card time since the last call to reset() (us).
+
+	FakeSdFile(const bool &preallocated_=false) : numWrites(0), elapsed(0), preallocated(preallocated_), cacheSector(-1), dirty(false) { }
+
+	int write(const void *buf_, size_t nbyte_){
+		const char *ptr = (const char*)buf_;
+		numWrites++;
+		elapsed += SD_CALL_TIME;
+		while(nbyte_ > 0){
+			size_t pos = data.size();
+			long sector = pos/SD_LOGGER_BLOCK_SIZE;
+			size_t count = SD_LOGGER_BLOCK_SIZE-pos%SD_LOGGER_BLOCK_SIZE;
+			if(count > nbyte_){ count = nbyte_; }
+			if(!preallocated && pos%SD_CLUSTER_SIZE == 0){ elapsed += SD_ALLOCATE_TIME; }
+			if(count == SD_LOGGER_BLOCK_SIZE){ // Direct write of an entire sector.
+				elapsed += SD_SECTOR_TIME;
+			}
+			else if(sector != cacheSector){ // Write the old cached sector to the card.
+				if(dirty){ elapsed += SD_SECTOR_TIME; }
+				cacheSector = sector;
+				dirty = true;
+			}
+			data.insert(data.end(), ptr, ptr+count);
+			ptr += count;
+			nbyte_ -= count;
+		}
+		return (int)(ptr-(const char*)buf_);
+	}
+
+	int write(const uint8_t &b_){ return write(&b_, 1); }
+
+	bool truncate(uint32_t length_){
+		if(length_ < data.size()){ data.resize(length_); }
+		return true;
+	}
+
+	bool sync(){
+		if(dirty){ elapsed += SD_SECTOR_TIME; }
+		dirty = false;
+		return true;
+	}
+
+	void close(){ sync(); }
+
+	void reset(){ elapsed = 0; }
+
+  private:
+	bool preallocated;
+
+	long cacheSector;
+	bool dirty;
+};
+
+// Build the file header written by the firmware (title length, title and a lone delimiter).
+void generateHeader(std::vector<char> &header_){
+	header_.resize(HEADER_MAX_LENGTH);
+	header_.resize(encodeHeader(FORMAT_LEGACY, &header_[0]));
+}
+
+// Print the result of a single logging benchmark.
+void reportLogger(const std::string &name_, const size_t &packets_, const FakeSdFile &file_, const double &maxLatency_){
+	std::cout << "  " << name_ << ": " << packets_ << " packets, " << file_.numWrites << " write calls (" << (double)file_.numWrites/packets_ << " per packet)";
+	std::cout << ", worst-case loop " << maxLatency_/1000 << " ms" << std::endl;
+}
+
+bool benchLogger(const size_t &N_){
+	std::vector<char> header, stream;
+	generateHeader(header);
+	generatePackets(stream, N_);
+
+	// Original firmware, one write call per byte to a file which grows cluster by cluster.
+	FakeSdFile legacy;
+	for(size_t i = 0; i < header.size(); i++){ legacy.write((uint8_t)header[i]); }
+	double legacyMax = 0;
+	for(size_t i = 0; i < N_; i++){
+		legacy.reset();
+		for(size_t j = 0; j < PACKET_LENGTH; j++){ legacy.write((uint8_t)stream[i*PACKET_LENGTH+j]); }
+		if(legacy.elapsed > legacyMax){ legacyMax = legacy.elapsed; }
+	}
+	legacy.close();
+
+	// Sector buffered logger writing to a preallocated file.
+	FakeSdFile preallocated(true);
+	SdLogger<FakeSdFile> *logger = new SdLogger<FakeSdFile>();
+	logger->begin(&preallocated);
+	logger->write(&header[0], header.size());
+	double loggerMax = 0;
+	for(size_t i = 0; i < N_; i++){
+		const char *ptr = &stream[i*PACKET_LENGTH];
+		unsigned int timestamp;
+		float temperature, pressure;
+		short relay1, relay2;
+		unpackPacket(ptr, timestamp, temperature, pressure, relay1, relay2);
+
+		preallocated.reset();
+		logger->writePacket(timestamp, temperature, pressure, relay1, relay2);
+		logger->service();
+		if(preallocated.elapsed > loggerMax){ loggerMax = preallocated.elapsed; }
+	}
+	logger->end();
+	delete logger;
+
+	bool passed = (legacy.data == preallocated.data);
+	if(!passed){
+		std::cout << " ERROR: SdLogger output does not match the original firmware output!\n";
+	}
+
+	reportLogger("sdlog per-byte", N_, legacy, legacyMax);
+	reportLogger("sdlog buffered", N_, preallocated, loggerMax);
+	return passed;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Firmware interlock latency
+///////////////////////////////////////////////////////////////////////////////
+
+// Simulated oven hardware and firmware state. The scheduler tasks are plain functions, so
+// the state of the simulated firmware is global, as it is on the board.
+struct OvenSimulation{
+	unsigned long now; // Simulated micros().
+	unsigned long lossTime; // Time at which the vacuum is lost.
+	unsigned long shutdownTime; // Time at which the pump relay was switched off.
+	bool shutdown;
+
+	double temp;
+	double pres;
+	unsigned long presSum;
+	int presCount;
+
+	int relay1;
+	int relay2;
+
+	size_t bufferedBytes; // Bytes waiting in the SD sector buffer.
+
+	unsigned long relayDue; // Time at which the scheduled interlock task is next due.
+	unsigned long relayLate; // Longest time the interlock task was started after it was due.
+
+	OvenInterlock interlock;
+
+	OvenSimulation() : interlock(SIM_MAX_TEMP, SIM_MIN_TEMP, SIM_MAX_PRESSURE, SIM_PUMPED_DOWN_PRESSURE) { }
+
+	void reset(const unsigned long &lossTime_){
+		interlock = OvenInterlock(SIM_MAX_TEMP, SIM_MIN_TEMP, SIM_MAX_PRESSURE, SIM_PUMPED_DOWN_PRESSURE);
+		lossTime = lossTime_;
+		shutdownTime = 0;
+		shutdown = false;
+		temp = 0;
+		pres = 0;
+		presSum = 0;
+		presCount = 0;
+		relay1 = 0;
+		relay2 = 0;
+		bufferedBytes = 0;
+		relayDue = 0;
+		relayLate = 0;
+		now = 0;
+	}
+};
+
+OvenSimulation sim;
+
+int simAnalogRead(){
+	double voltage = (sim.now < sim.lossTime ? SIM_VACUUM_PRESSURE : SIM_LEAK_PRESSURE);
+	sim.now += SIM_ANALOG_TIME;
+	return (int)(voltage*1023/5.0);
+}
+
+double simReadCelsius(){
+	sim.now += SIM_THERMO_TIME;
+	return 50.0;
+}
+
+// Evaluate the interlocks with both relays requested and record when the pump is switched off.
+void simEvaluate(){
+	sim.interlock.evaluate(1, 1, sim.temp, sim.pres, sim.relay1, sim.relay2);
+	if(sim.relay2 == 0 && !sim.shutdown){
+		sim.shutdownTime = sim.now;
+		sim.shutdown = true;
+	}
+}
+
+void simLogPacket(){
+	sim.now += SIM_LOG_TIME;
+	sim.bufferedBytes += FRAME_MAX_LENGTH;
+}
+
+// Write a full sector to the SD card, if there is one. Return true if a sector was written.
+bool simService(){
+	if(sim.bufferedBytes < SD_LOGGER_BLOCK_SIZE){ return false; }
+	sim.now += SD_SECTOR_TIME;
+	sim.bufferedBytes -= SD_LOGGER_BLOCK_SIZE;
+	return true;
+}
+
+void simSamplePressure(unsigned long now_){
+	sim.presSum += simAnalogRead();
+	if(++sim.presCount >= SIM_PRESSURE_OVERSAMPLE){
+		sim.pres = 5.0*sim.presSum/(1023.0*SIM_PRESSURE_OVERSAMPLE);
+		sim.presSum = 0;
+		sim.presCount = 0;
+	}
+}
+
+void simReadTemperature(unsigned long now_){ sim.temp = simReadCelsius(); }
+
+// The lateness is measured with the simulated clock, since the scheduler passes the same now_ to
+// every task run in one call and misses the time taken by the tasks run before this one.
+void simEvaluateRelays(unsigned long now_){
+	if(sim.now-sim.relayDue > sim.relayLate){ sim.relayLate = sim.now-sim.relayDue; }
+	sim.relayDue += SIM_RELAY_PERIOD;
+	simEvaluate();
+}
+
+void simLogPacket(unsigned long now_){ simLogPacket(); }
+
+// Original firmware, everything is read once per loop followed by a delay.
+// Return the time from the loss of vacuum to the pump shutdown (us).
+unsigned long simulateLegacy(const unsigned long &lossTime_){
+	sim.reset(lossTime_);
+	while(!sim.shutdown){
+		unsigned long start = sim.now;
+		sim.temp = simReadCelsius();
+		sim.pres = 5.0*simAnalogRead()/1023.0;
+		simEvaluate();
+		simLogPacket();
+		simService();
+		if(sim.now-start < SIM_READ_DELAY){ sim.now = start+SIM_READ_DELAY; }
+	}
+	return sim.shutdownTime-sim.lossTime;
+}
+
+// Scheduled firmware. The simulated clock skips ahead to the next task when nothing is due.
+// Return the time from the loss of vacuum to the pump shutdown (us). The longest time the interlock
+// task was run after it was due is returned in maxLate_ (us).
+unsigned long simulateScheduler(const unsigned long &lossTime_, unsigned long &maxLate_){
+	sim.reset(lossTime_);
+	sim.temp = simReadCelsius();
+	sim.pres = 5.0*simAnalogRead()/1023.0;
+
+	TaskScheduler scheduler;
+	scheduler.add(simSamplePressure, SIM_PRESSURE_PERIOD, sim.now);
+	scheduler.add(simReadTemperature, SIM_THERMO_PERIOD, sim.now);
+	scheduler.add(simEvaluateRelays, SIM_RELAY_PERIOD, sim.now);
+	sim.relayDue = sim.now;
+	scheduler.add(simLogPacket, SIM_READ_DELAY, sim.now);
+	while(!sim.shutdown){
+		if(scheduler.run(sim.now) == 0 && !simService()){
+			sim.now += scheduler.getTimeToNext(sim.now);
+		}
+	}
+	maxLate_ = sim.relayLate;
+	return sim.shutdownTime-sim.lossTime;
+}
+
+// Print the result of a single interlock simulation.
+void reportInterlock(const std::string &name_, const size_t &trials_, const double &total_, const unsigned long &max_){
+	std::cout << "  " << name_ << ": " << trials_ << " losses of vacuum, pump shutdown after " << total_/trials_/1000 << " ms average, " << max_/1000.0 << " ms worst-case" << std::endl;
+}
+
+bool benchInterlock(const size_t &N_){
+	// Spread the loss of vacuum evenly over one read cycle, after the oven is pumped down.
+	const size_t trials = N_;
+	double legacyTotal = 0, schedulerTotal = 0;
+	unsigned long legacyMax = 0, schedulerMax = 0, schedulerLate = 0;
+	for(size_t i = 0; i < trials; i++){
+		unsigned long lossTime = SIM_READ_DELAY+(unsigned long)((double)i*SIM_READ_DELAY/trials);
+
+		unsigned long latency = simulateLegacy(lossTime);
+		legacyTotal += latency;
+		if(latency > legacyMax){ legacyMax = latency; }
+
+		unsigned long late;
+		latency = simulateScheduler(lossTime, late);
+		schedulerTotal += latency;
+		if(latency > schedulerMax){ schedulerMax = latency; }
+		if(late > schedulerLate){ schedulerLate = late; }
+	}
+
+	reportInterlock("interlock loop+delay", trials, legacyTotal, legacyMax);
+	reportInterlock("interlock scheduled", trials, schedulerTotal, schedulerMax);
+	std::cout << "   interlock task run up to " << schedulerLate/1000.0 << " ms late (period " << SIM_RELAY_PERIOD/1000.0 << " ms)\n";
+
+	// The interlocks must keep up with their period under the SD and serial load.
+	bool passed = true;
+	if(schedulerLate >= SIM_RELAY_PERIOD){
+		std::cout << " ERROR: The interlock task missed its " << SIM_RELAY_PERIOD/1000.0 << " ms period by up to " << schedulerLate/1000.0 << " ms!\n";
+		passed = false;
+	}
+	if(schedulerMax > SIM_SHUTDOWN_DEADLINE){
+		std::cout << " ERROR: The pump was shut down up to " << schedulerMax/1000.0 << " ms after the loss of vacuum (deadline " << SIM_SHUTDOWN_DEADLINE/1000.0 << " ms)!\n";
+		passed = false;
+	}
+	return passed;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Fixed-point firmware readings
+///////////////////////////////////////////////////////////////////////////////
+
+// Interlocks of the original firmware. The Arduino double is a 32 bit float.
+typedef OvenInterlockBase<float, float> FloatInterlock;
+
+// Interlock thresholds (C and V): the firmware settings, and a set which is not a whole number of
+// quarter degrees or ADC counts.
+const double fixedThresholds[2][4] = {{SIM_MAX_TEMP, SIM_MIN_TEMP, SIM_MAX_PRESSURE, SIM_PUMPED_DOWN_PRESSURE},
+                                      {75.1, 74.9, 2.5, 1.0003}};
+
+// The float (as on the Arduino), double (as on the host) and fixed-point interlocks with the same thresholds.
+class InterlockCheck{
+  public:
+	FloatInterlock floatInterlock;
+	OvenInterlock doubleInterlock;
+	FixedInterlock fixedInterlock;
+
+	InterlockCheck(const double *thresholds_) :
+		floatInterlock(thresholds_[0], thresholds_[1], thresholds_[2], thresholds_[3]),
+		doubleInterlock(thresholds_[0], thresholds_[1], thresholds_[2], thresholds_[3]),
+		fixedInterlock(TEMP_QUARTERS_UP(thresholds_[0]), TEMP_QUARTERS(thresholds_[1]), PRESSURE_COUNTS(thresholds_[2]), PRESSURE_COUNTS(thresholds_[3])) { }
+
+	// Evaluate all three interlocks with a thermocouple reading (quarter degrees) and pressure
+	// reading (summed ADC counts), converted the way each firmware does. Return true if the relay
+	// outputs and interlock states are the same.
+	bool evaluate(const int &relay1Request_, const int &relay2Request_, const int16_t &quarters_, const uint16_t &counts_){
+		float temp = (quarters_ == TEMP_INVALID ? NAN : 0.25f*quarters_);
+		int floatRelay1, floatRelay2, doubleRelay1, doubleRelay2, fixedRelay1, fixedRelay2;
+		floatInterlock.evaluate(relay1Request_, relay2Request_, temp, 5.0f*counts_/(1023.0f*SIM_PRESSURE_OVERSAMPLE), floatRelay1, floatRelay2);
+		doubleInterlock.evaluate(relay1Request_, relay2Request_, temp, 5.0*counts_/(1023.0*SIM_PRESSURE_OVERSAMPLE), doubleRelay1, doubleRelay2);
+		fixedInterlock.evaluate(relay1Request_, relay2Request_, quarters_, counts_, fixedRelay1, fixedRelay2);
+		return (floatRelay1 == fixedRelay1 && floatRelay2 == fixedRelay2 && doubleRelay1 == fixedRelay1 && doubleRelay2 == fixedRelay2 &&
+		        floatInterlock.isOverTemp() == fixedInterlock.isOverTemp() && doubleInterlock.isOverTemp() == fixedInterlock.isOverTemp() &&
+		        floatInterlock.isPumpedDown() == fixedInterlock.isPumpedDown() && doubleInterlock.isPumpedDown() == fixedInterlock.isPumpedDown());
+	}
+};
+
+// Evaluate a single reading with every interlock state and relay request. Return the number of mismatches.
+size_t checkReading(const double *thresholds_, const int16_t &quarters_, const uint16_t &counts_, size_t &evaluations_){
+	const uint16_t fullScale = ADC_FULL_SCALE*PRESSURE_OVERSAMPLE;
+	size_t mismatches = 0;
+	for(int state = 0; state < 4; state++){
+		for(int request = 0; request < 4; request++){
+			// Put the interlocks into the over temperature and pumped down states first.
+			InterlockCheck check(thresholds_);
+			check.evaluate(0, state & 1, ((state & 2) ? 4*200 : 0), ((state & 1) ? 0 : fullScale));
+			if(!check.evaluate(request & 1, (request >> 1) & 1, quarters_, counts_)){
+				if(mismatches++ == 0){
+					std::cout << " ERROR: Fixed-point interlock mismatch for T=" << quartersToCelsius(quarters_) << " C, P=" << counts_ << " counts (state=" << state << ", request=" << request << ")!\n";
+				}
+			}
+			evaluations_++;
+		}
+	}
+	return mismatches;
+}
+
+bool benchFixed(const size_t &N_){
+	const uint16_t fullScale = ADC_FULL_SCALE*PRESSURE_OVERSAMPLE;
+
+	// Check every pressure reading against a range of temperatures around the thresholds, and every
+	// temperature reading (including thermocouple faults) against a range of pressures around the thresholds.
+	size_t evaluations = 0, mismatches = 0;
+	benchClock::time_point start = startTimer();
+	for(size_t i = 0; i < 2; i++){
+		const double *thresholds = fixedThresholds[i];
+		std::vector<int16_t> temps(1, TEMP_INVALID);
+		std::vector<uint16_t> pressures(1, 0);
+		for(int j = -2; j <= 2; j++){
+			temps.push_back(TEMP_QUARTERS(thresholds[0])+j);
+			temps.push_back(TEMP_QUARTERS(thresholds[1])+j);
+			pressures.push_back(PRESSURE_COUNTS(thresholds[2])+j);
+			pressures.push_back(PRESSURE_COUNTS(thresholds[3])+j);
+		}
+		pressures.push_back(fullScale);
+
+		for(uint16_t counts = 0; counts <= fullScale; counts++){
+			for(std::vector<int16_t>::iterator iter = temps.begin(); iter != temps.end(); iter++){
+				mismatches += checkReading(thresholds, *iter, counts, evaluations);
+			}
+		}
+		for(int quarters = -8192; quarters < 8192; quarters++){
+			for(std::vector<uint16_t>::iterator iter = pressures.begin(); iter != pressures.end(); iter++){
+				mismatches += checkReading(thresholds, (int16_t)quarters, *iter, evaluations);
+			}
+		}
+	}
+	report("fixed interlock equivalence", evaluations, elapsed(start));
+	if(mismatches > 0){ std::cout << " ERROR: " << mismatches << " of " << evaluations << " fixed-point interlock decisions differ!\n"; }
+
+	// Every reading must survive the compact frame and the host calibration unchanged.
+	std::vector<char> data((fullScale+1)*FRAME_MAX_LENGTH+1);
+	size_t len = 0;
+	data[len++] = FRAME_DELIMITER; // The decoder synchronizes on the delimiter before the first frame.
+	for(uint16_t counts = 0; counts <= fullScale; counts++){
+		int16_t quarters = (counts == fullScale ? TEMP_INVALID : (int16_t)(counts-4096));
+		len += encodePacket(FORMAT_FRAMED, &data[len], counts, 1000*counts, quartersToCelsius(quarters), countsToVolts(counts), counts & 1, 1, true);
+	}
+	PacketColumns cols;
+	FrameDecoder frames;
+	size_t errors = 0;
+	start = startTimer();
+	size_t count = frames.decode(data.data(), len, cols);
+	report("fixed compact decode", count, elapsed(start), len);
+	for(size_t i = 0; i < count; i++){
+		int16_t quarters = (i == fullScale ? TEMP_INVALID : (int16_t)(i-4096));
+		if(std::isnan(cols.temperature[i]) != (quarters == TEMP_INVALID) || (quarters != TEMP_INVALID && cols.temperature[i] != quartersToCelsius(quarters)) ||
+		   cols.pressure[i] != countsToVolts(i) || cols.relay1[i] != (short)(i & 1) || cols.relay2[i] != 1){ errors++; }
+	}
+	if(count != fullScale+1u || errors > 0){ std::cout << " ERROR: " << errors << " of " << count << " compact frames decoded incorrectly!\n"; }
+
+	// Time the firmware conversion of the pressure readings.
+	volatile float floatSum = 0;
+	volatile uint32_t fixedSum = 0;
+	start = startTimer();
+	for(size_t i = 0; i < N_; i++){ floatSum = floatSum+5.0f*(i % (fullScale+1))/(1023.0f*SIM_PRESSURE_OVERSAMPLE); }
+	report("fixed float conversion", N_, elapsed(start));
+	start = startTimer();
+	for(size_t i = 0; i < N_; i++){ fixedSum = fixedSum+(uint16_t)(i % (fullScale+1)); }
+	report("fixed integer readings", N_, elapsed(start));
+
+	return (mismatches == 0 && count == fullScale+1u && errors == 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Relay edge detection
+///////////////////////////////////////////////////////////////////////////////
+
+// Generate relay samples as runs of random length, so that changes fall anywhere within and across
+// the 8 sample blocks of the SIMD kernel. Values other than 0 and 1 (e.g. corrupt packets) are included.
+void generateRelays(std::vector<short> &relay_, std::vector<unsigned int> &time_, const size_t &N_, std::mt19937 &generator_){
+	const short values[6] = {0, 1, 0, 1, 2, 171};
+	std::uniform_int_distribution<int> value(0, 5);
+	std::uniform_int_distribution<int> runLength(1, 20);
+	relay_.clear();
+	time_.clear();
+	while(relay_.size() < N_){
+		short sample = values[value(generator_)];
+		for(int i = runLength(generator_); i > 0 && relay_.size() < N_; i--){
+			time_.push_back(1000*time_.size());
+			relay_.push_back(sample);
+		}
+	}
+}
+
+// Add samples to relay intervals in pieces of random length. Return the time taken (s).
+double addRelays(RelayIntervals &intervals_, const std::vector<short> &relay_, const std::vector<unsigned int> &time_, std::mt19937 &generator_, const size_t &maxPiece_){
+	std::uniform_int_distribution<size_t> piece(1, maxPiece_);
+	benchClock::time_point start = startTimer();
+	for(size_t i = 0; i < relay_.size(); ){
+		size_t len = std::min(piece(generator_), relay_.size()-i);
+		intervals_.add(&relay_[i], &time_[i], len);
+		i += len;
+	}
+	return elapsed(start);
+}
+
+// Return true if two sets of relay intervals are identical.
+bool sameIntervals(const RelayIntervals &intervals1_, const RelayIntervals &intervals2_){
+	return (intervals1_.open == intervals2_.open && intervals1_.close == intervals2_.close && intervals1_.isOn() == intervals2_.isOn() &&
+	        intervals1_.getDutyCycle() == intervals2_.getDutyCycle());
+}
+
+// Check the SIMD relay edge search against the scalar search and against a direct implementation of
+// the relay rules, with the input split into pieces of random length.
+bool benchRelays(const size_t &N_){
+	std::mt19937 generator(0);
+	std::vector<short> relay;
+	std::vector<unsigned int> time;
+	generateRelays(relay, time, N_, generator);
+
+	// The relay turns on at a 1 while it is off, and off at a 0 while it is on.
+	std::vector<double> open, close;
+	double onTime = 0;
+	for(size_t i = 0; i < relay.size(); i++){
+		if(open.size() == close.size() && relay[i] == 1){ open.push_back(time[i]); }
+		else if(open.size() > close.size() && relay[i] == 0){
+			close.push_back(time[i]);
+			onTime += close.back()-open.back();
+		}
+	}
+	if(open.size() > close.size()){ onTime += time.back()-open.back(); }
+	const double duty = onTime/(time.back()-time.front());
+
+	bool passed = true;
+	const size_t pieces[3] = {1, 13, N_};
+	for(int j = 0; j < 3; j++){
+		RelayIntervals simd, scalar;
+		scalar.setScalar();
+		double simdTime = addRelays(simd, relay, time, generator, pieces[j]);
+		double scalarTime = addRelays(scalar, relay, time, generator, pieces[j]);
+		if(j == 2){
+			report("relays simd", relay.size(), simdTime);
+			report("relays scalar", relay.size(), scalarTime);
+		}
+		if(!sameIntervals(simd, scalar) || simd.open != open || simd.close != close || simd.getDutyCycle() != duty){
+			std::cout << " ERROR: SIMD, scalar and expected relay intervals differ with pieces of up to " << pieces[j] << " samples (" << simd.open.size() << ", " << scalar.open.size() << " and " << open.size() << " intervals)!\n";
+			passed = false;
+		}
+	}
+	return passed;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Telemetry ring
+///////////////////////////////////////////////////////////////////////////////
+
+// Return true if every field of a telemetry sample holds the index stored in its host time, so
+// that a sample copied while the writer was overwriting its slot is detected.
+bool checkSample(const TelemetrySample &sample_){
+	const uint64_t index = sample_.hostTime;
+	return (sample_.timestamp == (uint32_t)index && sample_.temperature == (float)(index & 0xFFFFFF) && sample_.pressure == (float)(index >> 24) &&
+	        sample_.relay1 == (int16_t)index && sample_.relay2 == (int16_t)(index >> 16));
+}
+
+// Publish samples to a small telemetry ring from one thread while another thread reads them, so
+// that the writer laps the reader. Every sample read must be intact and newer than the last one,
+// and every sample must be either read or counted as lost.
+bool benchTelemetry(const size_t &N_){
+	const std::string name = "/ovenBench" + std::to_string(getpid());
+	TelemetryWriter writer;
+	TelemetryReader reader;
+	if(!writer.open(name, 64) || !reader.open(name, true)){
+		std::cout << " ERROR: Failed to open telemetry ring '" << name << "'!\n";
+		return false;
+	}
+
+	const size_t N = 10*N_;
+	size_t torn = 0;
+	size_t unordered = 0;
+	benchClock::time_point start = startTimer();
+	std::thread readerThread([&](){
+		TelemetrySample sample;
+		uint64_t last = 0;
+		bool first = true;
+		TelemetryStatus status;
+		while((status = reader.read(sample)) != TELEMETRY_CLOSED){
+			if(status == TELEMETRY_NONE){
+				std::this_thread::yield();
+				continue;
+			}
+			if(!checkSample(sample)){ torn++; }
+			else if(!first && sample.hostTime <= last){ unordered++; }
+			last = sample.hostTime;
+			first = false;
+		}
+	});
+	for(uint64_t i = 0; i < N; i++){
+		writer.publish(i, (uint32_t)i, (float)(i & 0xFFFFFF), (float)(i >> 24), (int16_t)i, (int16_t)(i >> 16));
+		if(i % 100 == 0){ std::this_thread::yield(); } // Let the reader run, even on a single core.
+	}
+	const uint64_t published = writer.getNumPublished();
+	writer.close();
+	readerThread.join();
+	report("telemetry", N, elapsed(start));
+	std::cout << "   " << reader.getNumRead() << " read, " << reader.getNumLost() << " lost\n";
+
+	bool passed = true;
+	if(torn > 0 || unordered > 0){
+		std::cout << " ERROR: Read " << torn << " torn and " << unordered << " out of order telemetry samples!\n";
+		passed = false;
+	}
+	if(reader.getNumRead()+reader.getNumLost() != published){
+		std::cout << " ERROR: " << reader.getNumRead() << " read and " << reader.getNumLost() << " lost telemetry samples, expected " << published << "!\n";
+		passed = false;
+	}
+	return passed;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Data file decoding, formatting and parsing
+///////////////////////////////////////////////////////////////////////////////
+
+// Directory containing the tools (the directory of this executable).
+std::string execDir = ".";
+
+// Temporary directory for generated input and tool output files.
+std::string tempDir;
+
+// Input file of the file benchmarks.
+std::string inputPath;
+MappedFile inputFile;
+size_t inputOffset = 0;
+PacketFormat inputFormat = FORMAT_LEGACY;
+
+// Remove a directory and everything in it.
+void removeTree(const std::string &path_){
+	DIR *dir = opendir(path_.c_str());
+	if(!dir){ return; }
+	struct dirent *entry;
+	while((entry = readdir(dir))){
+		if(strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0){ continue; }
+		std::string path = path_+"/"+entry->d_name;
+		struct stat info;
+		if(lstat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode)){ removeTree(path); }
+		else{ unlink(path.c_str()); }
+	}
+	closedir(dir);
+	rmdir(path_.c_str());
+}
+
+// Remove the temporary directory and the files written to it.
+void removeTempDir(){
+	if(tempDir.empty()){ return; }
+	inputFile.close();
+	removeTree(tempDir);
+}
+
+// Write a synthetic legacy data file of N_ packets from the oven model, with a fraction
+// corrupt_ of the bytes replaced with noise. Return false if the file could not be written.
+bool generateFile(const std::string &fname_, const size_t &N_, const double &corrupt_){
+	std::ofstream output(fname_.c_str(), std::ios::binary);
+	if(!output.good()){ return false; }
+
+	char header[HEADER_MAX_LENGTH];
+	output.write(header, encodeHeader(FORMAT_LEGACY, header));
+
+	OvenModel oven;
+	LineNoise noise(0, corrupt_);
+	std::vector<char> block(PACKET_BLOCK_SIZE*PACKET_LENGTH);
+	size_t count = 0;
+	while(count < N_){
+		size_t len = 0;
+		for(; count < N_ && len < block.size(); count++){
+			oven.step();
+			len += encodePacket(FORMAT_LEGACY, &block[len], count, oven.getTimestamp(), oven.getTemperature(), oven.getPressure(), oven.getRelay1(), oven.getRelay2());
+		}
+		len = noise.apply(&block[0], len);
+		output.write(&block[0], len);
+	}
+
+	return output.good();
+}
+
+// Open the input file of the file benchmarks, generating it first if no input file was given.
+// Return false if the file could not be opened.
+bool openInput(const size_t &N_, const double &corrupt_){
+	if(inputFile.isOpen()){ return true; }
+
+	if(inputPath.empty()){
+		inputPath = tempDir+"/generated.dat";
+		if(!generateFile(inputPath, N_, corrupt_)){
+			std::cout << " ERROR: Failed to write generated input file '" << inputPath << "'!\n";
+			return false;
+		}
+	}
+
+	if(!inputFile.open(inputPath)){
+		std::cout << " ERROR: Failed to open input file '" << inputPath << "'!\n";
+		return false;
+	}
+
+	char title[64];
+	inputOffset = readTitle(inputFile.getData(), inputFile.getSize(), title, 64);
+	inputFormat = detectFormat(inputFile.getData()+inputOffset, inputFile.getSize()-inputOffset);
+	if(inputFormat != FORMAT_FRAMED){ inputFormat = FORMAT_LEGACY; }
+
+	return true;
+}
+
+// Decode the entire input file. Return the number of packets decoded.
+size_t decodeInput(PacketColumns &cols_, const bool &scalar_=false, const bool &resync_=false){
+	cols_.clear();
+	if(inputFormat == FORMAT_FRAMED){
+		FrameDecoder frames;
+		frames.setInput(inputFile.getData(), inputFile.getSize(), inputOffset);
+		while(frames.decode(cols_)){ }
+	}
+	else{
+		BatchDecoder decoder(inputFile.getData(), inputFile.getSize(), inputOffset);
+		decoder.setScalar(scalar_ || !BatchDecoder::haveSIMD());
+		decoder.setResync(resync_);
+		while(decoder.decode(cols_)){ }
+	}
+	return cols_.size();
+}
+
+// Return true if two files are identical.
+bool sameFiles(const std::string &fname1_, const std::string &fname2_){
+	MappedFile file1, file2;
+	if(!file1.open(fname1_) || !file2.open(fname2_)){ return false; }
+	if(file1.getSize() != file2.getSize()){ return false; }
+	return (file1.getSize() == 0 || memcmp(file1.getData(), file2.getData(), file1.getSize()) == 0);
+}
+
+// Return true if two sets of columns are bitwise identical.
+bool sameColumns(const PacketColumns &cols1_, const PacketColumns &cols2_){
+	const size_t N = cols1_.size();
+	if(cols2_.size() != N){ return false; }
+	if(N == 0){ return true; }
+	return (memcmp(&cols1_.timestamp[0], &cols2_.timestamp[0], N*sizeof(unsigned int)) == 0 && memcmp(&cols1_.temperature[0], &cols2_.temperature[0], N*sizeof(float)) == 0 &&
+	        memcmp(&cols1_.pressure[0], &cols2_.pressure[0], N*sizeof(float)) == 0 && memcmp(&cols1_.relay1[0], &cols2_.relay1[0], N*sizeof(short)) == 0 &&
+	        memcmp(&cols1_.relay2[0], &cols2_.relay2[0], N*sizeof(short)) == 0);
+}
+
+bool benchDecode(const size_t &N_, const double &corrupt_){
+	if(!openInput(N_, corrupt_)){ return false; }
+
+	PacketColumns cols;
+	const size_t size = inputFile.getSize();
+	if(inputFormat == FORMAT_FRAMED){
+		runStage("decode framed", size, [&](){ return decodeInput(cols); });
+		return true;
+	}
+	if(BatchDecoder::haveSIMD()){
+		runStage("decode simd", size, [&](){ return decodeInput(cols); });
+	}
+	runStage("decode scalar", size, [&](){ return decodeInput(cols, true); });
+	runStage("decode resync", size, [&](){ return decodeInput(cols, false, true); });
+
+	// Resync mode must reject the same packets whether or not the SIMD kernel is available.
+	PacketColumns scalarCols;
+	decodeInput(scalarCols, true, true);
+	if(!sameColumns(cols, scalarCols)){
+		std::cout << " ERROR: SIMD and scalar resync decoding give different packets (" << cols.size() << " vs. " << scalarCols.size() << ")!\n";
+		return false;
+	}
+	return true;
+}
+
+bool benchConvert(const size_t &N_, const double &corrupt_){
+	if(!openInput(N_, corrupt_)){ return false; }
+
+	PacketColumns cols;
+	decodeInput(cols);
+
+	runStage("sciNotation", 0, [&](){
+		char buf[32];
+		size_t len = 0;
+		for(size_t i = 0; i < cols.size(); i++){
+			len += sciNotation(buf, calibratePressure(cols.pressure[i]))-buf;
+		}
+		return (len > 0 ? cols.size() : 0);
+	});
+
+	// Decode and format the entire file, as loggerUnpacker does.
+	std::ofstream null("/dev/null");
+	runStage("convert csv", inputFile.getSize(), [&](){
+		size_t count = decodeInput(cols);
+		writerFormat(null, cols);
+		null.flush();
+		return count;
+	});
+	return true;
+}
+
+// Compress the packets of the input file and decode them again. Throughput is given relative to
+// the size of the input file, so that it may be compared with the decode benchmarks.
+bool benchCodec(const size_t &N_, const double &corrupt_){
+	if(!openInput(N_, corrupt_)){ return false; }
+
+	PacketColumns cols;
+	decodeInput(cols);
+	if(cols.size() == 0){ return true; }
+
+	std::vector<char> encoded;
+	encoded.reserve(4*cols.size());
+	runStage("codec encode", inputFile.getSize(), [&](){
+		encoded.clear();
+		for(size_t start = 0; start < cols.size(); start += CODEC_BLOCK_SIZE){
+			CodecWriter::encodeBlock(cols, start, std::min((size_t)CODEC_BLOCK_SIZE, cols.size()-start), encoded);
+		}
+		return cols.size();
+	});
+	std::cout << "   " << inputFile.getSize() << " bytes compressed to " << encoded.size() << " bytes (ratio " << (double)inputFile.getSize()/encoded.size();
+	std::cout << ", " << (double)encoded.size()/cols.size() << " bytes/record)\n";
+
+	PacketColumns decoded;
+	decoded.reserve(cols.size());
+	runStage("codec decode", inputFile.getSize(), [&](){
+		decoded.clear();
+		for(size_t offset = 0; offset < encoded.size(); ){
+			size_t len = CodecReader::decodeBlock(&encoded[offset], encoded.size()-offset, decoded);
+			if(len == 0){ break; }
+			offset += len;
+		}
+		return decoded.size();
+	});
+
+	if(decoded.size() != cols.size() || memcmp(&decoded.timestamp[0], &cols.timestamp[0], 4*cols.size()) != 0 ||
+	   memcmp(&decoded.temperature[0], &cols.temperature[0], 4*cols.size()) != 0 || memcmp(&decoded.pressure[0], &cols.pressure[0], 4*cols.size()) != 0 ||
+	   memcmp(&decoded.relay1[0], &cols.relay1[0], 2*cols.size()) != 0 || memcmp(&decoded.relay2[0], &cols.relay2[0], 2*cols.size()) != 0){
+		std::cout << " ERROR: Decoded packets do not match the input file!\n";
+		return false;
+	}
+	return true;
+}
+
+// Compute tumbling and sliding window statistics of the input file, and check the statistics of
+// the entire run against a two-pass calculation.
+bool benchStats(const size_t &N_, const double &corrupt_){
+	if(!openInput(N_, corrupt_)){ return false; }
+
+	PacketColumns cols;
+	decodeInput(cols);
+	if(cols.size() == 0){ return true; }
+	for(size_t i = 0; i < cols.size(); i++){
+		cols.pressure[i] = calibratePressure(cols.pressure[i]);
+	}
+
+	std::ofstream null("/dev/null");
+	WindowStats stats;
+	const double slides[2] = {STATS_WINDOW, STATS_WINDOW/60.0};
+	const char *names[2] = {"stats tumbling", "stats sliding"};
+	for(int j = 0; j < 2; j++){
+		runStage(names[j], inputFile.getSize(), [&](){
+			stats = WindowStats();
+			stats.setWindow(STATS_WINDOW, slides[j]);
+			stats.setOutput(&null);
+			for(size_t i = 0; i < cols.size(); i++){
+				stats.add(cols.timestamp[i], cols.temperature[i], cols.pressure[i], cols.relay1[i], cols.relay2[i]);
+			}
+			stats.flush();
+			return cols.size();
+		});
+		std::cout << "   " << stats.getNumWindows() << " windows\n";
+	}
+
+	double sum = 0;
+	size_t count = 0;
+	for(size_t i = 0; i < cols.size(); i++){
+		if(std::isfinite(cols.temperature[i])){
+			sum += cols.temperature[i];
+			count++;
+		}
+	}
+	const double mean = (count > 0 ? sum/count : 0);
+	double sum2 = 0;
+	for(size_t i = 0; i < cols.size(); i++){
+		if(std::isfinite(cols.temperature[i])){ sum2 += (cols.temperature[i]-mean)*(cols.temperature[i]-mean); }
+	}
+	const double stddev = (count > 1 ? std::sqrt(sum2/(count-1)) : 0);
+
+	const RunningStats &total = stats.getTotal().temperature;
+	if(total.getCount() != count || std::fabs(total.getMean()-mean) > 1E-9*(1+std::fabs(mean)) || std::fabs(total.getStdDev()-stddev) > 1E-6*(1+stddev)){
+		std::cout << " ERROR: Window statistics do not match the two-pass calculation!\n";
+		return false;
+	}
+	return true;
+}
+
+// Decode the input file from offset_ and keep the packets with a timestamp of at least time_ (ms).
+// The junk first packet is skipped when decoding from the start of the data.
+size_t decodeFrom(PacketColumns &cols_, const size_t &offset_, const unsigned int &time_){
+	BatchDecoder decoder(inputFile.getData(), inputFile.getSize(), offset_);
+	cols_.clear();
+	while(decoder.decode(cols_)){ }
+	size_t count = 0;
+	for(size_t i = (offset_ == inputOffset ? 1 : 0); i < cols_.size(); i++){
+		if(cols_.timestamp[i] < time_){ continue; }
+		cols_.timestamp[count] = cols_.timestamp[i];
+		cols_.temperature[count] = cols_.temperature[i];
+		cols_.pressure[count] = cols_.pressure[i];
+		cols_.relay1[count] = cols_.relay1[i];
+		cols_.relay2[count] = cols_.relay2[i];
+		count++;
+	}
+	cols_.resize(count);
+	return count;
+}
+
+// Build the time index of the input file, and check that decoding from the offset returned for a
+// start time gives the same packets as decoding the entire file and dropping the earlier packets.
+bool benchIndex(const size_t &N_, const double &corrupt_){
+	if(!openInput(N_, corrupt_)){ return false; }
+	if(inputFormat != FORMAT_LEGACY){
+		std::cout << "  index: Skipped, the time index may only be used with legacy files\n";
+		return true;
+	}
+
+	TimeIndex tindex;
+	runStage("index build", inputFile.getSize(), [&](){
+		tindex.build(inputFile.getData(), inputFile.getSize(), inputOffset);
+		return tindex.getNumRecords();
+	});
+
+	// Start times at, just before and just after the first timestamp of every block of the index,
+	// at random packets, and before and after the entire file.
+	std::vector<unsigned int> times;
+	BatchDecoder decoder(inputFile.getData(), inputFile.getSize(), inputOffset);
+	PacketColumns block;
+	while(!decoder.eof()){
+		block.clear();
+		if(decoder.decode(block, TIME_INDEX_STRIDE) == 0){ break; }
+		times.push_back(block.timestamp[0]);
+		times.push_back(block.timestamp[0]-1);
+		times.push_back(block.timestamp[0]+1);
+	}
+	PacketColumns cols;
+	decodeInput(cols);
+	std::mt19937 generator(0);
+	for(int i = 0; i < 100 && cols.size() > 0; i++){
+		times.push_back(cols.timestamp[std::uniform_int_distribution<size_t>(0, cols.size()-1)(generator)]);
+	}
+	times.push_back(0);
+	times.push_back(UINT_MAX);
+
+	size_t mismatches = 0;
+	size_t skipped = 0;
+	PacketColumns expected, found;
+	for(size_t j = 0; j < times.size(); j++){
+		size_t offset = tindex.find(times[j]);
+		if(offset > inputOffset){ skipped++; }
+		decodeFrom(expected, inputOffset, times[j]);
+		decodeFrom(found, offset, times[j]);
+		if(!sameColumns(expected, found)){
+			if(mismatches++ == 0){
+				std::cout << " ERROR: Decoding from offset " << offset << " for time " << times[j] << " ms gives " << found.size() << " packets, expected " << expected.size() << "!\n";
+			}
+		}
+	}
+	std::cout << "   " << tindex.getNumEntries() << " entries, " << times.size() << " start times (" << skipped << " skipped data)" << (tindex.isMonotonic() ? "" : ", not monotonic") << "\n";
+	if(mismatches > 0){
+		std::cout << " ERROR: " << mismatches << " of " << times.size() << " time index searches give the wrong packets!\n";
+		return false;
+	}
+	return true;
+}
+
+// Write a legacy data file with a junk first packet followed by one packet for each timestamp.
+// Return false if the file could not be written.
+bool writeDumpFile(const std::string &fname_, const char *title_, const std::vector<unsigned int> &times_){
+	std::ofstream output(fname_.c_str(), std::ios::binary);
+	if(!output.good()){ return false; }
+
+	char buffer[HEADER_MAX_LENGTH+PACKET_LENGTH];
+	output.write(buffer, encodeHeader(FORMAT_LEGACY, buffer, title_));
+	output.write(buffer, encodePacket(FORMAT_LEGACY, buffer, 0, 12345, 0, 0, 0, 0));
+	for(size_t i = 0; i < times_.size(); i++){
+		output.write(buffer, encodePacket(FORMAT_LEGACY, buffer, i+1, times_[i], 20+i, 1000, 0, 0));
+	}
+
+	return output.good();
+}
+
+// Merge a small SD card dump which covers each of the timeline rules of DumpMerger, and check the
+// merged timestamps, the number of segments and the events counted for each file.
+bool benchMerge(){
+	const std::string dir = tempDir+"/dump";
+	removeTree(dir);
+	if(mkdir(dir.c_str(), 0755) != 0){
+		std::cout << " ERROR: Failed to create directory '" << dir << "'!\n";
+		return false;
+	}
+
+	const uint64_t wrap = 1ULL << 32;
+	const unsigned int numFiles = 5;
+	const char *titles[numFiles] = {"oven A", "oven A", "oven A", "oven A", "oven B"};
+	const std::vector<unsigned int> times[numFiles] = {
+		{1000, 2000, 3000},
+		{4000, 5000}, // Hot-swapped card, the same boot continues.
+		{(unsigned int)(wrap-1500), (unsigned int)(wrap-500), 500, 1500, 700, 2500}, // millis() wraparound, then an out of order packet.
+		{100, 200}, // Reboot with the same firmware.
+		{50, 60} // Reboot with new firmware.
+	};
+	const unsigned int reboots[numFiles] = {0, 0, 0, 1, 1};
+	const unsigned int wraps[numFiles] = {0, 0, 1, 0, 0};
+	const unsigned int outOfOrder[numFiles] = {0, 0, 1, 0, 0};
+	const size_t numSegments = 7;
+
+	// Each reboot starts one millisecond after the latest merged time so far.
+	const std::vector<uint64_t> expected = {
+		1000, 2000, 3000, 4000, 5000, wrap-1500, wrap-500, wrap+500, wrap+700, wrap+1500, wrap+2500,
+		wrap+2601, wrap+2701, wrap+2752, wrap+2762
+	};
+
+	for(unsigned int i = 0; i < numFiles; i++){
+		std::string fname = dir+"/DATA000"+std::to_string(i+1)+".DAT";
+		if(!writeDumpFile(fname, titles[i], times[i])){
+			std::cout << " ERROR: Failed to write dump file '" << fname << "'!\n";
+			return false;
+		}
+	}
+
+	DumpMerger merger;
+	merger.addDirectory(dir);
+	merger.decode(2);
+	std::ostringstream output;
+	CsvWriter writer(&output);
+	size_t count = merger.merge(writer);
+	writer.flush();
+
+	// The merged time is the first column of each row.
+	std::vector<uint64_t> merged;
+	std::istringstream input(output.str());
+	std::string line;
+	while(std::getline(input, line)){ merged.push_back(strtoull(line.c_str(), NULL, 10)); }
+
+	bool passed = true;
+	if(count != expected.size() || merged != expected){
+		std::cout << " ERROR: Merged " << count << " packets with the wrong timestamps, expected " << expected.size() << "!\n";
+		passed = false;
+	}
+	if(merger.getSegments().size() != numSegments){
+		std::cout << " ERROR: Merged " << merger.getSegments().size() << " time segments, expected " << numSegments << "!\n";
+		passed = false;
+	}
+	const std::vector<DumpFile> &files = merger.getFiles();
+	for(unsigned int i = 0; i < numFiles && i < files.size(); i++){
+		if(files[i].numReboots != reboots[i] || files[i].numWraps != wraps[i] || files[i].numOutOfOrder != outOfOrder[i]){
+			std::cout << " ERROR: Found " << files[i].numReboots << " reboots, " << files[i].numWraps << " wraparounds and " << files[i].numOutOfOrder << " out of order packets in file " << i+1 << ", expected " << reboots[i] << ", " << wraps[i] << " and " << outOfOrder[i] << "!\n";
+			passed = false;
+		}
+	}
+	std::cout << "   " << files.size() << " files, " << count << " packets, " << merger.getSegments().size() << " segments\n";
+	return passed;
+}
+
+// Read or write an entire buffer. Return false on error or end of file.
+bool readFully(const int &fd_, char *data_, size_t len_){
+	while(len_ > 0){
+		ssize_t count = read(fd_, data_, len_);
+		if(count < 0 && errno == EINTR){ continue; }
+		if(count <= 0){ return false; }
+		data_ += count;
+		len_ -= count;
+	}
+	return true;
+}
+
+bool writeFully(const int &fd_, const char *data_, size_t len_){
+	while(len_ > 0){
+		ssize_t count = write(fd_, data_, len_);
+		if(count < 0 && errno == EINTR){ continue; }
+		if(count <= 0){ return false; }
+		data_ += count;
+		len_ -= count;
+	}
+	return true;
+}
+
+// Runs tools from a small process which is forked before the benchmarks allocate any memory.
+// The peak RSS of a forked process starts at the RSS of its parent and is kept across exec,
+// so tools forked directly from the benchmark would report at least its memory use.
+class ToolLauncher{
+  public:
+	ToolLauncher() : pid(-1), request(-1), response(-1) { }
+
+	~ToolLauncher(){ stop(); }
+
+	// Fork the launcher process. Return false on failure.
+	bool start(){
+		int requestPipe[2], responsePipe[2];
+		if(pipe(requestPipe) != 0){ return false; }
+		if(pipe(responsePipe) != 0){
+			close(requestPipe[0]);
+			close(requestPipe[1]);
+			return false;
+		}
+		pid = fork();
+		if(pid == 0){
+			close(requestPipe[1]);
+			close(responsePipe[0]);
+			serve(requestPipe[0], responsePipe[1]);
+			_exit(0);
+		}
+		close(requestPipe[0]);
+		close(responsePipe[1]);
+		request = requestPipe[1];
+		response = responsePipe[0];
+		if(pid < 0){
+			stop();
+			return false;
+		}
+		return true;
+	}
+
+	// Run a tool in directory dir_ with its output discarded. Return the exit status of the tool
+	// (or -1 on failure), and the peak RSS of the tool in peakRSS_ (kB).
+	int run(const std::vector<std::string> &args_, const std::string &dir_, long &peakRSS_){
+		if(pid < 0){ return -1; }
+
+		// Send the directory and arguments as consecutive null terminated strings.
+		std::string message = dir_+'\0';
+		for(size_t i = 0; i < args_.size(); i++){ message += args_[i]+'\0'; }
+		unsigned int len = message.size();
+		if(!writeFully(request, (const char*)&len, sizeof(len)) || !writeFully(request, message.data(), len)){ return -1; }
+
+		int status;
+		if(!readFully(response, (char*)&status, sizeof(status)) || !readFully(response, (char*)&peakRSS_, sizeof(peakRSS_))){ return -1; }
+		return status;
+	}
+
+	// Stop the launcher process.
+	void stop(){
+		if(request >= 0){ close(request); }
+		if(response >= 0){ close(response); }
+		if(pid > 0){ waitpid(pid, NULL, 0); }
+		pid = -1;
+		request = -1;
+		response = -1;
+	}
+
+  private:
+	pid_t pid;
+	int request;
+	int response;
+
+	// Launcher process main loop. Runs one tool per request until the request pipe is closed.
+	static void serve(const int &request_, const int &response_){
+		unsigned int len;
+		while(readFully(request_, (char*)&len, sizeof(len))){
+			std::vector<char> message(len);
+			if(!readFully(request_, &message[0], len)){ break; }
+
+			std::vector<char*> argv;
+			for(size_t i = strlen(&message[0])+1; i < len; i += strlen(&message[i])+1){ argv.push_back(&message[i]); }
+			argv.push_back(NULL);
+
+			int status = -1;
+			long peakRSS = 0;
+			pid_t child = fork();
+			if(child == 0){
+				int null = open("/dev/null", O_WRONLY);
+				dup2(null, 1);
+				dup2(null, 2);
+				if(chdir(&message[0]) != 0){ _exit(127); }
+				execv(argv[0], &argv[0]);
+				_exit(127);
+			}
+			struct rusage usage;
+			if(child > 0 && wait4(child, &status, 0, &usage) == child){
+				status = (WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+				peakRSS = usage.ru_maxrss;
+			}
+			if(!writeFully(response_, (const char*)&status, sizeof(status)) || !writeFully(response_, (const char*)&peakRSS, sizeof(peakRSS))){ break; }
+		}
+	}
+};
+
+ToolLauncher launcher;
+
+// Time a tool numRepeat times and report the fastest run.
+bool benchTool(const std::string &name_, const std::vector<std::string> &args_, const size_t &records_, const size_t &bytes_){
+	double best = -1;
+	long peakRSS = 0;
+	for(int i = 0; i < numRepeat; i++){
+		long peak = 0;
+		benchClock::time_point start = benchClock::now();
+		int status = launcher.run(args_, tempDir, peak);
+		double seconds = elapsed(start);
+		if(status != 0){
+			std::cout << " ERROR: " << name_ << " failed with status " << status << "!\n";
+			return false;
+		}
+		if(best < 0 || seconds < best){ best = seconds; }
+		if(peak > peakRSS){ peakRSS = peak; }
+	}
+	report(name_, records_, best, bytes_, peakRSS);
+	return true;
+}
+
+bool benchTools(const size_t &N_, const double &corrupt_){
+	if(!openInput(N_, corrupt_)){ return false; }
+
+	const char *tools[2] = {"loggerUnpacker", "csvReader"};
+	for(int i = 0; i < 2; i++){
+		if(access((execDir+"/"+tools[i]).c_str(), X_OK) != 0){
+			std::cout << " Error! " << tools[i] << " was not found in " << execDir << ", skipping tool benchmarks.\n";
+			return true;
+		}
+	}
+
+	PacketColumns cols;
+	size_t count = decodeInput(cols);
+	std::string csvPath = tempDir+"/unpacked.csv";
+
+	std::vector<std::string> args = {execDir+"/loggerUnpacker", inputPath, csvPath};
+	if(!benchTool("loggerUnpacker", args, count, inputFile.getSize())){ return false; }
+
+	struct stat csvStat;
+	if(stat(csvPath.c_str(), &csvStat) != 0){
+		std::cout << " ERROR: loggerUnpacker did not write '" << csvPath << "'!\n";
+		return false;
+	}
+
+	// csvReader writes tmp.dat in the working directory. Keep the sequential output for comparison.
+	const std::string readerPath = tempDir+"/tmp.dat";
+	const std::string sequentialPath = tempDir+"/sequential.dat";
+	args = {execDir+"/csvReader", csvPath};
+	if(!benchTool("csvReader", args, count, csvStat.st_size) || rename(readerPath.c_str(), sequentialPath.c_str()) != 0){ return false; }
+
+	args = {execDir+"/csvReader", csvPath, "--threads", "0"};
+	if(!benchTool("csvReader threads", args, count, csvStat.st_size)){ return false; }
+	if(!sameFiles(readerPath, sequentialPath)){
+		std::cout << " ERROR: Parallel csvReader output does not match the sequential output!\n";
+		return false;
+	}
+	return true;
+}
+
+// Run a tool on the input file with its output discarded. Return false if the tool failed.
+bool runTool(const std::vector<std::string> &args_){
+	long peak = 0;
+	int status = launcher.run(args_, tempDir, peak);
+	if(status != 0){
+		std::cout << " ERROR: " << args_[0].substr(args_[0].find_last_of('/')+1) << " failed with status " << status << "!\n";
+		return false;
+	}
+	return true;
+}
+
+// Grow a copy of the input file in steps which end at random byte offsets, running loggerUnpacker
+// and ovenPipeline in follow mode after each step, and check that their outputs are identical to
+// those of a single run over the entire file.
+bool benchFollow(const size_t &N_, const double &corrupt_){
+	if(!openInput(N_, corrupt_)){ return false; }
+
+	const char *tools[2] = {"loggerUnpacker", "ovenPipeline"};
+	for(int i = 0; i < 2; i++){
+		if(access((execDir+"/"+tools[i]).c_str(), X_OK) != 0){
+			std::cout << " Error! " << tools[i] << " was not found in " << execDir << ", skipping follow mode checks.\n";
+			return true;
+		}
+	}
+
+	PacketColumns cols;
+	size_t count = decodeInput(cols);
+
+	// Outputs of the full runs and of the follow mode runs.
+	const char *names[5] = {"unpacked.csv", "unpacked.col", "unpacked.ovz", "pipeline.dat", "relays.dat"};
+	std::vector<std::string> fullPaths, followPaths;
+	for(int i = 0; i < 5; i++){
+		fullPaths.push_back(tempDir+"/full_"+names[i]);
+		followPaths.push_back(tempDir+"/follow_"+names[i]);
+		unlink(followPaths.back().c_str());
+	}
+	const std::string growingPath = tempDir+"/growing.dat";
+	const std::string unpackerCheckpoint = Checkpoint::getSidecarName(followPaths[0]);
+	const std::string pipelineCheckpoint = Checkpoint::getSidecarName(followPaths[3]);
+	unlink(unpackerCheckpoint.c_str());
+	unlink(pipelineCheckpoint.c_str());
+
+	if(!runTool({execDir+"/loggerUnpacker", inputPath, "--columnar", fullPaths[1], "--compress", fullPaths[2], fullPaths[0]}) ||
+	   !runTool({execDir+"/ovenPipeline", inputPath, "--output", fullPaths[3], "--relays", fullPaths[4]})){ return false; }
+
+	// Random cut points, the last of which is the end of the file.
+	const size_t size = inputFile.getSize();
+	std::mt19937 generator(0);
+	std::vector<size_t> cuts;
+	for(int i = 0; i < 7; i++){ cuts.push_back(std::uniform_int_distribution<size_t>(1, size-1)(generator)); }
+	std::sort(cuts.begin(), cuts.end());
+	cuts.push_back(size);
+
+	std::ofstream growing(growingPath.c_str(), std::ios::binary | std::ios::trunc);
+	size_t written = 0;
+	size_t resumed = 0;
+	benchClock::time_point start = startTimer();
+	for(size_t i = 0; i < cuts.size(); i++){
+		growing.write(inputFile.getData()+written, cuts[i]-written);
+		growing.flush();
+		written = cuts[i];
+		if(!growing.good()){
+			std::cout << " ERROR: Failed to write '" << growingPath << "'!\n";
+			return false;
+		}
+
+		// Make sure that the runs after the first one continue from their checkpoints.
+		if(i > 0){
+			MappedFile file;
+			Checkpoint ckp;
+			if(!file.open(growingPath) || !ckp.load(unpackerCheckpoint, file.getData(), file.getSize()) || !ckp.load(pipelineCheckpoint, file.getData(), file.getSize())){
+				std::cout << " ERROR: The follow mode checkpoints are not valid after growing the input file to " << written << " bytes!\n";
+				return false;
+			}
+			resumed++;
+		}
+
+		if(!runTool({execDir+"/loggerUnpacker", growingPath, "--follow", "--columnar", followPaths[1], "--compress", followPaths[2], followPaths[0]}) ||
+		   !runTool({execDir+"/ovenPipeline", growingPath, "--follow", "--output", followPaths[3], "--relays", followPaths[4]})){ return false; }
+	}
+	report("follow", count, elapsed(start), size);
+	std::cout << "   " << cuts.size() << " runs, " << resumed << " resumed from checkpoints\n";
+
+	bool passed = true;
+	for(int i = 0; i < 5; i++){
+		if(!sameFiles(followPaths[i], fullPaths[i])){
+			std::cout << " ERROR: Follow mode output '" << names[i] << "' does not match the output of a single run!\n";
+			passed = false;
+		}
+	}
+	return passed;
+}
+
+void help(char * prog_name_){
+	std::cout << "  SYNTAX: " << prog_name_ << " [options] [test ...]\n";
+	std::cout << "   Available options:\n";
+	std::cout << "    --packets <num> | Number of packets to use for each test (default=" << DEFAULT_PACKETS << ").\n";
+	std::cout << "    --input <file>  | Data file for the file tests (default=generated from the oven model).\n";
+	std::cout << "    --corrupt <prob> | Fraction of corrupted bytes in the generated data file (default=0).\n";
+	std::cout << "    --repeat <num>  | Number of times to run each file test, the fastest run is reported (default=" << DEFAULT_REPEAT << ").\n";
+	std::cout << "    --results <file> | Append machine-readable results to a csv file.\n";
+	std::cout << "   Available tests:\n";
+	std::cout << "    serial          | Binary serial reader (std::deque vs. ring buffer).\n";
+	std::cout << "    format          | Csv output formatting (std::ostream vs. CsvWriter).\n";
+	std::cout << "    sdlog           | Firmware SD logging (per-byte writes vs. SdLogger, modelled card timing).\n";
+	std::cout << "    interlock       | Firmware loss of vacuum reaction time (loop+delay vs. TaskScheduler, simulated clock).\n";
+	std::cout << "    fixed           | Fixed-point firmware readings (interlock decisions vs. float for every ADC code, compact frames).\n";
+	std::cout << "    relays          | Relay edge detection (SIMD vs. scalar vs. the relay rules, input split into pieces).\n";
+	std::cout << "    telemetry       | Shared memory telemetry ring (writer thread lapping a reader thread, torn sample detection).\n";
+	std::cout << "    merge           | SD card dump merging (hot swaps, millis() wraparound, reboots and out of order packets).\n";
+	std::cout << "    decode          | Data file decoding (SIMD, scalar and resync, or framed).\n";
+	std::cout << "    convert         | Data file csv formatting (sciNotation and decode+CsvWriter).\n";
+	std::cout << "    codec           | Compressed packet codec (encode, decode and compression ratio).\n";
+	std::cout << "    stats           | Tumbling and sliding window statistics of the data file.\n";
+	std::cout << "    index           | Time index of the data file (decoding from a start time vs. the entire file).\n";
+	std::cout << "    tools           | End-to-end loggerUnpacker and csvReader runs on the data file.\n";
+	std::cout << "    follow          | Follow mode loggerUnpacker and ovenPipeline runs on a growing copy of the data file vs. a single run.\n";
+}
+
+int main(int argc, char* argv[]){
+	size_t numPackets = DEFAULT_PACKETS;
+	double corrupt = 0;
+	std::string resultsName;
+	std::vector<std::string> tests;
+
+	int index = 1;
+	while(index < argc){
+		if(strcmp(argv[index], "-h") == 0 || strcmp(argv[index], "--help") == 0){
+			help(argv[0]);
+			return 0;
+		}
+		else if(strcmp(argv[index], "--packets") == 0){
+			if(index + 1 >= argc){
+				std::cout << " Error! Missing required argument to '--packets'!\n";
+				help(argv[0]);
+				return 1;
+			}
+			numPackets = strtoul(argv[++index], NULL, 0);
+			if(numPackets == 0){
+				std::cout << " Error! Number of packets must be greater than zero!\n";
+				return 1;
+			}
+		}
+		else if(strcmp(argv[index], "--input") == 0){
+			if(index + 1 >= argc){
+				std::cout << " Error! Missing required argument to '--input'!\n";
+				help(argv[0]);
+				return 1;
+			}
+			inputPath = argv[++index];
+			inputName = inputPath.substr(inputPath.find_last_of('/')+1);
+		}
+		else if(strcmp(argv[index], "--corrupt") == 0){
+			if(index + 1 >= argc){
+				std::cout << " Error! Missing required argument to '--corrupt'!\n";
+				help(argv[0]);
+				return 1;
+			}
+			corrupt = strtod(argv[++index], NULL);
+		}
+		else if(strcmp(argv[index], "--repeat") == 0){
+			if(index + 1 >= argc){
+				std::cout << " Error! Missing required argument to '--repeat'!\n";
+				help(argv[0]);
+				return 1;
+			}
+			numRepeat = atoi(argv[++index]);
+			if(numRepeat <= 0){
+				std::cout << " Error! Number of repeats must be greater than zero!\n";
+				return 1;
+			}
+		}
+		else if(strcmp(argv[index], "--results") == 0){
+			if(index + 1 >= argc){
+				std::cout << " Error! Missing required argument to '--results'!\n";
+				help(argv[0]);
+				return 1;
+			}
+			resultsName = argv[++index];
+		}
+		else{ tests.push_back(argv[index]); }
+		index++;
+	}
+
+	if(!resultsName.empty()){
+		struct stat resultsStat;
+		bool exists = (stat(resultsName.c_str(), &resultsStat) == 0 && resultsStat.st_size > 0);
+		results.open(resultsName.c_str(), std::ios::app);
+		if(!results.good()){
+			std::cout << " ERROR: Failed to open results file '" << resultsName << "'!\n";
+			return 1;
+		}
+		if(!exists){ results << "time,input,benchmark,records,bytes,seconds,records_per_s,MB_per_s,peak_rss_kB\n"; }
+	}
+	if(inputPath.empty()){
+		std::stringstream stream;
+		stream << "generated_" << numPackets << "_" << corrupt;
+		inputName = stream.str();
+	}
+
+	// Start the tool launcher while this process is still small.
+	if(std::find(tests.begin(), tests.end(), "tools") != tests.end() || std::find(tests.begin(), tests.end(), "follow") != tests.end() || tests.empty()){
+		if(!launcher.start()){
+			std::cout << " ERROR: Failed to start the tool launcher!\n";
+			return 1;
+		}
+	}
+
+	// The tools are built next to this executable.
+	char path[PATH_MAX];
+	if(realpath(argv[0], path)){
+		execDir = path;
+		execDir = execDir.substr(0, execDir.find_last_of('/'));
+	}
+
+	char tempName[] = "/tmp/ovenBench.XXXXXX";
+	if(!mkdtemp(tempName)){
+		std::cout << " ERROR: Failed to create temporary directory!\n";
+		return 1;
+	}
+	tempDir = tempName;
+
+	if(tests.empty()){ 
+		tests.push_back("serial"); 
+		tests.push_back("format"); 
+		tests.push_back("sdlog");
+		tests.push_back("interlock");
+		tests.push_back("fixed");
+		tests.push_back("relays");
+		tests.push_back("telemetry");
+		tests.push_back("merge");
+		tests.push_back("decode");
+		tests.push_back("convert");
+		tests.push_back("codec");
+		tests.push_back("stats");
+		tests.push_back("index");
+		tests.push_back("tools");
+		tests.push_back("follow");
+	}
+
+	// Every test is run, even after a failure, and the exit status is non-zero if any test failed.
+	std::vector<std::string> failed;
+	for(std::vector<std::string>::iterator iter = tests.begin(); iter != tests.end(); iter++){
+		bool passed = true;
+		if(*iter == "serial"){ passed = benchSerial(numPackets); }
+		else if(*iter == "format"){ passed = benchFormat(numPackets); }
+		else if(*iter == "sdlog"){ passed = benchLogger(numPackets); }
+		else if(*iter == "interlock"){ passed = benchInterlock(numPackets); }
+		else if(*iter == "fixed"){ passed = benchFixed(numPackets); }
+		else if(*iter == "relays"){ passed = benchRelays(numPackets); }
+		else if(*iter == "telemetry"){ passed = benchTelemetry(numPackets); }
+		else if(*iter == "merge"){ passed = benchMerge(); }
+		else if(*iter == "decode"){ passed = benchDecode(numPackets, corrupt); }
+		else if(*iter == "convert"){ passed = benchConvert(numPackets, corrupt); }
+		else if(*iter == "codec"){ passed = benchCodec(numPackets, corrupt); }
+		else if(*iter == "stats"){ passed = benchStats(numPackets, corrupt); }
+		else if(*iter == "index"){ passed = benchIndex(numPackets, corrupt); }
+		else if(*iter == "tools"){ passed = benchTools(numPackets, corrupt); }
+		else if(*iter == "follow"){ passed = benchFollow(numPackets, corrupt); }
+		else{
+			std::cout << " Error! Unrecognized test '" << *iter << "'!\n";
+			help(argv[0]);
+			removeTempDir();
+			return 1;
+		}
+		if(!passed){ failed.push_back(*iter); }
+	}
+
+	removeTempDir();
+
+	if(!failed.empty()){
+		std::cout << " ERROR: " << failed.size() << " test(s) failed:";
+		for(std::vector<std::string>::iterator iter = failed.begin(); iter != failed.end(); iter++){
+			std::cout << " " << *iter;
+		}
+		std::cout << "!\n";
+		return 1;
+	}
+
+	return 0;
+}
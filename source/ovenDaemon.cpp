@@ -0,0 +1,381 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/epoll.h>
+
+#include <signal.h>
+#include <stdexcept>
+
+#include "wiringSerial.h"
+#include "packetDecoder.hpp"
+#include "frameDecoder.hpp"
+#include "serialBuffer.hpp"
+#include "packetFormat.hpp"
+#include "telemetryRing.hpp"
+
+// Default time between packets sent by the oven controller (ms).
+#define DEFAULT_PERIOD 1000
+
+// Default time between printing port statistics (s).
+#define DEFAULT_INTERVAL 10
+
+// Maximum number of events to handle per call to epoll_wait.
+#define MAX_EVENTS 64
+
+bool SIGNAL_INTERRUPT = false;
+
+void sig_int_handler(int ignore_){
+	SIGNAL_INTERRUPT = true;
+}
+
+// Setup the interrupt signal intercept
+void setup_signal_handlers(){
+	// Handle ctrl-c press (SIGINT)
+	if(signal(SIGINT, SIG_IGN) != SIG_IGN){
+		if(signal(SIGINT, sig_int_handler) == SIG_ERR){
+			throw std::runtime_error(" Error setting up SIGINT signal handler!");
+		}
+	}
+	// Handle termination requests (SIGTERM)
+	if(signal(SIGTERM, sig_int_handler) == SIG_ERR){
+		throw std::runtime_error(" Error setting up SIGTERM signal handler!");
+	}
+}
+
+// A single oven connected to a serial port.
+class OvenPort{
+  public:
+	std::string device;
+	std::string ofname;
+
+	int fd;
+
+	SerialBuffer data;
+
+	PacketFormat format;
+
+	FrameDecoder frames;
+
+	PacketColumns cols;
+
+	std::ofstream output;
+
+	CsvWriter writer;
+
+	TelemetryWriter telemetry;
+
+	unsigned long numPackets; // Total number of packets written.
+	unsigned long numDropped; // Number of packets missing from the timestamp (or frame) sequence.
+	unsigned long numResets; // Number of times the timestamp (or frame sequence) went backwards.
+	unsigned long prevPackets; // Number of packets at the last statistics printout.
+
+	unsigned int prevTimestamp;
+
+	uint64_t arrivalTime; // Host arrival time of the last read (ms since epoch).
+
+	bool firstPacket;
+
+	OvenPort(const std::string &device_, const std::string &ofname_) : device(device_), ofname(ofname_), fd(-1), format(FORMAT_UNKNOWN), numPackets(0), numDropped(0),
+	                                                                  numResets(0), prevPackets(0), prevTimestamp(0), arrivalTime(0), firstPacket(true) {
+		writer.setOutput(&output);
+	}
+
+	~OvenPort(){ close(); }
+
+	// Open the serial port and the output file.
+	bool open(const int &baud_);
+
+	void close();
+
+	// Read everything waiting on the port and write all complete packets to the output file.
+	// Return false if the port could not be read.
+	bool read(const unsigned int &period_);
+
+	// Print the packet rate since the last call.
+	void print(const double &seconds_);
+
+  private:
+	// Write a single packet to the output file.
+	void write(const unsigned int &timestamp_, const float &temperature_, const float &pressure_, const short &relay1_, const short &relay2_);
+};
+
+bool OvenPort::open(const int &baud_){
+	fd = serialOpen(device.c_str(), baud_);
+	if(fd < 0){
+		std::cout << " ERROR: Failed to open serial port '" << device << "'!\n";
+		return false;
+	}
+
+	output.open(ofname.c_str(), std::ios::binary);
+	if(!output.is_open()){
+		std::cout << " ERROR: Failed to open output file '" << ofname << "'!\n";
+		serialClose(fd);
+		fd = -1;
+		return false;
+	}
+	output << "time(ms),T(C),P(Torr),R1,R2\n";
+
+	// Wake up as soon as any bytes are waiting on the port, so that short (compact) frames are not
+	// held until the next frame arrives. Packets are assembled from partial reads.
+	serialSetTimeouts(fd, 1, 0);
+
+	// Flush whatever is waiting on the port.
+	serialFlush(fd);
+
+	std::cout << " Connected to " << device << " (fd=" << fd << "), writing to '" << ofname << "'\n";
+
+	return true;
+}
+
+void OvenPort::close(){
+	if(fd >= 0){
+		serialClose(fd);
+		fd = -1;
+	}
+	if(output.is_open()){ 
+		writer.flush();
+		output.close(); 
+	}
+	telemetry.close();
+}
+
+bool OvenPort::read(const unsigned int &period_){
+	if(data.fill(fd) <= 0){ return false; }
+	arrivalTime = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+	// Detect the packet format from the first bytes received.
+	if(format == FORMAT_UNKNOWN){
+		if((format = detectFormat(data.data(), data.size())) == FORMAT_UNKNOWN){ return true; }
+		std::cout << "  " << device << ": detected " << getFormatName(format) << " packet format.\n";
+	}
+
+	if(format == FORMAT_FRAMED){
+		cols.clear();
+		frames.decode(data.data(), data.size(), cols);
+		data.clear();
+		for(size_t i = 0; i < cols.size(); i++){
+			write(cols.timestamp[i], cols.temperature[i], cols.pressure[i], cols.relay1[i], cols.relay2[i]);
+		}
+
+		// Lost frames are counted exactly using the frame sequence numbers.
+		numDropped = frames.getNumLost();
+		numResets = frames.getNumResets();
+		writer.flush();
+
+		return true;
+	}
+
+	unsigned int timestamp;
+	float temperature;
+	float pressure;
+	short relay1;
+	short relay2;
+
+	const char *packet;
+	while((packet = data.nextPacket())){
+		unpackPacket(packet, timestamp, temperature, pressure, relay1, relay2);
+
+		// Skip the first data entry, because it is usually junk.
+		if(firstPacket){
+			firstPacket = false;
+			continue;
+		}
+
+		// Check for missing packets.
+		if(numPackets > 0){
+			if(timestamp < prevTimestamp){ numResets++; }
+			else if(period_ > 0 && timestamp-prevTimestamp > period_+period_/2){
+				numDropped += (timestamp-prevTimestamp+period_/2)/period_-1;
+			}
+		}
+		prevTimestamp = timestamp;
+
+		write(timestamp, temperature, pressure, relay1, relay2);
+	}
+	writer.flush();
+
+	return true;
+}
+
+void OvenPort::print(const double &seconds_){
+	std::cout << "  " << device << ": ";
+	if(seconds_ > 0){ std::cout << (numPackets-prevPackets)/seconds_ << " packets/s, "; }
+	std::cout << numPackets << " packets, " << numDropped << " dropped, " << data.getNumDiscarded()+frames.getNumDiscarded() << " bytes discarded";
+	if(frames.getNumCorrupt() > 0){ std::cout << ", " << frames.getNumCorrupt() << " corrupt frames"; }
+	if(numResets > 0){ std::cout << ", " << numResets << " resets"; }
+	if(frames.getNumDuplicates() > 0){ std::cout << ", " << frames.getNumDuplicates() << " repeated frames"; }
+	if(fd < 0){ std::cout << " (closed)"; }
+	std::cout << std::endl;
+	prevPackets = numPackets;
+}
+
+void OvenPort::write(const unsigned int &timestamp_, const float &temperature_, const float &pressure_, const short &relay1_, const short &relay2_){
+	const float pressure = calibratePressure(pressure_);
+	writer.addPacket(timestamp_, temperature_, pressure, relay1_, relay2_);
+	writer.endRow();
+	if(telemetry.isOpen()){ telemetry.publish(arrivalTime, timestamp_, temperature_, pressure, relay1_, relay2_); }
+	numPackets++;
+}
+
+// Return the output filename for a serial port.
+std::string getOutputName(const std::string &dir_, const std::string &device_){
+	std::string name = device_.substr(device_.find_last_of('/')+1);
+	return dir_ + "/" + name + ".csv";
+}
+
+// Return the telemetry ring name for a serial port.
+std::string getTelemetryName(const std::string &prefix_, const std::string &device_){
+	return getTelemetryName(prefix_ + "." + device_.substr(device_.find_last_of('/')+1));
+}
+
+void help(char * prog_name_){
+	std::cout << "  SYNTAX: " << prog_name_ << " [options] <port> [port ...]\n";
+	std::cout << "   Available options:\n";
+	std::cout << "    --baud <rate>      | Serial port baud rate (default=9600).\n";
+	std::cout << "    --output <dir>     | Directory for the output files (default=./).\n";
+	std::cout << "    --period <ms>      | Expected time between packets, used to count dropped packets (default=" << DEFAULT_PERIOD << ").\n";
+	std::cout << "    --interval <s>     | Time between printing port statistics (default=" << DEFAULT_INTERVAL << ").\n";
+	std::cout << "    --publish <prefix> | Publish the packets of each port to a shared memory telemetry ring named prefix.port.\n";
+}
+
+int main(int argc, char* argv[]){
+	if(argc < 2){
+		std::cout << " Invalid number of arguments to " << argv[0] << ". Expected at least 1, received " << argc-1 << ".\n";
+		help(argv[0]);
+		return 1;
+	}
+
+	std::vector<std::string> devices;
+	std::string outputDir = ".";
+	std::string shmPrefix;
+	int baud = 9600;
+	unsigned int period = DEFAULT_PERIOD;
+	int interval = DEFAULT_INTERVAL;
+
+	int index = 1;
+	while(index < argc){
+		if(strcmp(argv[index], "-h") == 0 || strcmp(argv[index], "--help") == 0){
+			help(argv[0]);
+			return 0;
+		}
+		else if(strcmp(argv[index], "--baud") == 0 || strcmp(argv[index], "--output") == 0 ||
+		        strcmp(argv[index], "--period") == 0 || strcmp(argv[index], "--interval") == 0 || strcmp(argv[index], "--publish") == 0){
+			if(index + 1 >= argc){
+				std::cout << " Error! Missing required argument to '" << argv[index] << "'!\n";
+				help(argv[0]);
+				return 1;
+			}
+			if(strcmp(argv[index], "--baud") == 0){ baud = atoi(argv[++index]); }
+			else if(strcmp(argv[index], "--output") == 0){ outputDir = argv[++index]; }
+			else if(strcmp(argv[index], "--period") == 0){ period = strtoul(argv[++index], NULL, 0); }
+			else if(strcmp(argv[index], "--publish") == 0){ shmPrefix = argv[++index]; }
+			else{
+				interval = atoi(argv[++index]);
+				if(interval <= 0){
+					std::cout << " Error! Statistics interval must be greater than zero!\n";
+					return 1;
+				}
+			}
+		}
+		else{ devices.push_back(argv[index]); }
+		index++;
+	}
+
+	if(devices.empty()){
+		std::cout << " Error! No serial ports specified!\n";
+		help(argv[0]);
+		return 1;
+	}
+
+	int epfd = epoll_create1(0);
+	if(epfd < 0){
+		std::cout << " ERROR: Failed to create epoll instance!\n";
+		return 1;
+	}
+
+	// Open all serial ports.
+	std::vector<OvenPort*> ports;
+	for(std::vector<std::string>::iterator iter = devices.begin(); iter != devices.end(); iter++){
+		OvenPort *port = new OvenPort(*iter, getOutputName(outputDir, *iter));
+		if(!port->open(baud)){
+			delete port;
+			continue;
+		}
+
+		if(!shmPrefix.empty()){
+			std::string shmName = getTelemetryName(shmPrefix, *iter);
+			if(!port->telemetry.open(shmName)){
+				std::cout << " ERROR: Failed to create telemetry ring '" << shmName << "'!\n";
+				delete port;
+				continue;
+			}
+			std::cout << " Publishing " << port->device << " packets to telemetry ring '" << shmName << "'\n";
+		}
+
+		struct epoll_event event;
+		event.events = EPOLLIN;
+		event.data.ptr = (void*)port;
+		if(epoll_ctl(epfd, EPOLL_CTL_ADD, port->fd, &event) < 0){
+			std::cout << " ERROR: Failed to add '" << port->device << "' to epoll instance!\n";
+			delete port;
+			continue;
+		}
+		ports.push_back(port);
+	}
+
+	if(ports.empty()){
+		std::cout << " ERROR: Failed to open any serial ports!\n";
+		close(epfd);
+		return 1;
+	}
+
+	setup_signal_handlers();
+
+	size_t numOpen = ports.size();
+	struct epoll_event events[MAX_EVENTS];
+	std::chrono::steady_clock::time_point lastPrint = std::chrono::steady_clock::now();
+	while(!SIGNAL_INTERRUPT && numOpen > 0){
+		int numEvents = epoll_wait(epfd, events, MAX_EVENTS, 1000);
+		if(numEvents < 0 && errno != EINTR){
+			std::cout << " ERROR: epoll_wait failed!\n";
+			break;
+		}
+
+		for(int i = 0; i < numEvents; i++){
+			OvenPort *port = (OvenPort*)events[i].data.ptr;
+			if((events[i].events & EPOLLIN) && port->read(period)){ continue; }
+			if(events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)){ // Lost the port.
+				std::cout << " ERROR: Encountered error on serial port '" << port->device << "'!\n";
+				epoll_ctl(epfd, EPOLL_CTL_DEL, port->fd, NULL);
+				port->close();
+				numOpen--;
+			}
+		}
+
+		// Print the port statistics.
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-lastPrint).count();
+		if(seconds >= interval){
+			std::cout << " Port statistics:\n";
+			for(std::vector<OvenPort*>::iterator iter = ports.begin(); iter != ports.end(); iter++){
+				(*iter)->print(seconds);
+			}
+			lastPrint = std::chrono::steady_clock::now();
+		}
+	}
+
+	std::cout << "\n Done! Final port statistics:\n";
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-lastPrint).count();
+	for(std::vector<OvenPort*>::iterator iter = ports.begin(); iter != ports.end(); iter++){
+		(*iter)->print(seconds);
+		delete (*iter);
+	}
+	close(epfd);
+
+	return 0;
+}
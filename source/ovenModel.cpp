@@ -0,0 +1,67 @@
+#include <cmath>
+
+#include "ovenModel.hpp"
+
+///////////////////////////////////////////////////////////////////////////////
+// class OvenModel
+///////////////////////////////////////////////////////////////////////////////
+
+OvenModel::OvenModel(const unsigned int &seed_/*=0*/) : interlock(MODEL_MAX_TEMP, MODEL_MIN_TEMP, MODEL_MAX_PRESSURE, MODEL_PUMPED_DOWN_PRESSURE) {
+	reset(seed_);
+}
+
+void OvenModel::reset(const unsigned int &seed_/*=0*/){
+	generator.seed(seed_);
+	noise.reset();
+	interlock = OvenInterlock(MODEL_MAX_TEMP, MODEL_MIN_TEMP, MODEL_MAX_PRESSURE, MODEL_PUMPED_DOWN_PRESSURE);
+	ovenTemp = MODEL_AMBIENT_TEMP;
+	ovenPressure = MODEL_ATMOSPHERE_PRESSURE;
+	timestamp = 0;
+	temperature = MODEL_AMBIENT_TEMP;
+	pressure = MODEL_ATMOSPHERE_PRESSURE;
+	relay1 = 0;
+	relay2 = 0;
+}
+
+void OvenModel::step(const unsigned int &period_/*=MODEL_PERIOD*/){
+	const double dt = period_/1000.0;
+
+	// The relays stay in their last state for the entire step.
+	ovenTemp += (relay1 ? MODEL_HEAT_RATE*dt : 0)-(ovenTemp-MODEL_AMBIENT_TEMP)*dt/MODEL_COOL_TIME;
+	const double target = (relay2 ? MODEL_BASE_PRESSURE : MODEL_ATMOSPHERE_PRESSURE);
+	ovenPressure = target+(ovenPressure-target)*std::exp(-dt/MODEL_PUMP_TIME);
+	timestamp += period_;
+
+	// Read the thermocouple and the pressure gauge.
+	temperature = std::round((ovenTemp+MODEL_TEMP_NOISE*noise(generator))*4)/4;
+	pressure = 5.0*std::round((ovenPressure+MODEL_PRESSURE_NOISE*noise(generator))*1023/5.0)/1023.0;
+
+	// Both relays are always requested, the interlocks decide what actually runs.
+	int state1, state2;
+	interlock.evaluate(1, 1, temperature, pressure, state1, state2);
+	relay1 = state1;
+	relay2 = state2;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// class LineNoise
+///////////////////////////////////////////////////////////////////////////////
+
+LineNoise::LineNoise(const double &drop_/*=0*/, const double &noise_/*=0*/, const unsigned int &seed_/*=0*/) : drop(drop_), noise(noise_), generator(seed_), numDropped(0), numCorrupted(0) { }
+
+size_t LineNoise::apply(char *data_, const size_t &len_){
+	size_t count = 0;
+	for(size_t i = 0; i < len_; i++){
+		if(drop > 0 && uniform(generator) < drop){
+			numDropped++;
+			continue;
+		}
+		data_[count] = data_[i];
+		if(noise > 0 && uniform(generator) < noise){
+			data_[count] = (char)(generator() & 0xFF);
+			numCorrupted++;
+		}
+		count++;
+	}
+	return count;
+}
@@ -0,0 +1,399 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <limits.h>
+#include <cmath>
+
+#include "packetDecoder.hpp"
+#include "frameDecoder.hpp"
+#include "packetFormat.hpp"
+#include "relayEdges.hpp"
+#include "checkpoint.hpp"
+#include "windowStats.hpp"
+
+typedef std::chrono::steady_clock pipeClock;
+
+// Names of the pipeline stages.
+enum PipelineStage {DECODE, CALIBRATE, FILTER, SECONDS, RELAYS, STATS, WRITE, NUM_STAGES};
+
+const char *stageNames[NUM_STAGES] = {"decode", "calibrate", "filter", "seconds", "relays", "stats", "write"};
+
+// Accumulated wall time for each pipeline stage.
+class StageTimer{
+  public:
+	double times[NUM_STAGES];
+
+	StageTimer(){
+		for(int i = 0; i < NUM_STAGES; i++){ times[i] = 0; }
+		last = pipeClock::now();
+	}
+
+	// Start timing the next stage.
+	void start(){ last = pipeClock::now(); }
+
+	// Add the time since the last call to a stage.
+	void stop(const PipelineStage &stage_){
+		pipeClock::time_point now = pipeClock::now();
+		times[stage_] += std::chrono::duration<double>(now-last).count();
+		last = now;
+	}
+
+	double total() const {
+		double sum = 0;
+		for(int i = 0; i < NUM_STAGES; i++){ sum += times[i]; }
+		return sum;
+	}
+
+  private:
+	pipeClock::time_point last;
+};
+
+// Run a shell command and return its wall time (s), or a negative value on failure.
+double timeCommand(const std::string &cmd_){
+	pipeClock::time_point start = pipeClock::now();
+	if(system(cmd_.c_str()) != 0){ return -1; }
+	return std::chrono::duration<double>(pipeClock::now()-start).count();
+}
+
+// Return true if two files are identical.
+bool compareFiles(const std::string &fname1_, const std::string &fname2_){
+	MappedFile file1, file2;
+	if(!file1.open(fname1_) || !file2.open(fname2_)){ return false; }
+	if(file1.getSize() != file2.getSize()){ return false; }
+	return (file1.getSize() == 0 || memcmp(file1.getData(), file2.getData(), file1.getSize()) == 0);
+}
+
+// Run the original unpack/prescan steps of read.sh and compare with the pipeline output.
+void compareLegacy(const std::string &exeDir_, const std::string &ifname_, const std::string &ofname_, const double &total_){
+	char tmpdir[] = "/tmp/ovenPipelineXXXXXX";
+	if(!mkdtemp(tmpdir)){
+		std::cout << " ERROR: Failed to create temporary directory!\n";
+		return;
+	}
+	std::string dir(tmpdir);
+
+	double unpackTime = timeCommand("'"+exeDir_+"/loggerUnpacker' '"+ifname_+"' "+dir+"/tmp.csv > /dev/null");
+	double readerTime = timeCommand("cd "+dir+" && '"+exeDir_+"/csvReader' tmp.csv > /dev/null");
+
+	if(unpackTime < 0 || readerTime < 0){
+		std::cout << " ERROR: Failed to run loggerUnpacker and csvReader from '" << exeDir_ << "'!\n";
+	}
+	else{
+		std::cout << " Original read.sh steps:\n";
+		std::cout << "  loggerUnpacker: " << unpackTime << " s\n";
+		std::cout << "  csvReader:      " << readerTime << " s\n";
+		std::cout << "  total:          " << unpackTime+readerTime << " s (" << (unpackTime+readerTime)/total_ << "x pipeline)\n";
+		std::cout << "  Output is " << (compareFiles(dir+"/tmp.dat", ofname_) ? "identical to" : "DIFFERENT from") << " csvReader output.\n";
+	}
+
+	remove((dir+"/tmp.csv").c_str());
+	remove((dir+"/tmp.dat").c_str());
+	remove(dir.c_str());
+}
+
+void help(char * prog_name_){
+	std::cout << "  SYNTAX: " << prog_name_ << " <filename> [options]\n";
+	std::cout << "   Available options:\n";
+	std::cout << "    --output <filename> | Output data table (default=tmp.dat).\n";
+	std::cout << "    --relays <filename> | Output relay 1 intervals (default=relays.dat).\n";
+	std::cout << "    --stats <filename>  | Output window statistics (T, P, relay duty cycles, time above --max-temp).\n";
+	std::cout << "    --window <time>     | Length of each statistics window (in seconds, default=" << STATS_WINDOW << ").\n";
+	std::cout << "    --slide <time>      | Time between statistics windows (in seconds, default=window length).\n";
+	std::cout << "    --max-temp <temp>   | Temperature limit for the statistics (in C, default=" << STATS_MAX_TEMP << ").\n";
+	std::cout << "    --compare           | Time the original loggerUnpacker and csvReader steps for comparison.\n";
+	std::cout << "    --follow            | Only decode packets appended since the last run and extend the outputs in place.\n";
+	std::cout << "    --checkpoint <filename> | Checkpoint file used in follow mode (default=<output>.ckp).\n";
+}
+
+int main(int argc, char* argv[]){
+	if(argc > 1 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)){
+		help(argv[0]);
+		return 0;
+	}
+	else if(argc < 2){
+		std::cout << " Error: Invalid number of arguments to " << argv[0] << ". Expected 1, received " << argc-1 << ".\n";
+		help(argv[0]);
+		return 1;
+	}
+
+	std::string ofname = "tmp.dat";
+	std::string rfname = "relays.dat";
+	std::string ckpname;
+	std::string sfname;
+	double windowLength = STATS_WINDOW;
+	double slideLength = 0;
+	double maxTemp = STATS_MAX_TEMP;
+	bool compare = false;
+	bool follow = false;
+
+	int index = 2;
+	while(index < argc){
+		if(strcmp(argv[index], "--output") == 0 || strcmp(argv[index], "--relays") == 0 || strcmp(argv[index], "--checkpoint") == 0){
+			if(index + 1 >= argc){
+				std::cout << " Error! Missing required argument to '" << argv[index] << "'!\n";
+				help(argv[0]);
+				return 1;
+			}
+			if(strcmp(argv[index], "--output") == 0){ ofname = argv[++index]; }
+			else if(strcmp(argv[index], "--relays") == 0){ rfname = argv[++index]; }
+			else{ ckpname = argv[++index]; }
+		}
+		else if(strcmp(argv[index], "--stats") == 0 || strcmp(argv[index], "--window") == 0 || strcmp(argv[index], "--slide") == 0 || strcmp(argv[index], "--max-temp") == 0){
+			if(index + 1 >= argc){
+				std::cout << " Error! Missing required argument to '" << argv[index] << "'!\n";
+				help(argv[0]);
+				return 1;
+			}
+			if(strcmp(argv[index], "--stats") == 0){ sfname = argv[++index]; }
+			else if(strcmp(argv[index], "--window") == 0){ windowLength = atof(argv[++index]); }
+			else if(strcmp(argv[index], "--slide") == 0){ slideLength = atof(argv[++index]); }
+			else{ maxTemp = atof(argv[++index]); }
+		}
+		else if(strcmp(argv[index], "--compare") == 0){
+			compare = true;
+		}
+		else if(strcmp(argv[index], "--follow") == 0){
+			follow = true;
+		}
+		else{
+			std::cout << " Error! Unrecognized option '" << argv[index] << "'!\n";
+			help(argv[0]);
+			return 1;
+		}
+		index++;
+	}
+
+	if(ckpname.empty()){ ckpname = Checkpoint::getSidecarName(ofname); }
+
+	// Windows which span two runs can not be resumed.
+	if(follow && !sfname.empty()){
+		std::cout << " Error! May not use --stats in follow mode.\n";
+		return 1;
+	}
+
+	WindowStats stats;
+	if(!stats.setWindow(windowLength, slideLength)){
+		std::cout << " Error! The statistics window must be a positive multiple of the slide time!\n";
+		return 1;
+	}
+	stats.setMaxTemp(maxTemp);
+
+	std::ofstream statsOutput;
+	if(!sfname.empty()){
+		statsOutput.open(sfname.c_str());
+		if(!statsOutput.is_open()){
+			std::cout << " ERROR: Failed to open statistics output file '" << sfname << "'!\n";
+			return 1;
+		}
+		stats.setOutput(&statsOutput);
+	}
+
+	StageTimer timer;
+
+	MappedFile file;
+	if(!file.open(argv[1])){
+		std::cout << " ERROR: Failed to open input file '" << argv[1] << "'!\n";
+		return 1;
+	}
+
+	// Skip the title.
+	char title[64];
+	size_t offset = readTitle(file.getData(), file.getSize(), title, 64);
+
+	// The first packet of a legacy file is usually junk and skipped by loggerUnpacker.
+	// Framed packets are always valid, so only the first row skipped by csvReader is removed.
+	PacketFormat format = (detectFormat(file.getData()+offset, file.getSize()-offset) == FORMAT_FRAMED ? FORMAT_FRAMED : FORMAT_LEGACY);
+	bool framed = (format == FORMAT_FRAMED);
+	unsigned int numJunk = (framed ? 1 : 2);
+	RelayIntervals relays; // Relay 1 (heater)
+	RelayIntervals relays2; // Relay 2 (vacuum)
+	FrameDecoder frames;
+	size_t numRecords = 0;
+	unsigned int count = 0;
+
+	// Continue from the end of the last run, if the outputs have not changed since.
+	Checkpoint ckp;
+	bool resume = false;
+	if(follow){
+		if(!ckp.load(ckpname, file.getData(), file.getSize())){
+			std::cout << " No checkpoint '" << ckpname << "' for this input file, reading from the start.\n";
+		}
+		else if(ckp.header.format != format || !Checkpoint::truncateOutput(ofname, ckp.header.outputSize[0]) || !Checkpoint::truncateOutput(rfname, ckp.header.outputSize[1])){
+			std::cout << " Warning! The outputs do not match checkpoint '" << ckpname << "', reading from the start.\n";
+			ckp.reset();
+		}
+		else{
+			resume = true;
+			offset = ckp.header.inputOffset;
+			count = ckp.header.numPackets;
+			numRecords = ckp.header.numRecords;
+			frames.resume(ckp.header.synced != 0, ckp.header.haveSequence != 0, ckp.header.lastSequence);
+			relays.restore(ckp.header.relays[0]);
+			relays2.restore(ckp.header.relays[1]);
+			std::cout << " Resuming at offset " << offset << " after " << numRecords << " records (time " << ckp.header.lastTimestamp/1000 << " s).\n";
+		}
+	}
+
+	std::ofstream output(ofname.c_str(), (resume ? std::ios::binary | std::ios::app : std::ios::binary));
+	if(!output.is_open()){
+		std::cout << " ERROR: Failed to open output file '" << ofname << "'!\n";
+		return 1;
+	}
+
+	BatchDecoder decoder(file.getData(), file.getSize(), offset);
+	frames.setInput(file.getData(), file.getSize(), offset);
+
+	PacketColumns cols;
+	std::vector<int> seconds;
+	CsvWriter writer(&output);
+
+	if(!resume){ output << "milliseconds,temperature,pressure,r1,r2,seconds\n"; }
+
+	const size_t startRecords = numRecords;
+	size_t numRejected = 0;
+	unsigned int lastTimestamp = ckp.header.lastTimestamp;
+	while(true){
+		timer.start();
+
+		// Decode the next block of packets.
+		cols.clear();
+		if((framed ? frames.decode(cols) : decoder.decode(cols)) == 0){ break; }
+		lastTimestamp = cols.timestamp.back();
+		timer.stop(DECODE);
+
+		// Convert the pressure gauge voltage to an actual pressure.
+		for(size_t i = 0; i < cols.size(); i++){
+			cols.pressure[i] = calibratePressure(cols.pressure[i]);
+		}
+		timer.stop(CALIBRATE);
+
+		// Remove the first records, which are usually junk, and any records which
+		// would be printed as nan or inf. The pressure is printed as 10*P/order, so it
+		// is printed as inf whenever 10*P overflows.
+		size_t N = 0;
+		for(size_t i = 0; i < cols.size(); i++, count++){
+			if(count < numJunk){ continue; }
+			if(!std::isfinite(cols.temperature[i]) || !std::isfinite(10*cols.pressure[i])){
+				numRejected++;
+				continue;
+			}
+			cols.timestamp[N] = cols.timestamp[i];
+			cols.temperature[N] = cols.temperature[i];
+			cols.pressure[N] = cols.pressure[i];
+			cols.relay1[N] = cols.relay1[i];
+			cols.relay2[N] = cols.relay2[i];
+			N++;
+		}
+		cols.resize(N);
+		timer.stop(FILTER);
+
+		// Derive the time in seconds.
+		seconds.resize(N);
+		for(size_t i = 0; i < N; i++){
+			seconds[i] = (int)cols.timestamp[i]/1000;
+		}
+		timer.stop(SECONDS);
+
+		// Find the relay intervals.
+		relays.add(cols.relay1.data(), seconds.data(), N);
+		relays2.add(cols.relay2.data(), seconds.data(), N);
+		timer.stop(RELAYS);
+
+		// Add the records to the window statistics.
+		if(statsOutput.is_open()){
+			for(size_t i = 0; i < N; i++){
+				stats.add(cols.timestamp[i], cols.temperature[i], cols.pressure[i], cols.relay1[i], cols.relay2[i]);
+			}
+		}
+		timer.stop(STATS);
+
+		// Write the data table.
+		for(size_t i = 0; i < N; i++){
+			writer.addPacket(cols.timestamp[i], cols.temperature[i], cols.pressure[i], cols.relay1[i], cols.relay2[i]);
+			writer.addField((long long)seconds[i]);
+			writer.endRow();
+		}
+		timer.stop(WRITE);
+
+		numRecords += N;
+	}
+
+	timer.start();
+	writer.flush();
+	output.close();
+
+	// A resumed run adds the intervals since the checkpoint, including one which was still open.
+	std::ofstream relayOutput(rfname.c_str(), (resume ? std::ios::in | std::ios::out : std::ios::out | std::ios::trunc));
+	if(!relayOutput.is_open()){
+		std::cout << " ERROR: Failed to open relay output file '" << rfname << "'!\n";
+		return 1;
+	}
+	if(resume){ relayOutput.seekp(0, std::ios::end); }
+	else{ relayOutput << "open(s)\tclose(s)\n"; }
+	for(size_t i = 0; i < relays.close.size(); i++){
+		relayOutput << (int)relays.open[i] << "\t" << (int)relays.close[i] << "\n";
+	}
+	uint64_t relaySize = relayOutput.tellp();
+	if(relays.isOn()){ relayOutput << (int)relays.open.back() << "\n"; }
+	relayOutput.close();
+	timer.stop(WRITE);
+
+	std::cout << " Wrote " << numRecords-startRecords << " records to '" << ofname << "' (rejected " << numRejected << " nan/inf records)";
+	if(resume){ std::cout << ", " << numRecords << " in total"; }
+	std::cout << ".\n";
+	std::cout << " Wrote " << relays.getNumIntervals() << " relay intervals to '" << rfname << "'\n";
+	if(relays.isOn()){ std::cout << "  Warning! Relay 1 was still on at the end of the run.\n"; }
+	if(statsOutput.is_open()){
+		stats.flush();
+		statsOutput.close();
+		std::cout << " Wrote " << stats.getNumWindows() << " windows to '" << sfname << "'\n";
+		stats.print(std::cout, "  ");
+	}
+	printf(" Relay 1 on for %g of %g s (duty cycle %.2f%%, %zu intervals)\n", relays.getOnTime(), relays.getTotalTime(), 100*relays.getDutyCycle(), relays.getNumIntervals());
+	printf(" Relay 2 on for %g of %g s (duty cycle %.2f%%, %zu intervals)\n", relays2.getOnTime(), relays2.getTotalTime(), 100*relays2.getDutyCycle(), relays2.getNumIntervals());
+
+	// Save the state needed to continue from the end of this run.
+	if(follow){
+		ckp.header.format = format;
+		ckp.header.inputOffset = (framed ? frames.getResumeOffset() : decoder.getResumeOffset());
+		ckp.header.numPackets = count;
+		ckp.header.numRecords = numRecords;
+		ckp.header.outputSize[0] = Checkpoint::getFileSize(ofname);
+		ckp.header.outputSize[1] = relaySize;
+		ckp.header.lastTimestamp = lastTimestamp;
+		ckp.header.lastSequence = frames.getLastSequence();
+		ckp.header.haveSequence = (frames.haveLastSequence() ? 1 : 0);
+		ckp.header.synced = (frames.isSynced() ? 1 : 0);
+		relays.save(ckp.header.relays[0]);
+		relays2.save(ckp.header.relays[1]);
+		strncpy(ckp.header.title, title, 63);
+		if(!ckp.save(ckpname, file.getData(), file.getSize())){ std::cout << " Warning! Failed to write checkpoint '" << ckpname << "'.\n"; }
+	}
+
+	std::cout << " Pipeline stages:\n";
+	for(int i = 0; i < NUM_STAGES; i++){
+		printf("  %-10s %10.6f s\n", stageNames[i], timer.times[i]);
+	}
+	size_t numDecoded = (framed ? frames.getNumDecoded() : decoder.getNumDecoded());
+	printf("  %-10s %10.6f s (%g records/s)\n", "total", timer.total(), (timer.total() > 0 ? numDecoded/timer.total() : 0));
+	if(framed){ std::cout << " Lost " << frames.getNumLost() << " frames (" << frames.getNumCorrupt() << " corrupt).\n"; }
+
+	if(compare){
+		// The tools are built next to this executable. Use an absolute path, since csvReader is run
+		// from the temporary directory.
+		char path[PATH_MAX];
+		std::string exeDir = ".";
+		if(realpath("/proc/self/exe", path) || realpath(argv[0], path)){
+			exeDir = path;
+			exeDir = exeDir.substr(0, exeDir.find_last_of('/'));
+		}
+		compareLegacy(exeDir, argv[1], ofname, timer.total());
+	}
+
+	return 0;
+}
@@ -0,0 +1,423 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <random>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+
+#include <signal.h>
+#include <stdexcept>
+
+#include "packetDecoder.hpp"
+#include "frameDecoder.hpp"
+#include "ovenModel.hpp"
+
+// Default number of packets sent per second.
+#define DEFAULT_RATE 1.0
+
+// Maximum number of bytes written to the port at once.
+#define WRITE_BLOCK_SIZE 4096
+
+// Maximum time to sleep while waiting for the next packet (us).
+#define MAX_SLEEP 10000
+
+bool SIGNAL_INTERRUPT = false;
+
+void sig_int_handler(int ignore_){
+	SIGNAL_INTERRUPT = true;
+}
+
+// Setup the interrupt signal intercept
+void setup_signal_handlers(){
+	// Handle ctrl-c press (SIGINT)
+	if(signal(SIGINT, SIG_IGN) != SIG_IGN){
+		if(signal(SIGINT, sig_int_handler) == SIG_ERR){
+			throw std::runtime_error(" Error setting up SIGINT signal handler!");
+		}
+	}
+	// Handle termination requests (SIGTERM)
+	if(signal(SIGTERM, sig_int_handler) == SIG_ERR){
+		throw std::runtime_error(" Error setting up SIGTERM signal handler!");
+	}
+}
+
+// Open a new pseudo-terminal and return the descriptor of the master side.
+// The slave side is put in raw mode and its name is returned in name_.
+int openPty(std::string &name_){
+	int fd = posix_openpt(O_RDWR | O_NOCTTY);
+	if(fd < 0){ return -1; }
+	if(grantpt(fd) != 0 || unlockpt(fd) != 0){
+		close(fd);
+		return -1;
+	}
+	name_ = ptsname(fd);
+
+	// Disable echo and line editing so binary packets pass through unchanged.
+	int slave = open(name_.c_str(), O_RDWR | O_NOCTTY);
+	if(slave >= 0){
+		struct termios options;
+		if(tcgetattr(slave, &options) == 0){
+			cfmakeraw(&options);
+			tcsetattr(slave, TCSANOW, &options);
+		}
+		close(slave);
+	}
+
+	return fd;
+}
+
+// Return true if a reader has the slave side of the pty open.
+bool haveReader(const int &fd_){
+	struct pollfd pfd;
+	pfd.fd = fd_;
+	pfd.events = POLLOUT;
+	pfd.revents = 0;
+	if(poll(&pfd, 1, 0) < 0){ return false; }
+	return !(pfd.revents & POLLHUP);
+}
+
+// Write an entire buffer to the pty. Return false if the reader went away.
+bool writeAll(const int &fd_, const char *data_, size_t len_){
+	while(len_ > 0){
+		ssize_t count = write(fd_, data_, len_);
+		if(count < 0){
+			if(errno == EINTR && !SIGNAL_INTERRUPT){ continue; }
+			return false;
+		}
+		data_ += count;
+		len_ -= count;
+	}
+	return true;
+}
+
+void help(char * prog_name_){
+	std::cout << "  SYNTAX: " << prog_name_ << " [options]\n";
+	std::cout << "   Available options:\n";
+	std::cout << "    --rate <num>       | Number of packets sent per second (default=" << DEFAULT_RATE << ").\n";
+	std::cout << "    --period <ms>      | Time between packet timestamps of the oven model (default=" << MODEL_PERIOD << ").\n";
+	std::cout << "    --packets <num>    | Stop after sending a number of packets (default=unlimited).\n";
+	std::cout << "    --legacy           | Send the original delimited packets instead of framed packets.\n";
+	std::cout << "    --framed           | Send framed packets (default, except when replaying a legacy file).\n";
+	std::cout << "    --compact          | Send compact framed packets with fixed-point readings, as the firmware does (default).\n";
+	std::cout << "    --full             | Send version 1 framed packets with float readings instead of compact packets.\n";
+	std::cout << "    --timing           | Send a modelled firmware timing frame after each framed packet.\n";
+	std::cout << "    --replay <file>    | Replay the packets of a recorded DAT file instead of the oven model.\n";
+	std::cout << "    --speed <num>      | Replay speed, relative to the recorded timestamps (default=1).\n";
+	std::cout << "    --drop <prob>      | Probability of dropping each byte (default=0).\n";
+	std::cout << "    --noise <prob>     | Probability of replacing each byte with a random value (default=0).\n";
+	std::cout << "    --seed <num>       | Random seed for the oven model, drops and noise (default=0).\n";
+	std::cout << "    --link <path>      | Create a symbolic link to the pty (e.g. /tmp/oven).\n";
+	std::cout << "    --output <file>    | Write a DAT file as fast as possible instead of using a pty (requires --packets unless replaying).\n";
+}
+
+// Model the stage times (us) of a timing frame, roughly those of the firmware on an Arduino Uno. A
+// full sector is written to the SD card about once every 20 packets, and the card occasionally
+// stalls for tens of ms, which delays every task due in the meantime.
+void modelStageTimes(std::mt19937 &generator_, uint32_t *times_){
+	std::uniform_real_distribution<double> uniform(0, 1);
+	times_[TIMING_PRESSURE] = 112+(uint32_t)(16*uniform(generator_));
+	times_[TIMING_THERMO] = 1150+(uint32_t)(100*uniform(generator_));
+	times_[TIMING_RELAYS] = 24+(uint32_t)(8*uniform(generator_));
+	times_[TIMING_LOG] = 180+(uint32_t)(40*uniform(generator_));
+	times_[TIMING_SERIAL] = 28+(uint32_t)(8*uniform(generator_));
+	times_[TIMING_SD] = 0;
+	if(uniform(generator_) < 0.05){
+		times_[TIMING_SD] = (uniform(generator_) < 0.1 ? 20000+(uint32_t)(80000*uniform(generator_)) : 2000+(uint32_t)(1000*uniform(generator_)));
+	}
+	times_[TIMING_LOOP] = 0;
+	for(int i = 0; i < TIMING_LOOP; i++){
+		if(times_[i] > times_[TIMING_LOOP]){ times_[TIMING_LOOP] = times_[i]; }
+	}
+	times_[TIMING_LOOP] += 20;
+	times_[TIMING_LATE] = times_[TIMING_LOOP]-(uint32_t)(20*uniform(generator_));
+}
+
+// Return true if the option at index_ is followed by an argument, otherwise print an error.
+bool checkArgument(const int &argc_, char *argv_[], const int &index_){
+	if(index_ + 1 < argc_){ return true; }
+	std::cout << " Error! Missing required argument to '" << argv_[index_] << "'!\n";
+	help(argv_[0]);
+	return false;
+}
+
+int main(int argc, char* argv[]){
+	double rate = DEFAULT_RATE;
+	unsigned int period = MODEL_PERIOD;
+	size_t maxPackets = 0;
+	PacketFormat format = FORMAT_UNKNOWN;
+	std::string replayName;
+	double speed = 1;
+	double dropProb = 0;
+	double noiseProb = 0;
+	unsigned int seed = 0;
+	std::string linkName;
+	std::string outputName;
+	bool timing = false;
+	bool compact = true;
+	bool frameOption = false; // Set if --compact or --full was given.
+
+	int index = 1;
+	while(index < argc){
+		if(strcmp(argv[index], "-h") == 0 || strcmp(argv[index], "--help") == 0){
+			help(argv[0]);
+			return 0;
+		}
+		else if(strcmp(argv[index], "--legacy") == 0){
+			format = FORMAT_LEGACY;
+		}
+		else if(strcmp(argv[index], "--framed") == 0){
+			format = FORMAT_FRAMED;
+		}
+		else if(strcmp(argv[index], "--compact") == 0){
+			compact = true;
+			frameOption = true;
+		}
+		else if(strcmp(argv[index], "--full") == 0){
+			compact = false;
+			frameOption = true;
+		}
+		else if(strcmp(argv[index], "--timing") == 0){
+			timing = true;
+		}
+		else if(strcmp(argv[index], "--rate") == 0){
+			if(!checkArgument(argc, argv, index)){ return 1; }
+			rate = strtod(argv[++index], NULL);
+			if(rate <= 0){
+				std::cout << " Error! Packet rate must be greater than zero!\n";
+				return 1;
+			}
+		}
+		else if(strcmp(argv[index], "--period") == 0){
+			if(!checkArgument(argc, argv, index)){ return 1; }
+			period = strtoul(argv[++index], NULL, 0);
+		}
+		else if(strcmp(argv[index], "--packets") == 0){
+			if(!checkArgument(argc, argv, index)){ return 1; }
+			maxPackets = strtoul(argv[++index], NULL, 0);
+		}
+		else if(strcmp(argv[index], "--replay") == 0){
+			if(!checkArgument(argc, argv, index)){ return 1; }
+			replayName = argv[++index];
+		}
+		else if(strcmp(argv[index], "--speed") == 0){
+			if(!checkArgument(argc, argv, index)){ return 1; }
+			speed = strtod(argv[++index], NULL);
+			if(speed <= 0){
+				std::cout << " Error! Replay speed must be greater than zero!\n";
+				return 1;
+			}
+		}
+		else if(strcmp(argv[index], "--drop") == 0){
+			if(!checkArgument(argc, argv, index)){ return 1; }
+			dropProb = strtod(argv[++index], NULL);
+		}
+		else if(strcmp(argv[index], "--noise") == 0){
+			if(!checkArgument(argc, argv, index)){ return 1; }
+			noiseProb = strtod(argv[++index], NULL);
+		}
+		else if(strcmp(argv[index], "--seed") == 0){
+			if(!checkArgument(argc, argv, index)){ return 1; }
+			seed = strtoul(argv[++index], NULL, 0);
+		}
+		else if(strcmp(argv[index], "--link") == 0){
+			if(!checkArgument(argc, argv, index)){ return 1; }
+			linkName = argv[++index];
+		}
+		else if(strcmp(argv[index], "--output") == 0){
+			if(!checkArgument(argc, argv, index)){ return 1; }
+			outputName = argv[++index];
+		}
+		else{
+			std::cout << " Error! Unrecognized option '" << argv[index] << "'!\n";
+			help(argv[0]);
+			return 1;
+		}
+		index++;
+	}
+
+	// Load the packets to replay.
+	PacketColumns replay;
+	size_t row = 0;
+	if(!replayName.empty()){
+		MappedFile file;
+		if(!file.open(replayName)){
+			std::cout << " ERROR: Failed to open input file '" << replayName << "'!\n";
+			return 1;
+		}
+		char title[64];
+		size_t offset = readTitle(file.getData(), file.getSize(), title, 64);
+		PacketFormat fileFormat = detectFormat(file.getData()+offset, file.getSize()-offset);
+		if(fileFormat != FORMAT_FRAMED){ fileFormat = FORMAT_LEGACY; }
+
+		if(fileFormat == FORMAT_FRAMED){
+			FrameDecoder frames;
+			frames.setInput(file.getData(), file.getSize(), offset);
+			while(frames.decode(replay)){ }
+		}
+		else{
+			BatchDecoder decoder(file.getData(), file.getSize(), offset);
+			decoder.setScalar(!BatchDecoder::haveSIMD());
+			while(decoder.decode(replay)){ }
+
+			// The first packet of a legacy file is junk left by the lone delimiter after the title.
+			if(replay.size() > 0){ row = 1; }
+		}
+		std::cout << " Replaying " << replay.size()-row << " " << getFormatName(fileFormat) << " packets from '" << replayName << "' (" << title << ").\n";
+
+		if(format == FORMAT_UNKNOWN){ format = fileFormat; }
+	}
+	if(format == FORMAT_UNKNOWN){ format = FORMAT_FRAMED; }
+	if(timing && format != FORMAT_FRAMED){
+		std::cout << " Error! Timing frames may only be sent with framed packets!\n";
+		return 1;
+	}
+	if(frameOption && format != FORMAT_FRAMED){
+		std::cout << " Error! --compact and --full may only be used with framed packets!\n";
+		return 1;
+	}
+
+	if(!replayName.empty() && (maxPackets == 0 || maxPackets > replay.size()-row)){
+		maxPackets = replay.size()-row;
+	}
+
+	std::ofstream output;
+	std::string ptyName;
+	int fd = -1;
+	if(!outputName.empty()){
+		if(maxPackets == 0){
+			std::cout << " Error! The number of packets must be given with '--output'!\n";
+			return 1;
+		}
+		output.open(outputName.c_str(), std::ios::binary);
+		if(!output.good()){
+			std::cout << " ERROR: Failed to open output file '" << outputName << "'!\n";
+			return 1;
+		}
+
+		// Start the file the same way the firmware does.
+		char header[HEADER_MAX_LENGTH];
+		output.write(header, encodeHeader(format, header));
+		std::cout << " Writing " << maxPackets << " " << getFormatName(format) << " packets to '" << outputName << "'." << std::endl;
+	}
+	else{
+		fd = openPty(ptyName);
+		if(fd < 0){
+			std::cout << " ERROR: Failed to open a pseudo-terminal!\n";
+			return 1;
+		}
+		if(!linkName.empty()){
+			unlink(linkName.c_str());
+			if(symlink(ptyName.c_str(), linkName.c_str()) != 0){
+				std::cout << " ERROR: Failed to create link '" << linkName << "' to " << ptyName << "!\n";
+				close(fd);
+				return 1;
+			}
+		}
+		std::cout << " Virtual oven on " << ptyName;
+		if(!linkName.empty()){ std::cout << " (" << linkName << ")"; }
+		std::cout << ", sending " << getFormatName(format) << " packets." << std::endl;
+	}
+
+	setup_signal_handlers();
+
+	if(fd >= 0){
+		// Wait for a reader to open the port.
+		std::cout << " Waiting for a reader..." << std::endl;
+		while(!SIGNAL_INTERRUPT && !haveReader(fd)){
+			usleep(MAX_SLEEP);
+		}
+	}
+
+	OvenModel oven(seed);
+	LineNoise line(dropProb, noiseProb, seed);
+
+	std::mt19937 timingGenerator(seed);
+	uint32_t stageTimes[FRAME_TIMING_STAGES];
+
+	std::vector<char> block(WRITE_BLOCK_SIZE+FRAME_MAX_LENGTH+FRAME_TIMING_MAX_LENGTH);
+	size_t numSent = 0;
+	size_t numBytes = 0;
+	uint32_t sequence = 0;
+	double nextTime = 0; // Time at which the next packet is due (s).
+	bool connected = !SIGNAL_INTERRUPT;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	while(connected && !SIGNAL_INTERRUPT && (maxPackets == 0 || numSent < maxPackets)){
+		// Files are written without waiting for packets to be due.
+		double now = (fd >= 0 ? std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count() : 0);
+		if(fd >= 0 && now < nextTime){
+			double wait = 1E6*(nextTime-now);
+			usleep(wait < MAX_SLEEP ? (useconds_t)wait : MAX_SLEEP);
+			continue;
+		}
+
+		// Encode every packet which is due.
+		size_t len = 0;
+		while((fd < 0 || now >= nextTime) && len < WRITE_BLOCK_SIZE && (maxPackets == 0 || numSent < maxPackets)){
+			if(!replayName.empty()){
+				len += encodePacket(format, &block[len], sequence++, replay.timestamp[row], replay.temperature[row], replay.pressure[row], replay.relay1[row], replay.relay2[row], compact);
+				if(timing){
+					modelStageTimes(timingGenerator, stageTimes);
+					len += buildTimingFrame((uint8_t*)&block[len], replay.timestamp[row], stageTimes);
+				}
+				row++;
+
+				// Follow the recorded timestamps. Reboots and time going backwards use the default period.
+				double delay = period/1000.0;
+				if(row < replay.size() && replay.timestamp[row] > replay.timestamp[row-1]){
+					delay = (replay.timestamp[row]-replay.timestamp[row-1])/1000.0;
+				}
+				nextTime += delay/speed;
+			}
+			else{
+				oven.step(period);
+				len += encodePacket(format, &block[len], sequence++, oven.getTimestamp(), oven.getTemperature(), oven.getPressure(), oven.getRelay1(), oven.getRelay2(), compact);
+				if(timing){
+					modelStageTimes(timingGenerator, stageTimes);
+					len += buildTimingFrame((uint8_t*)&block[len], oven.getTimestamp(), stageTimes);
+				}
+				nextTime += 1/rate;
+			}
+			numSent++;
+		}
+
+		if(line.isEnabled()){ len = line.apply(&block[0], len); }
+		if(fd < 0){
+			output.write(&block[0], len);
+			if(!output.good()){
+				std::cout << " ERROR: Failed to write to output file '" << outputName << "'!\n";
+				connected = false;
+			}
+		}
+		else if(!haveReader(fd) || !writeAll(fd, &block[0], len)){
+			std::cout << " Reader disconnected.\n";
+			connected = false;
+		}
+		numBytes += len;
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+
+	if(fd >= 0){
+		// Give the reader time to drain the pty before it is closed.
+		if(connected){ tcdrain(fd); }
+		close(fd);
+		if(!linkName.empty()){ unlink(linkName.c_str()); }
+	}
+	else{ output.close(); }
+
+	std::cout << (fd >= 0 ? " Sent " : " Wrote ") << numSent << " packets (" << numBytes << " bytes) in " << seconds << " s";
+	if(seconds > 0){ std::cout << " (" << numSent/seconds << " packets/s)"; }
+	std::cout << ".\n";
+	if(line.isEnabled()){
+		std::cout << "  Dropped " << line.getNumDropped() << " bytes, corrupted " << line.getNumCorrupted() << " bytes.\n";
+	}
+
+	return 0;
+}
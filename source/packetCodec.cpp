@@ -0,0 +1,500 @@
+#include <string.h>
+#include <unistd.h>
+
+#include "packetCodec.hpp"
+
+// Maximum number of records accepted in a single block when decoding.
+#define CODEC_MAX_BLOCK_SIZE 16777216
+
+// Most significant bit first writer for the time and float streams.
+class BitWriter{
+  public:
+	BitWriter(std::vector<char> &out_) : out(out_), acc(0), count(0) { }
+
+	// Append the lowest N_ bits of value_ (N_ <= 32).
+	void write(const uint64_t &value_, const unsigned int &N_){
+		acc = (acc << N_) | (value_ & ((1ULL << N_)-1));
+		count += N_;
+		while(count >= 8){
+			count -= 8;
+			out.push_back((char)(acc >> count));
+		}
+	}
+
+	// Write any remaining bits, padded with zeros.
+	void flush(){
+		if(count > 0){ out.push_back((char)(acc << (8-count))); }
+		count = 0;
+	}
+
+  private:
+	std::vector<char> &out;
+
+	uint64_t acc;
+	unsigned int count;
+};
+
+// Most significant bit first reader for the time and float streams. The next bits of the stream
+// are kept left aligned in a 64 bit word, which is refilled 8 bytes at a time.
+class BitReader{
+  public:
+	BitReader(const char *data_, const size_t &len_) : ptr((const uint8_t*)data_), end((const uint8_t*)data_+len_), acc(0), avail(0) { }
+
+	// Make at least 56 bits available, if the stream has that many left.
+	void refill(){
+		if(end-ptr >= 8){
+			uint64_t word;
+			memcpy((char*)&word, ptr, 8);
+			acc |= __builtin_bswap64(word) >> avail;
+			ptr += (63-avail) >> 3;
+			avail |= 56;
+		}
+		else{
+			while(avail <= 56 && ptr < end){
+				acc |= (uint64_t)(*ptr++) << (56-avail);
+				avail += 8;
+			}
+		}
+	}
+
+	// Return the number of leading one bits, up to max_ (max_ < 8).
+	unsigned int countOnes(const unsigned int &max_){
+		if(avail < 8){ refill(); }
+		return __builtin_clzll(~acc | (1ULL << (63-max_)));
+	}
+
+	// Return the number of leading zero bits, up to max_ and at most the number of bits available.
+	unsigned int countZeros(const size_t &max_){
+		if(avail < 8){ refill(); }
+		unsigned int zeros = (acc != 0 ? __builtin_clzll(acc) : 64);
+		if(zeros > (unsigned int)avail){ zeros = (avail > 0 ? avail : 0); }
+		return (zeros < max_ ? zeros : max_);
+	}
+
+	// Read the next N_ bits (N_ <= 32).
+	uint32_t read(const unsigned int &N_){
+		if(avail < (int)N_){ refill(); }
+		uint32_t value = (N_ > 0 ? acc >> (64-N_) : 0);
+		acc <<= N_;
+		avail -= N_;
+		return value;
+	}
+
+	void skip(const unsigned int &N_){
+		acc <<= N_;
+		avail -= N_;
+	}
+
+	// Return true if more bits were read than the stream contains.
+	bool overrun() const { return (avail < 0); }
+
+  private:
+	const uint8_t *ptr;
+	const uint8_t *end;
+
+	uint64_t acc;
+	int avail;
+};
+
+// Return the length of a stream after padding it to an 8 byte boundary.
+static size_t paddedLength(const size_t &len_){
+	return (len_+7) & ~(size_t)7;
+}
+
+static void padStream(std::vector<char> &out_){
+	out_.resize(paddedLength(out_.size()), 0);
+}
+
+static uint32_t zigzag(const int32_t &value_){
+	return ((uint32_t)value_ << 1) ^ (uint32_t)(value_ >> 31);
+}
+
+static int32_t unzigzag(const uint32_t &value_){
+	return (int32_t)(value_ >> 1) ^ -(int32_t)(value_ & 1);
+}
+
+// Delta-of-delta encode N_ timestamps. Return the length of the stream (bytes).
+static size_t encodeTimes(const unsigned int *times_, const size_t &N_, std::vector<char> &out_){
+	const size_t begin = out_.size();
+	BitWriter bits(out_);
+
+	uint32_t prevTime = times_[0];
+	uint32_t prevDelta = 0;
+	bits.write(prevTime, 32);
+	for(size_t i = 1; i < N_; i++){
+		uint32_t delta = times_[i]-prevTime;
+		uint32_t value = zigzag((int32_t)(delta-prevDelta));
+		if(value == 0){ bits.write(0, 1); }
+		else if(value < (1 << 7)){ bits.write(0x2, 2); bits.write(value, 7); }
+		else if(value < (1 << 9)){ bits.write(0x6, 3); bits.write(value, 9); }
+		else if(value < (1 << 12)){ bits.write(0xE, 4); bits.write(value, 12); }
+		else{ bits.write(0xF, 4); bits.write(value, 32); }
+		prevTime = times_[i];
+		prevDelta = delta;
+	}
+	bits.flush();
+
+	return out_.size()-begin;
+}
+
+static bool decodeTimes(const char *data_, const size_t &len_, unsigned int *times_, const size_t &N_){
+	// Number of bits following each control prefix, by the number of leading ones.
+	static const unsigned int prefixLength[5] = {1, 2, 3, 4, 4};
+	static const unsigned int valueLength[5] = {0, 7, 9, 12, 32};
+
+	BitReader bits(data_, len_);
+	uint32_t prevTime = bits.read(32);
+	uint32_t prevDelta = 0;
+	times_[0] = prevTime;
+	for(size_t i = 1; i < N_; i++){
+		// Each zero bit is a timestamp with the same delta as the last one.
+		unsigned int zeros = bits.countZeros(N_-i);
+		if(zeros > 0){
+			bits.skip(zeros);
+			for(unsigned int j = 0; j < zeros; j++){
+				prevTime += prevDelta;
+				times_[i+j] = prevTime;
+			}
+			i += zeros-1;
+			continue;
+		}
+
+		unsigned int ones = bits.countOnes(4);
+		bits.skip(prefixLength[ones]);
+		prevDelta += unzigzag(bits.read(valueLength[ones]));
+		prevTime += prevDelta;
+		times_[i] = prevTime;
+	}
+
+	return !bits.overrun();
+}
+
+// XOR encode N_ floats. Return the length of the stream (bytes).
+static size_t encodeFloats(const float *values_, const size_t &N_, std::vector<char> &out_){
+	const size_t begin = out_.size();
+	BitWriter bits(out_);
+
+	uint32_t prev;
+	memcpy((char*)&prev, (const char*)&values_[0], 4);
+	bits.write(prev, 32);
+	int prevLead = -1;
+	int prevTrail = 0;
+	for(size_t i = 1; i < N_; i++){
+		uint32_t value;
+		memcpy((char*)&value, (const char*)&values_[i], 4);
+		uint32_t diff = value ^ prev;
+		prev = value;
+		if(diff == 0){
+			bits.write(0, 1);
+			continue;
+		}
+
+		int lead = __builtin_clz(diff);
+		int trail = __builtin_ctz(diff);
+		if(prevLead >= 0 && lead >= prevLead && trail >= prevTrail){ // Reuse the previous window.
+			bits.write(0x2, 2);
+			bits.write(diff >> prevTrail, 32-prevLead-prevTrail);
+		}
+		else{
+			int length = 32-lead-trail;
+			bits.write(0x3, 2);
+			bits.write(lead, 5);
+			bits.write(length-1, 5);
+			bits.write(diff >> trail, length);
+			prevLead = lead;
+			prevTrail = trail;
+		}
+	}
+	bits.flush();
+
+	return out_.size()-begin;
+}
+
+static bool decodeFloats(const char *data_, const size_t &len_, float *values_, const size_t &N_){
+	BitReader bits(data_, len_);
+	uint32_t prev = bits.read(32);
+	memcpy((char*)&values_[0], (const char*)&prev, 4);
+	int lead = 0;
+	int trail = 0;
+	for(size_t i = 1; i < N_; i++){
+		// Each zero bit is a repeat of the last value.
+		unsigned int zeros = bits.countZeros(N_-i);
+		if(zeros > 0){
+			bits.skip(zeros);
+			for(unsigned int j = 0; j < zeros; j++){ memcpy((char*)&values_[i+j], (const char*)&prev, 4); }
+			i += zeros-1;
+			continue;
+		}
+
+		unsigned int ones = bits.countOnes(2);
+		bits.skip(ones == 0 ? 1 : 2);
+		if(ones == 2){
+			lead = bits.read(5);
+			trail = 32-lead-(int)(bits.read(5)+1);
+			if(trail < 0){ return false; }
+		}
+		if(ones > 0){ prev ^= bits.read(32-lead-trail) << trail; }
+		memcpy((char*)&values_[i], (const char*)&prev, 4);
+	}
+
+	return !bits.overrun();
+}
+
+// Run-length encode N_ pairs of relay states. Return the length of the stream (bytes).
+static size_t encodeRelays(const short *relay1_, const short *relay2_, const size_t &N_, std::vector<char> &out_){
+	const size_t begin = out_.size();
+	size_t i = 0;
+	while(i < N_){
+		size_t run = 1;
+		while(i+run < N_ && relay1_[i+run] == relay1_[i] && relay2_[i+run] == relay2_[i]){ run++; }
+
+		char entry[4];
+		memcpy(&entry[0], (const char*)&relay1_[i], 2);
+		memcpy(&entry[2], (const char*)&relay2_[i], 2);
+		out_.insert(out_.end(), entry, entry+4);
+		for(size_t value = run; ; value >>= 7){
+			if(value < 0x80){
+				out_.push_back((char)value);
+				break;
+			}
+			out_.push_back((char)(0x80 | (value & 0x7F)));
+		}
+		i += run;
+	}
+
+	return out_.size()-begin;
+}
+
+static bool decodeRelays(const char *data_, const size_t &len_, short *relay1_, short *relay2_, const size_t &N_){
+	const uint8_t *ptr = (const uint8_t*)data_;
+	const uint8_t *end = ptr+len_;
+	size_t i = 0;
+	while(i < N_){
+		short state1, state2;
+		if(end-ptr < 5){ return false; }
+		memcpy((char*)&state1, ptr, 2);
+		memcpy((char*)&state2, ptr+2, 2);
+		ptr += 4;
+
+		size_t run = 0;
+		for(unsigned int shift = 0; ; shift += 7){
+			if(ptr >= end || shift > 28){ return false; }
+			run |= (size_t)(*ptr & 0x7F) << shift;
+			if(!(*ptr++ & 0x80)){ break; }
+		}
+		if(run == 0 || run > N_-i){ return false; }
+
+		for(size_t j = 0; j < run; j++){
+			relay1_[i+j] = state1;
+			relay2_[i+j] = state2;
+		}
+		i += run;
+	}
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// class CodecWriter
+///////////////////////////////////////////////////////////////////////////////
+
+CodecWriter::CodecWriter(const size_t &blockSize_/*=CODEC_BLOCK_SIZE*/) : numRecords(0), numBytes(0) {
+	blockSize = (blockSize_ > 0 && blockSize_ <= CODEC_MAX_BLOCK_SIZE ? blockSize_ : CODEC_BLOCK_SIZE);
+}
+
+CodecWriter::~CodecWriter(){
+	close();
+}
+
+bool CodecWriter::open(const std::string &fname_, const char *title_/*=NULL*/){
+	close();
+
+	file.open(fname_.c_str(), std::ios::binary | std::ios::trunc);
+	if(!file.is_open()){ return false; }
+
+	CodecHeader header;
+	memset((char*)&header, 0, sizeof(CodecHeader));
+	strncpy(header.magic, CODEC_MAGIC, 8);
+	header.version = CODEC_VERSION;
+	header.blockSize = blockSize;
+	if(title_){ strncpy(header.title, title_, 63); }
+	file.write((const char*)&header, sizeof(CodecHeader));
+
+	block.clear();
+	block.reserve(blockSize);
+	numRecords = 0;
+	numBytes = sizeof(CodecHeader);
+
+	return true;
+}
+
+bool CodecWriter::append(const std::string &fname_){
+	close();
+
+	MappedFile input;
+	CodecReader reader;
+	if(!input.open(fname_) || !reader.setInput(input.getData(), input.getSize())){ return false; }
+
+	// Find the last block using the block headers, so that only the last block is decoded.
+	const char *data = input.getData();
+	size_t offset = reader.getOffset();
+	size_t last = offset;
+	numRecords = 0;
+	while(offset+sizeof(CodecBlock) <= input.getSize()){
+		CodecBlock info;
+		memcpy((char*)&info, &data[offset], sizeof(CodecBlock));
+		size_t len = sizeof(CodecBlock)+paddedLength(info.timeLength)+paddedLength(info.tempLength)+paddedLength(info.presLength)+paddedLength(info.relayLength);
+		if(info.numRecords == 0 || offset+len > input.getSize()){ break; } // Incomplete block.
+		last = offset;
+		offset += len;
+		numRecords += info.numRecords;
+	}
+
+	// Decode an incomplete last block (or drop a corrupt one) and write it again with the new records.
+	block.clear();
+	block.reserve(blockSize);
+	if(last < offset){
+		const size_t len = CodecReader::decodeBlock(&data[last], offset-last, block);
+		if(len == 0 || block.size() < blockSize){
+			numRecords -= ((const CodecBlock*)&data[last])->numRecords;
+			offset = last;
+		}
+		else{ block.clear(); }
+	}
+	input.close();
+
+	// Remove everything after the last full block.
+	if(truncate(fname_.c_str(), offset) != 0){ return false; }
+	file.open(fname_.c_str(), std::ios::binary | std::ios::in | std::ios::out);
+	if(!file.is_open()){ return false; }
+	file.seekp(offset);
+	numBytes = offset;
+
+	return true;
+}
+
+void CodecWriter::add(const unsigned int &timestamp_, const float &temperature_, const float &pressure_, const short &relay1_, const short &relay2_){
+	if(!file.is_open()){ return; }
+
+	block.timestamp.push_back(timestamp_);
+	block.temperature.push_back(temperature_);
+	block.pressure.push_back(pressure_);
+	block.relay1.push_back(relay1_);
+	block.relay2.push_back(relay2_);
+
+	if(block.size() >= blockSize){ flush(); }
+}
+
+void CodecWriter::close(){
+	if(!file.is_open()){ return; }
+	flush();
+	file.close();
+}
+
+size_t CodecWriter::encodeBlock(const PacketColumns &cols_, const size_t &start_, const size_t &N_, std::vector<char> &out_){
+	if(N_ == 0){ return 0; }
+
+	const size_t begin = out_.size();
+	out_.resize(begin+sizeof(CodecBlock));
+
+	CodecBlock info;
+	memset((char*)&info, 0, sizeof(CodecBlock));
+	info.numRecords = N_;
+	info.timeLength = encodeTimes(&cols_.timestamp[start_], N_, out_);
+	padStream(out_);
+	info.tempLength = encodeFloats(&cols_.temperature[start_], N_, out_);
+	padStream(out_);
+	info.presLength = encodeFloats(&cols_.pressure[start_], N_, out_);
+	padStream(out_);
+	info.relayLength = encodeRelays(&cols_.relay1[start_], &cols_.relay2[start_], N_, out_);
+	padStream(out_);
+	memcpy(&out_[begin], (const char*)&info, sizeof(CodecBlock));
+
+	return out_.size()-begin;
+}
+
+void CodecWriter::flush(){
+	size_t N = block.size();
+	if(N == 0){ return; }
+
+	buffer.clear();
+	encodeBlock(block, 0, N, buffer);
+	file.write(&buffer[0], buffer.size());
+
+	numRecords += N;
+	numBytes += buffer.size();
+	block.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// class CodecReader
+///////////////////////////////////////////////////////////////////////////////
+
+CodecReader::CodecReader() : data(NULL), length(0), offset(0), numDecoded(0) {
+	title[0] = '\0';
+}
+
+bool CodecReader::isCompressed(const char *data_, const size_t &len_){
+	return (data_ && len_ >= sizeof(CodecHeader) && strncmp(data_, CODEC_MAGIC, 8) == 0);
+}
+
+bool CodecReader::setInput(const char *data_, const size_t &len_){
+	data = NULL;
+	length = 0;
+	offset = 0;
+	if(!isCompressed(data_, len_)){ return false; }
+
+	CodecHeader header;
+	memcpy((char*)&header, data_, sizeof(CodecHeader));
+	if(header.version != CODEC_VERSION){ return false; }
+	memcpy(title, header.title, 63);
+	title[63] = '\0';
+
+	data = data_;
+	length = len_;
+	offset = sizeof(CodecHeader);
+
+	return true;
+}
+
+size_t CodecReader::decode(PacketColumns &cols_){
+	if(eof()){ return 0; }
+
+	size_t index = cols_.size();
+	size_t len = decodeBlock(&data[offset], length-offset, cols_);
+	if(len == 0){ return 0; } // Truncated or corrupt block. The offset is left at the start of the block.
+	offset += len;
+	numDecoded += cols_.size()-index;
+
+	return cols_.size()-index;
+}
+
+size_t CodecReader::decodeBlock(const char *data_, const size_t &len_, PacketColumns &cols_){
+	if(len_ < sizeof(CodecBlock)){ return 0; }
+
+	CodecBlock info;
+	memcpy((char*)&info, data_, sizeof(CodecBlock));
+	const size_t N = info.numRecords;
+	const size_t tempOffset = sizeof(CodecBlock)+paddedLength(info.timeLength);
+	const size_t presOffset = tempOffset+paddedLength(info.tempLength);
+	const size_t relayOffset = presOffset+paddedLength(info.presLength);
+	const size_t total = relayOffset+paddedLength(info.relayLength);
+	if(N == 0 || N > CODEC_MAX_BLOCK_SIZE || total > len_){ return 0; }
+
+	const char *timeStream = data_+sizeof(CodecBlock);
+	const char *tempStream = data_+tempOffset;
+	const char *presStream = data_+presOffset;
+	const char *relayStream = data_+relayOffset;
+
+	size_t index = cols_.size();
+	cols_.resize(index+N);
+	if(!decodeTimes(timeStream, info.timeLength, &cols_.timestamp[index], N) ||
+	   !decodeFloats(tempStream, info.tempLength, &cols_.temperature[index], N) ||
+	   !decodeFloats(presStream, info.presLength, &cols_.pressure[index], N) ||
+	   !decodeRelays(relayStream, info.relayLength, &cols_.relay1[index], &cols_.relay2[index], N)){
+		cols_.resize(index);
+		return 0;
+	}
+
+	return total;
+}
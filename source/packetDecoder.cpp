@@ -0,0 +1,373 @@
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cmath>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "packetDecoder.hpp"
+
+// Maximum number of packets to validate in a single SIMD block.
+#define SIMD_BLOCK_SIZE 64
+
+// Size of the chunks used when the input cannot be memory mapped.
+#define READ_CHUNK_SIZE 1048576
+
+// Read the title from the start of a file buffer. Return the offset of the first byte after the title.
+size_t readTitle(const char *data_, const size_t &size_, char *buf_, const char &len_){
+	buf_[0] = '\0';
+	if(!data_ || size_ == 0){ return 0; }
+
+	char titleLen = data_[0];
+	if(titleLen < 0){ titleLen = 0; }
+	else if(titleLen > len_){ titleLen = len_-1; }
+	if((size_t)titleLen+1 > size_){ titleLen = size_-1; }
+	
+	memcpy(buf_, &data_[1], titleLen);
+	buf_[(titleLen < len_ ? titleLen : len_-1)] = '\0';
+
+	return titleLen+1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// class PacketColumns
+///////////////////////////////////////////////////////////////////////////////
+
+void PacketColumns::resize(const size_t &N_){
+	timestamp.resize(N_);
+	temperature.resize(N_);
+	pressure.resize(N_);
+	relay1.resize(N_);
+	relay2.resize(N_);
+}
+
+void PacketColumns::reserve(const size_t &N_){
+	timestamp.reserve(N_);
+	temperature.reserve(N_);
+	pressure.reserve(N_);
+	relay1.reserve(N_);
+	relay2.reserve(N_);
+}
+
+void PacketColumns::clear(){
+	timestamp.clear();
+	temperature.clear();
+	pressure.clear();
+	relay1.clear();
+	relay2.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// class MappedFile
+///////////////////////////////////////////////////////////////////////////////
+
+MappedFile::MappedFile() : data(NULL), length(0), opened(false), mapped(false) { }
+
+MappedFile::~MappedFile(){
+	close();
+}
+
+bool MappedFile::open(const std::string &fname_){
+	close();
+
+	int fd = ::open(fname_.c_str(), O_RDONLY);
+	if(fd < 0){ return false; }
+
+	struct stat info;
+	if(fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0){
+		void *ptr = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if(ptr != MAP_FAILED){
+			madvise(ptr, info.st_size, MADV_SEQUENTIAL);
+			data = (const char*)ptr;
+			length = info.st_size;
+			mapped = true;
+			opened = true;
+			::close(fd);
+			return true;
+		}
+	}
+
+	// Unable to map the file, read it using large buffered reads instead.
+	ssize_t numBytes;
+	size_t total = 0;
+	while(true){
+		buffer.resize(total+READ_CHUNK_SIZE);
+		numBytes = read(fd, &buffer[total], READ_CHUNK_SIZE);
+		if(numBytes <= 0){ break; }
+		total += numBytes;
+	}
+	::close(fd);
+
+	if(numBytes < 0){
+		buffer.clear();
+		return false;
+	}
+
+	buffer.resize(total);
+	data = (total > 0 ? &buffer[0] : NULL);
+	length = total;
+	opened = true;
+
+	return true;
+}
+
+void MappedFile::close(){
+	if(mapped){ munmap((void*)data, length); }
+	buffer.clear();
+	data = NULL;
+	length = 0;
+	opened = false;
+	mapped = false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// class BatchDecoder
+///////////////////////////////////////////////////////////////////////////////
+
+BatchDecoder::BatchDecoder() : data(NULL), length(0), offset(0), tail(0), numDecoded(0), numSkipped(0), numSkippedBytes(0), scalar(false), resync(false), lastTime(0), haveTime(false) { }
+
+BatchDecoder::BatchDecoder(const char *data_, const size_t &len_, const size_t &offset_/*=0*/) : numDecoded(0), numSkipped(0), numSkippedBytes(0), scalar(false), resync(false), lastTime(0), haveTime(false) {
+	setInput(data_, len_, offset_);
+}
+
+void BatchDecoder::setInput(const char *data_, const size_t &len_, const size_t &offset_/*=0*/){
+	data = data_;
+	length = (data_ ? len_ : 0);
+	offset = offset_;
+	tail = length;
+}
+
+bool BatchDecoder::haveSIMD(){
+#ifdef __SSE2__
+	return true;
+#else
+	return false;
+#endif
+}
+
+size_t BatchDecoder::decode(PacketColumns &cols_, const size_t &N_/*=PACKET_BLOCK_SIZE*/){
+	size_t start = cols_.size();
+	size_t count = 0;
+
+	cols_.resize(start+N_);
+	while(count < N_ && !eof()){
+		if(!scalar && !resync){ // Attempt to decode a contiguous block of packets.
+			size_t block = (length-offset)/PACKET_LENGTH;
+			if(block > N_-count){ block = N_-count; }
+			if(block > SIMD_BLOCK_SIZE){ block = SIMD_BLOCK_SIZE; }
+			if(block > 0 && decodeBlock(cols_, start+count, block)){
+				offset += block*PACKET_LENGTH;
+				count += block;
+				lastTime = cols_.timestamp[start+count-1];
+				haveTime = true;
+				continue;
+			}
+		}
+
+		// The block is misaligned or incomplete, or every packet must be checked in resync mode.
+		// Fall back on the sequential decoder.
+		size_t block = N_-count;
+		if(!scalar && block > SIMD_BLOCK_SIZE){ block = SIMD_BLOCK_SIZE; }
+		count += (resync ? decodeResync(cols_, start+count, block) : decodeScalar(cols_, start+count, block));
+	}
+	cols_.resize(start+count);
+	numDecoded += count;
+
+	if(count > 0){
+		lastTime = cols_.timestamp[start+count-1];
+		haveTime = true;
+	}
+
+	return count;
+}
+
+size_t BatchDecoder::decodeScalar(PacketColumns &cols_, const size_t &start_, const size_t &N_){
+	unsigned int word;
+	size_t count = 0;
+	while(count < N_){
+		if(offset+4 > length){ // End of input.
+			tail = offset;
+			offset = length;
+			break;
+		}
+
+		// Check for the beginning of a new packet.
+		memcpy((char*)&word, &data[offset], 4);
+		if(word != PACKET_DELIMITER){
+			offset += 4;
+			numSkipped++;
+			continue;
+		}
+
+		if(offset+PACKET_LENGTH > length){ // Incomplete packet at the end of the input.
+			tail = offset;
+			offset = length;
+			break;
+		}
+
+		unpackPacket(&data[offset], cols_.timestamp[start_+count], cols_.temperature[start_+count], cols_.pressure[start_+count], 
+		             cols_.relay1[start_+count], cols_.relay2[start_+count]);
+
+		offset += PACKET_LENGTH;
+		count++;
+	}
+	return count;
+}
+
+size_t BatchDecoder::decodeResync(PacketColumns &cols_, const size_t &start_, const size_t &N_){
+	size_t count = 0;
+	while(count < N_){
+		if(offset+PACKET_LENGTH > length){ // End of input.
+			tail = offset;
+			offset = length;
+			break;
+		}
+
+		if(!isAcceptable(offset)){
+			// Search for the next acceptable packet at byte granularity.
+			SkippedRegion region;
+			region.offset = offset;
+			do{
+				offset = findDelimiter(offset+1);
+			} while(offset+PACKET_LENGTH <= length && !isAcceptable(offset));
+			if(offset > length){ offset = length; }
+
+			region.length = offset-region.offset;
+			skipped.push_back(region);
+			numSkippedBytes += region.length;
+			continue;
+		}
+
+		unpackPacket(&data[offset], cols_.timestamp[start_+count], cols_.temperature[start_+count], cols_.pressure[start_+count], 
+		             cols_.relay1[start_+count], cols_.relay2[start_+count]);
+		lastTime = cols_.timestamp[start_+count];
+		haveTime = true;
+
+		offset += PACKET_LENGTH;
+		count++;
+	}
+	return count;
+}
+
+bool BatchDecoder::isPlausible(const size_t &offset_, unsigned int &timestamp_) const {
+	if(offset_+PACKET_LENGTH > length){ return false; }
+
+	unsigned int word;
+	memcpy((char*)&word, &data[offset_], 4);
+	if(word != PACKET_DELIMITER){ return false; }
+
+	float temperature, pressure;
+	short relay1, relay2;
+	unpackPacket(&data[offset_], timestamp_, temperature, pressure, relay1, relay2);
+
+	// The thermocouple reports a NaN temperature when it is disconnected.
+	if(!std::isnan(temperature) && !(temperature >= RESYNC_MIN_TEMP && temperature <= RESYNC_MAX_TEMP)){ return false; }
+	if(!(pressure >= RESYNC_MIN_VOLTAGE && pressure <= RESYNC_MAX_VOLTAGE)){ return false; }
+
+	return ((relay1 == 0 || relay1 == 1) && (relay2 == 0 || relay2 == 1));
+}
+
+bool BatchDecoder::isAcceptable(const size_t &offset_) const {
+	unsigned int time1, time2;
+	if(!isPlausible(offset_, time1)){ return false; }
+	if(!haveTime || (time1 >= lastTime && time1-lastTime <= RESYNC_MAX_GAP)){ return true; }
+
+	// The timestamp does not follow the previous packet (e.g. the device was reset or the previous
+	// packet was junk), so require the next packet to confirm it.
+	return (isPlausible(offset_+PACKET_LENGTH, time2) && time2 >= time1 && time2-time1 <= RESYNC_MAX_GAP);
+}
+
+size_t BatchDecoder::findDelimiter(const size_t &offset_) const {
+	size_t index = offset_;
+
+#ifdef __SSE2__
+	// Compare 16 bytes at a time. A delimiter starts at byte k if bytes k to k+3 are all 0xFF,
+	// so only the first 13 bytes of each vector may be checked.
+	const __m128i ones = _mm_set1_epi32(-1);
+	for(; index+16 <= length; index += 13){
+		int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)&data[index]), ones));
+		mask &= (mask >> 1) & (mask >> 2) & (mask >> 3);
+		if(mask){ return index+__builtin_ctz(mask); }
+	}
+#endif
+
+	unsigned int word;
+	for(; index+4 <= length; index++){
+		memcpy((char*)&word, &data[index], 4);
+		if(word == PACKET_DELIMITER){ return index; }
+	}
+
+	return length;
+}
+
+#ifdef __SSE2__
+// Select lane k from vector k.
+static inline __m128i selectLanes(const __m128i &v0_, const __m128i &v1_, const __m128i &v2_, const __m128i &v3_){
+	const __m128i m0 = _mm_set_epi32(0, 0, 0, -1);
+	const __m128i m1 = _mm_set_epi32(0, 0, -1, 0);
+	const __m128i m2 = _mm_set_epi32(0, -1, 0, 0);
+	const __m128i m3 = _mm_set_epi32(-1, 0, 0, 0);
+	return _mm_or_si128(_mm_or_si128(_mm_and_si128(v0_, m0), _mm_and_si128(v1_, m1)),
+	                    _mm_or_si128(_mm_and_si128(v2_, m2), _mm_and_si128(v3_, m3)));
+}
+
+// Rotate the 32-bit lanes of a vector down by one, two or three lanes.
+#define ROTATE1(v) _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 3, 2, 1))
+#define ROTATE2(v) _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2))
+#define ROTATE3(v) _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 1, 0, 3))
+#endif
+
+bool BatchDecoder::decodeBlock(PacketColumns &cols_, const size_t &start_, const size_t &N_){
+	const char *ptr = &data[offset];
+	size_t index = 0;
+	bool valid = true;
+
+#ifdef __SSE2__
+	// Four packets (80 bytes) are loaded into five vectors at a time. Word j of packet k
+	// is located in lane (k+j)%4 of vector (5k+j)/4, so each field is gathered into a
+	// single vector by rotating the lanes by j and selecting lane k from each vector.
+	const __m128i ones = _mm_set1_epi32(-1);
+	__m128i delimiters = ones;
+	for(; index+4 <= N_; index += 4, ptr += 4*PACKET_LENGTH){
+		__m128i v0 = _mm_loadu_si128((const __m128i*)&ptr[0]);
+		__m128i v1 = _mm_loadu_si128((const __m128i*)&ptr[16]);
+		__m128i v2 = _mm_loadu_si128((const __m128i*)&ptr[32]);
+		__m128i v3 = _mm_loadu_si128((const __m128i*)&ptr[48]);
+		__m128i v4 = _mm_loadu_si128((const __m128i*)&ptr[64]);
+
+		delimiters = _mm_and_si128(delimiters, selectLanes(v0, v1, v2, v3));
+
+		__m128i times = selectLanes(ROTATE1(v0), ROTATE1(v1), ROTATE1(v2), ROTATE1(v4));
+		__m128i temps = selectLanes(ROTATE2(v0), ROTATE2(v1), ROTATE2(v3), ROTATE2(v4));
+		__m128i press = selectLanes(ROTATE3(v0), ROTATE3(v2), ROTATE3(v3), ROTATE3(v4));
+		__m128i relays = selectLanes(v1, v2, v3, v4);
+
+		// Split the relay words into sign extended 16-bit values.
+		__m128i r1 = _mm_srai_epi32(_mm_slli_epi32(relays, 16), 16);
+		__m128i r2 = _mm_srai_epi32(relays, 16);
+		__m128i packed = _mm_packs_epi32(r1, r2);
+
+		_mm_storeu_si128((__m128i*)&cols_.timestamp[start_+index], times);
+		_mm_storeu_si128((__m128i*)&cols_.temperature[start_+index], temps);
+		_mm_storeu_si128((__m128i*)&cols_.pressure[start_+index], press);
+		_mm_storel_epi64((__m128i*)&cols_.relay1[start_+index], packed);
+		_mm_storel_epi64((__m128i*)&cols_.relay2[start_+index], _mm_srli_si128(packed, 8));
+	}
+	valid = (_mm_movemask_epi8(_mm_cmpeq_epi32(delimiters, ones)) == 0xFFFF);
+#endif
+
+	// Handle any remaining packets.
+	unsigned int word;
+	for(; index < N_; index++, ptr += PACKET_LENGTH){
+		memcpy((char*)&word, ptr, 4);
+		valid = valid && (word == PACKET_DELIMITER);
+		unpackPacket(ptr, cols_.timestamp[start_+index], cols_.temperature[start_+index], cols_.pressure[start_+index], 
+		             cols_.relay1[start_+index], cols_.relay2[start_+index]);
+	}
+
+	return valid;
+}
@@ -0,0 +1,148 @@
+#include <charconv>
+#include <string.h>
+#include <cmath>
+
+#include "packetFormat.hpp"
+
+// Powers of ten used by getOrder(). These are generated by repeated
+// multiplication to reproduce the original search loop exactly.
+class OrderTable{
+  public:
+	float values[20];
+
+	OrderTable(){
+		float test = 1E-10;
+		for(int i = 0; i < 20; i++){
+			values[i] = test;
+			test *= 10.0;
+		}
+	}
+};
+
+static const OrderTable orders;
+
+float calibratePressure(const float &voltage_){
+	// A voltage divider is used in order to get the full
+	// range of 1-8 V from the pressure gauge using the
+	// 5 V arduino. Convert the pressure voltage to the real voltage.
+	float pressure = voltage_/RPRIME;
+
+	// Convert the pressure voltage to an actual pressure.
+	pressure = pow(10.0, (pressure-5.0));
+
+	return pressure;
+}
+
+// Return the order of magnitude of a number
+float getOrder(const float &input_, int &power){
+	// Binary search for the first power of ten which is not less than the input.
+	int low = 0;
+	int high = 20;
+	while(low < high){
+		int mid = (low+high)/2;
+		if(input_/orders.values[mid] <= 1){ high = mid; }
+		else{ low = mid+1; }
+	}
+	if(low == 20){ return 1.0; }
+	power = low-10;
+	return orders.values[low];
+}
+
+char *sciNotation(char *buf_, const float &input_, const size_t &N_/*=2*/){
+	int power = 0;
+	double order = getOrder(input_, power);
+
+	char *end = std::to_chars(buf_, buf_+32, 10*input_/order, std::chars_format::general, 6).ptr;
+
+	// Limit to N_ decimal places due to space constraints
+	char *point = (char*)memchr(buf_, '.', end-buf_);
+	if(point && (size_t)(end-point) > N_+1){ end = point+N_+1; }
+
+	*end++ = 'E';
+	return std::to_chars(end, buf_+32, power-1).ptr;
+}
+
+// Return a scientific notation representation of an input number.
+std::string sciNotation(const float &input_, const size_t &N_/*=2*/){
+	char buf[32];
+	return std::string(buf, sciNotation(buf, input_, N_));
+}
+
+char *formatFloat(char *buf_, const float &input_){
+	return std::to_chars(buf_, buf_+32, input_, std::chars_format::general, 6).ptr;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// class CsvWriter
+///////////////////////////////////////////////////////////////////////////////
+
+CsvWriter::CsvWriter(std::ostream *out_/*=NULL*/, const size_t &size_/*=CSV_BUFFER_SIZE*/) : out(out_), buffer(size_ < CSV_MAX_ROW_LENGTH ? CSV_MAX_ROW_LENGTH : size_), used(0) { }
+
+CsvWriter::~CsvWriter(){
+	flush();
+}
+
+void CsvWriter::setOutput(std::ostream *out_){
+	flush();
+	out = out_;
+}
+
+// Format a data packet as a csv row (without the newline). Return a pointer to the end of the output.
+template <typename Time>
+static char *formatPacket(char *ptr_, char *end_, const Time &timestamp_, const float &temperature_, const float &pressure_, const short &relay1_, const short &relay2_){
+	ptr_ = std::to_chars(ptr_, end_, timestamp_).ptr;
+	*ptr_++ = ',';
+	ptr_ = formatFloat(ptr_, temperature_);
+	*ptr_++ = ',';
+	ptr_ = sciNotation(ptr_, pressure_);
+	*ptr_++ = ',';
+	ptr_ = std::to_chars(ptr_, end_, relay1_).ptr;
+	*ptr_++ = ',';
+	return std::to_chars(ptr_, end_, relay2_).ptr;
+}
+
+void CsvWriter::addPacket(const unsigned int &timestamp_, const float &temperature_, const float &pressure_, const short &relay1_, const short &relay2_){
+	reserve();
+	used = formatPacket(&buffer[used], &buffer[0]+buffer.size(), timestamp_, temperature_, pressure_, relay1_, relay2_)-&buffer[0];
+}
+
+void CsvWriter::addPacket(const uint64_t &timestamp_, const float &temperature_, const float &pressure_, const short &relay1_, const short &relay2_){
+	reserve();
+	used = formatPacket(&buffer[used], &buffer[0]+buffer.size(), timestamp_, temperature_, pressure_, relay1_, relay2_)-&buffer[0];
+}
+
+void CsvWriter::addField(const long long &value_){
+	reserve(32);
+	buffer[used++] = ',';
+	used = std::to_chars(&buffer[used], &buffer[0]+buffer.size(), value_).ptr-&buffer[0];
+}
+
+void CsvWriter::addField(const float &value_){
+	reserve(32);
+	buffer[used++] = ',';
+	used = formatFloat(&buffer[used], value_)-&buffer[0];
+}
+
+void CsvWriter::addText(const char *str_, const size_t &len_){
+	if(used+len_ > buffer.size()){ flush(); }
+	if(len_ > buffer.size()){ // Too large to buffer.
+		if(out){ out->write(str_, len_); }
+		return;
+	}
+	memcpy(&buffer[used], str_, len_);
+	used += len_;
+}
+
+void CsvWriter::endRow(){
+	reserve(1);
+	buffer[used++] = '\n';
+}
+
+void CsvWriter::flush(){
+	if(out && used > 0){ out->write(&buffer[0], used); }
+	used = 0;
+}
+
+void CsvWriter::reserve(const size_t &len_/*=CSV_MAX_ROW_LENGTH*/){
+	if(used+len_ > buffer.size()){ flush(); }
+}
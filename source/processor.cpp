@@ -1,5 +1,7 @@
 #include <iostream>
 #include <vector>
+#include <string.h>
+#include <stdlib.h>
 
 #include "TFile.h"
 #include "TTree.h"
@@ -11,50 +13,67 @@
 #include "TROOT.h"
 #include "TFrame.h"
 
+#include "relayEdges.hpp"
+#include "seriesPyramid.hpp"
+
 #define YMIN 20
 #define YMAX 100
 
+// Default plot width (in pixels).
+#define PLOT_WIDTH 1000
+
 bool processTree(std::vector<double> &vals1, std::vector<double> &vals2, TTree *t_){
 	if(!t_){ return false; }
 	
-	double r1;
-	TBranch *b1;
-	t_->SetBranchAddress("r1", &r1, &b1);
-	
-	double seconds;
-	TBranch *bsec;
-	t_->SetBranchAddress("seconds", &seconds, &bsec);
+	std::cout << " Processing " << t_->GetEntries() << " entries.\n";
 	
-	if(!b1 || !bsec){ return false; }
+	// Read the relay and time branches into contiguous arrays in a single pass.
+	t_->SetEstimate(t_->GetEntries()+1);
+	Long64_t N = t_->Draw("r1:r2:seconds", "", "goff");
+	if(N <= 0){ return false; }
 	
-	std::cout << " Processing " << t_->GetEntries() << " entries.\n";
+	const double *r1 = t_->GetV1();
+	const double *r2 = t_->GetV2();
+	const double *seconds = t_->GetV3();
 	
-	t_->GetEntry(0);
-	bool prev_r1_state = false;
-	if(r1 == 1){
-		vals1.push_back(seconds);
-		std::cout << seconds;
-		prev_r1_state = true;
+	std::vector<short> relay1(N), relay2(N);
+	for(Long64_t i = 0; i < N; i++){
+		relay1[i] = (short)r1[i];
+		relay2[i] = (short)r2[i];
 	}
 	
-	for(int i = 1; i < t_->GetEntries(); i++){
-		t_->GetEntry(i);
-		if(!prev_r1_state && r1 == 1){
-			vals1.push_back(seconds);
-			std::cout << seconds;
-			prev_r1_state = true;
-		}
-		else if(prev_r1_state && r1 == 0){
-			vals2.push_back(seconds);
-			std::cout << "\t" << seconds << std::endl;
-			prev_r1_state = false;
-		}
-	}
+	RelayIntervals intervals1, intervals2;
+	intervals1.add(relay1.data(), seconds, N);
+	intervals2.add(relay2.data(), seconds, N);
+	
+	std::cout << "  Relay 1 on for " << intervals1.getOnTime() << " of " << intervals1.getTotalTime() << " s (" << intervals1.open.size() << " intervals, duty cycle " << 100*intervals1.getDutyCycle() << "%)\n";
+	std::cout << "  Relay 2 on for " << intervals2.getOnTime() << " of " << intervals2.getTotalTime() << " s (" << intervals2.open.size() << " intervals, duty cycle " << 100*intervals2.getDutyCycle() << "%)\n";
+	
+	vals1 = intervals1.open;
+	vals2 = intervals1.close;
 	
 	return (vals1.size() == vals2.size());
 }
 
-void processGraph1(const std::vector<double> &vals1, const std::vector<double> &vals2, TGraph *g_){
+// Replace the points of a time ordered graph with a min/max envelope of at most 2*width_ points.
+void downsample(TGraph *g_, const size_t &width_){
+	if(!g_ || g_->GetN() == 0){ return; }
+
+	MinMaxPyramid pyramid;
+	pyramid.build(g_->GetX(), g_->GetY(), g_->GetN());
+	
+	std::vector<double> x, y;
+	size_t N = pyramid.sample(x, y, width_);
+	
+	std::cout << " Reduced graph '" << g_->GetName() << "' from " << g_->GetN() << " to " << N << " points.\n";
+	
+	g_->Set(N);
+	for(size_t i = 0; i < N; i++){
+		g_->SetPoint(i, x[i], y[i]);
+	}
+}
+
+void processGraph1(const std::vector<double> &vals1, const std::vector<double> &vals2, TGraph *g_, const size_t &width_){
 	if(!g_){ return; }
 
 	TCanvas *can = new TCanvas("can1");
@@ -64,13 +83,18 @@ void processGraph1(const std::vector<double> &vals1, const std::vector<double> &
 	g_->Draw("AL");
 	g_->GetYaxis()->SetRangeUser(YMIN, YMAX);
 	
-	TBox *boxes[vals1.size()];
+	// Merge relay intervals separated by less than one pixel.
+	double pixel = 0;
+	if(g_->GetN() > 1){ pixel = (g_->GetX()[g_->GetN()-1]-g_->GetX()[0])/width_; }
+	
+	std::vector<double> open, close;
+	mergeIntervals(vals1, vals2, pixel, open, close);
 	
-	for(size_t i = 0; i < vals1.size(); i++){
-		boxes[i] = new TBox(vals1[i], YMIN, vals2[i], YMAX);
-		boxes[i]->SetFillColor(9);
-		boxes[i]->SetFillStyle(3002);
-		boxes[i]->Draw("SAME");
+	for(size_t i = 0; i < open.size(); i++){
+		TBox *box = new TBox(open[i], YMIN, close[i], YMAX);
+		box->SetFillColor(9);
+		box->SetFillStyle(3002);
+		box->Draw("SAME");
 	}
 	can->Update();
 	
@@ -94,7 +118,7 @@ void processGraph2(TGraph *g_){
 	can->Close();
 }
 
-void process(TFile *f1, TFile *f2){
+void process(TFile *f1, TFile *f2, const size_t &width_){
 	if(!f1 || !f2){ return; }
 	
 	TTree *tree = (TTree*)f1->Get("data");
@@ -103,6 +127,9 @@ void process(TFile *f1, TFile *f2){
 	
 	if(!tree || !graph1 || !graph2){ return; }
 	
+	downsample(graph1, width_);
+	downsample(graph2, width_);
+	
 	graph1->SetTitle(0);
 	graph1->GetXaxis()->SetTitle("Time (s)");
 	graph1->GetYaxis()->SetTitle("Temperature (C)");
@@ -114,12 +141,14 @@ void process(TFile *f1, TFile *f2){
 	std::vector<double> v1, v2;
 	if(!processTree(v1, v2, tree)){ return; }
 	
-	processGraph1(v1, v2, graph1);
+	processGraph1(v1, v2, graph1, width_);
 	processGraph2(graph2);
 }
 
 void help(char * prog_name_){
-	std::cout << "  SYNTAX: " << prog_name_ << " <dataFile> <graphFile>\n";
+	std::cout << "  SYNTAX: " << prog_name_ << " <dataFile> <graphFile> [options]\n";
+	std::cout << "   Available options:\n";
+	std::cout << "    --width <pixels> | Plot width used to downsample the graphs (default=" << PLOT_WIDTH << ").\n";
 }
 
 int main(int argc, char* argv[]){
@@ -133,6 +162,27 @@ int main(int argc, char* argv[]){
 		return 1;
 	}
 	
+	size_t width = PLOT_WIDTH;
+	
+	int index = 3;
+	while(index < argc){
+		if(strcmp(argv[index], "--width") == 0){
+			if(index + 1 >= argc){
+				std::cout << " Error! Missing required argument to '--width'!\n";
+				help(argv[0]);
+				return 1;
+			}
+			width = strtoul(argv[++index], NULL, 10);
+			if(width == 0){ width = PLOT_WIDTH; }
+		}
+		else{
+			std::cout << " Error! Unrecognized option '" << argv[index] << "'!\n";
+			help(argv[0]);
+			return 1;
+		}
+		index++;
+	}
+	
 	gROOT->SetBatch(1);
 	
 	TFile *dfile = new TFile(argv[1], "READ");
@@ -148,7 +198,7 @@ int main(int argc, char* argv[]){
 		return 1;
 	}
 	
-	process(dfile, gfile);
+	process(dfile, gfile, width);
 	dfile->Close();
 	gfile->Close();
 		
@@ -0,0 +1,111 @@
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "relayEdges.hpp"
+
+///////////////////////////////////////////////////////////////////////////////
+// class RelayTracker
+///////////////////////////////////////////////////////////////////////////////
+
+RelayTracker::RelayTracker() : state(false), first(true), scalar(false), prev(0) { }
+
+bool RelayTracker::haveSIMD(){
+#ifdef __SSE2__
+	return true;
+#else
+	return false;
+#endif
+}
+
+void RelayTracker::reset(){
+	state = false;
+	first = true;
+	prev = 0;
+}
+
+void RelayTracker::restore(const bool &state_, const short &last_){
+	state = state_;
+	first = false;
+	prev = last_;
+}
+
+void RelayTracker::process(const short *relay_, const size_t &N_, std::vector<size_t> &on_, std::vector<size_t> &off_){
+	if(N_ == 0){ return; }
+
+	// The state can only change where a sample differs from the one before it, since the
+	// previous sample has already been applied. The first sample of a run is always checked.
+	if(first || relay_[0] != prev){ update(relay_[0], 0, on_, off_); }
+	first = false;
+
+	size_t i = 1;
+#ifdef __SSE2__
+	if(!scalar){
+		// Compare 8 samples at a time with the same samples shifted by one.
+		for(; i+8 <= N_; i += 8){
+			__m128i curr = _mm_loadu_si128((const __m128i*)(relay_+i));
+			__m128i last = _mm_loadu_si128((const __m128i*)(relay_+i-1));
+			int mask = _mm_movemask_epi8(_mm_cmpeq_epi16(curr, last));
+			if(mask == 0xFFFF){ continue; }
+
+			// Apply each changed sample in order. Each 16-bit lane sets two mask bits.
+			mask = ~mask & 0xFFFF;
+			while(mask){
+				int lane = __builtin_ctz(mask)/2;
+				update(relay_[i+lane], i+lane, on_, off_);
+				mask &= ~(3 << (2*lane));
+			}
+		}
+	}
+#endif
+
+	for(; i < N_; i++){
+		if(relay_[i] != relay_[i-1]){ update(relay_[i], i, on_, off_); }
+	}
+
+	prev = relay_[N_-1];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// class RelayIntervals
+///////////////////////////////////////////////////////////////////////////////
+
+void RelayIntervals::clear(){
+	open.clear();
+	close.clear();
+	tracker.reset();
+	firstTime = 0;
+	lastTime = 0;
+	onTime = 0;
+	numSamples = 0;
+	numPrevious = 0;
+}
+
+void RelayIntervals::save(RelayState &state_) const {
+	memset((char*)&state_, 0, sizeof(RelayState));
+	state_.firstTime = firstTime;
+	state_.lastTime = lastTime;
+	state_.onTime = onTime;
+	state_.openTime = (isOn() ? open.back() : 0);
+	state_.numSamples = numSamples;
+	state_.numIntervals = getNumIntervals();
+	state_.last = tracker.getLast();
+	state_.on = (isOn() ? 1 : 0);
+}
+
+void RelayIntervals::restore(const RelayState &state_){
+	clear();
+	if(state_.numSamples == 0){ return; }
+	firstTime = state_.firstTime;
+	lastTime = state_.lastTime;
+	onTime = state_.onTime;
+	numSamples = state_.numSamples;
+	numPrevious = state_.numIntervals;
+	if(state_.on){
+		open.push_back(state_.openTime);
+		numPrevious--;
+	}
+	tracker.restore(state_.on != 0, state_.last);
+}
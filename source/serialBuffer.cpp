@@ -0,0 +1,76 @@
+#include <string.h>
+#include <unistd.h>
+
+#include "serialBuffer.hpp"
+#include "packetDecoder.hpp"
+
+SerialBuffer::SerialBuffer(const size_t &capacity_/*=SERIAL_BUFFER_SIZE*/) : buffer(capacity_ < PACKET_LENGTH ? PACKET_LENGTH : capacity_), head(0), tail(0), numDiscarded(0) { }
+
+ssize_t SerialBuffer::fill(const int &fd_){
+	if(tail == buffer.size()){ compact(); }
+
+	ssize_t numBytes = read(fd_, &buffer[tail], buffer.size()-tail);
+	if(numBytes > 0){ tail += numBytes; }
+
+	return numBytes;
+}
+
+size_t SerialBuffer::append(const char *data_, const size_t &len_){
+	if(tail+len_ > buffer.size()){ compact(); }
+
+	size_t numBytes = buffer.size()-tail;
+	if(numBytes > len_){ numBytes = len_; }
+	memcpy(&buffer[tail], data_, numBytes);
+	tail += numBytes;
+
+	return numBytes;
+}
+
+const char *SerialBuffer::nextPacket(){
+	const unsigned int delimiter = PACKET_DELIMITER;
+	while(tail-head >= 4){
+		// Search for the first byte of the delimiter.
+		const char *start = &buffer[head];
+		const char *ptr = (const char*)memchr(start, 0xFF, tail-head-3);
+		if(!ptr){ // Keep the last three bytes, they may be the start of a delimiter.
+			numDiscarded += tail-head-3;
+			head = tail-3;
+			break;
+		}
+
+		numDiscarded += ptr-start;
+		head += ptr-start;
+
+		if(memcmp(ptr, (const char*)&delimiter, 4) != 0){ // Not a delimiter.
+			numDiscarded++;
+			head++;
+			continue;
+		}
+
+		if(tail-head < PACKET_LENGTH){ break; } // Wait for the rest of the packet.
+
+		head += PACKET_LENGTH;
+		return ptr;
+	}
+
+	if(head == tail){ head = tail = 0; }
+
+	return NULL;
+}
+
+void SerialBuffer::clear(){
+	head = tail = 0;
+}
+
+void SerialBuffer::compact(){
+	if(head == 0){
+		if(tail == buffer.size()){ // Buffer is full of unusable data.
+			numDiscarded += tail;
+			tail = 0;
+		}
+		return;
+	}
+	memmove(&buffer[0], &buffer[head], tail-head);
+	tail -= head;
+	head = 0;
+}
@@ -0,0 +1,184 @@
+#include <algorithm>
+#include <cmath>
+
+#include "seriesPyramid.hpp"
+
+///////////////////////////////////////////////////////////////////////////////
+// class MinMaxPyramid
+///////////////////////////////////////////////////////////////////////////////
+
+// Return true if the first bucket ends before x_.
+static bool endsBefore(const PyramidBucket &bucket_, const double &x_){
+	return bucket_.xHigh < x_;
+}
+
+// Return true if x_ is before the start of the bucket.
+static bool startsAfter(const double &x_, const PyramidBucket &bucket_){
+	return x_ < bucket_.xLow;
+}
+
+// Add a single sample to a bucket.
+static void addSample(PyramidBucket &bucket_, const double &x_, const double &y_){
+	if(std::isnan(y_)){ return; }
+	if(bucket_.count == 0 || y_ < bucket_.yMin){
+		bucket_.xMin = x_;
+		bucket_.yMin = y_;
+	}
+	if(bucket_.count == 0 || y_ > bucket_.yMax){
+		bucket_.xMax = x_;
+		bucket_.yMax = y_;
+	}
+	bucket_.count++;
+}
+
+// Merge a bucket into the following one.
+static void addBucket(PyramidBucket &bucket_, const PyramidBucket &other_){
+	bucket_.xHigh = other_.xHigh;
+	if(other_.count == 0){ return; }
+	if(bucket_.count == 0 || other_.yMin < bucket_.yMin){
+		bucket_.xMin = other_.xMin;
+		bucket_.yMin = other_.yMin;
+	}
+	if(bucket_.count == 0 || other_.yMax > bucket_.yMax){
+		bucket_.xMax = other_.xMax;
+		bucket_.yMax = other_.yMax;
+	}
+	bucket_.count += other_.count;
+}
+
+MinMaxPyramid::MinMaxPyramid(const size_t &baseSize_/*=PYRAMID_BASE_SIZE*/) : baseSize(baseSize_ > 0 ? baseSize_ : PYRAMID_BASE_SIZE), numSamples(0), xdata(NULL), ydata(NULL) { }
+
+void MinMaxPyramid::build(const double *x_, const double *y_, const size_t &N_){
+	clear();
+	if(!x_ || !y_ || N_ == 0){ return; }
+
+	xdata = x_;
+	ydata = y_;
+	numSamples = N_;
+
+	// Build the finest level directly from the series.
+	levels.push_back(std::vector<PyramidBucket>());
+	levels.back().reserve((N_+baseSize-1)/baseSize);
+	for(size_t i = 0; i < N_; i += baseSize){
+		size_t stop = std::min(i+baseSize, N_);
+		PyramidBucket bucket;
+		bucket.xLow = x_[i];
+		bucket.xHigh = x_[stop-1];
+		bucket.xMin = bucket.xMax = x_[i];
+		bucket.yMin = bucket.yMax = 0;
+		bucket.count = 0;
+		for(size_t j = i; j < stop; j++){
+			addSample(bucket, x_[j], y_[j]);
+		}
+		levels.back().push_back(bucket);
+	}
+
+	// Each coarser level merges pairs of buckets from the level below it.
+	while(levels.back().size() > 1){
+		const std::vector<PyramidBucket> &prev = levels.back();
+		std::vector<PyramidBucket> level;
+		level.reserve((prev.size()+1)/2);
+		for(size_t i = 0; i < prev.size(); i += 2){
+			level.push_back(prev[i]);
+			if(i+1 < prev.size()){ addBucket(level.back(), prev[i+1]); }
+		}
+		levels.push_back(level);
+	}
+}
+
+void MinMaxPyramid::clear(){
+	levels.clear();
+	numSamples = 0;
+	xdata = NULL;
+	ydata = NULL;
+}
+
+size_t MinMaxPyramid::findRange(const std::vector<PyramidBucket> &level_, const double &xLow_, const double &xHigh_, size_t &first_) const {
+	std::vector<PyramidBucket>::const_iterator first = std::lower_bound(level_.begin(), level_.end(), xLow_, endsBefore);
+	std::vector<PyramidBucket>::const_iterator last = std::upper_bound(first, level_.end(), xHigh_, startsAfter);
+	first_ = first-level_.begin();
+	return last-first;
+}
+
+int MinMaxPyramid::getBestLevel(const size_t &width_, const double &xLow_, const double &xHigh_) const {
+	if(numSamples == 0){ return -1; }
+
+	// Use the raw series if it is already small enough.
+	size_t numRaw = std::upper_bound(xdata, xdata+numSamples, xHigh_)-std::lower_bound(xdata, xdata+numSamples, xLow_);
+	if(numRaw <= 2*width_){ return -1; }
+
+	// Find the finest level with at most one bucket per pixel.
+	size_t first;
+	for(size_t i = 0; i < levels.size(); i++){
+		if(findRange(levels[i], xLow_, xHigh_, first) <= width_){ return i; }
+	}
+
+	return levels.size()-1;
+}
+
+size_t MinMaxPyramid::sample(std::vector<double> &x_, std::vector<double> &y_, const size_t &width_, const double &xLow_, const double &xHigh_) const {
+	x_.clear();
+	y_.clear();
+
+	int level = getBestLevel(width_, xLow_, xHigh_);
+	if(level < 0){
+		for(size_t i = std::lower_bound(xdata, xdata+numSamples, xLow_)-xdata; i < numSamples && xdata[i] <= xHigh_; i++){
+			if(std::isnan(ydata[i])){ continue; }
+			x_.push_back(xdata[i]);
+			y_.push_back(ydata[i]);
+		}
+		return x_.size();
+	}
+
+	size_t first;
+	size_t count = findRange(levels[level], xLow_, xHigh_, first);
+	x_.reserve(2*count);
+	y_.reserve(2*count);
+	for(size_t i = first; i < first+count; i++){
+		const PyramidBucket &bucket = levels[level][i];
+		if(bucket.count == 0){ continue; }
+
+		// Add the minimum and maximum in time order.
+		if(bucket.xMin <= bucket.xMax){
+			x_.push_back(bucket.xMin);
+			y_.push_back(bucket.yMin);
+			if(bucket.xMax != bucket.xMin){
+				x_.push_back(bucket.xMax);
+				y_.push_back(bucket.yMax);
+			}
+		}
+		else{
+			x_.push_back(bucket.xMax);
+			y_.push_back(bucket.yMax);
+			x_.push_back(bucket.xMin);
+			y_.push_back(bucket.yMin);
+		}
+	}
+
+	return x_.size();
+}
+
+size_t MinMaxPyramid::sample(std::vector<double> &x_, std::vector<double> &y_, const size_t &width_) const {
+	return sample(x_, y_, width_, -INFINITY, INFINITY);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Relay intervals
+///////////////////////////////////////////////////////////////////////////////
+
+size_t mergeIntervals(const std::vector<double> &open_, const std::vector<double> &close_, const double &minGap_, std::vector<double> &mergedOpen_, std::vector<double> &mergedClose_){
+	mergedOpen_.clear();
+	mergedClose_.clear();
+
+	size_t N = std::min(open_.size(), close_.size());
+	for(size_t i = 0; i < N; i++){
+		if(!mergedOpen_.empty() && open_[i]-mergedClose_.back() < minGap_){
+			mergedClose_.back() = std::max(mergedClose_.back(), close_[i]);
+			continue;
+		}
+		mergedOpen_.push_back(open_[i]);
+		mergedClose_.push_back(close_[i]);
+	}
+
+	return mergedOpen_.size();
+}
@@ -0,0 +1,45 @@
+#include "stageTiming.hpp"
+
+const char *getTimingStageName(const unsigned int &stage_){
+	static const char *names[FRAME_TIMING_STAGES] = {"pressure", "thermo", "relays", "log", "serial", "sd", "loop", "late"};
+	return (stage_ < FRAME_TIMING_STAGES ? names[stage_] : "unknown");
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// class StageTiming
+///////////////////////////////////////////////////////////////////////////////
+
+StageTiming::StageTiming() : numRecords(0) {
+}
+
+void StageTiming::add(const TimingRecord &record_){
+	for(unsigned int i = 0; i < FRAME_TIMING_STAGES; i++){
+		stages[i].fill(record_.stages[i]);
+	}
+	numRecords++;
+}
+
+void StageTiming::add(const std::vector<TimingRecord> &records_){
+	for(std::vector<TimingRecord>::const_iterator iter = records_.begin(); iter != records_.end(); iter++){
+		add(*iter);
+	}
+}
+
+void StageTiming::clear(){
+	for(unsigned int i = 0; i < FRAME_TIMING_STAGES; i++){
+		stages[i].clear();
+	}
+	numRecords = 0;
+}
+
+void StageTiming::print(std::ostream &out_/*=std::cout*/, const std::string &prefix_/*="  "*/) const {
+	if(numRecords == 0){
+		out_ << prefix_ << "No entries.\n";
+		return;
+	}
+
+	for(unsigned int i = 0; i < FRAME_TIMING_STAGES; i++){
+		out_ << prefix_ << getTimingStageName(i) << ":\n";
+		stages[i].print(out_, prefix_+" ");
+	}
+}
@@ -0,0 +1,131 @@
+#include <iostream>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <signal.h>
+#include <stdexcept>
+
+#include "telemetryRing.hpp"
+#include "packetFormat.hpp"
+
+// Default time to sleep while waiting for new samples (us).
+#define DEFAULT_POLL 1000
+
+// Time between checks that the writer is still running while no samples arrive (ms).
+#define WRITER_CHECK_PERIOD 1000
+
+bool SIGNAL_INTERRUPT = false;
+
+void sig_int_handler(int ignore_){
+	SIGNAL_INTERRUPT = true;
+}
+
+// Setup the interrupt signal intercept
+void setup_signal_handlers(){
+	// Handle ctrl-c press (SIGINT)
+	if(signal(SIGINT, SIG_IGN) != SIG_IGN){
+		if(signal(SIGINT, sig_int_handler) == SIG_ERR){
+			throw std::runtime_error(" Error setting up SIGINT signal handler!");
+		}
+	}
+}
+
+void help(char * prog_name_){
+	std::cout << "  SYNTAX: " << prog_name_ << " [name] [options]\n";
+	std::cout << "   Read live packets published by loggerUnpacker or ovenDaemon (default name=" << TELEMETRY_DEFAULT_NAME << ").\n";
+	std::cout << "   Available options:\n";
+	std::cout << "    --all          | Start with the oldest sample still in the ring instead of the next new sample.\n";
+	std::cout << "    --csv          | Print samples to stdout as csv rows.\n";
+	std::cout << "    --count <num>  | Stop after reading num samples.\n";
+	std::cout << "    --poll <us>    | Time to sleep while waiting for new samples (default=" << DEFAULT_POLL << ").\n";
+}
+
+int main(int argc, char* argv[]){
+	std::string name = TELEMETRY_DEFAULT_NAME;
+	bool fromStart = false;
+	bool csvMode = false;
+	long maxCount = -1;
+	int poll = DEFAULT_POLL;
+
+	int index = 1;
+	while(index < argc){
+		if(strcmp(argv[index], "-h") == 0 || strcmp(argv[index], "--help") == 0){
+			help(argv[0]);
+			return 0;
+		}
+		else if(strcmp(argv[index], "--all") == 0){
+			fromStart = true;
+		}
+		else if(strcmp(argv[index], "--csv") == 0){
+			csvMode = true;
+		}
+		else if(strcmp(argv[index], "--count") == 0 || strcmp(argv[index], "--poll") == 0){
+			if(index + 1 >= argc){
+				std::cout << " Error! Missing required argument to '" << argv[index] << "'!\n";
+				help(argv[0]);
+				return 1;
+			}
+			if(strcmp(argv[index], "--count") == 0){ maxCount = atol(argv[++index]); }
+			else{ poll = atoi(argv[++index]); }
+		}
+		else if(argv[index][0] == '-'){
+			std::cout << " Error! Unrecognized option '" << argv[index] << "'!\n";
+			help(argv[0]);
+			return 1;
+		}
+		else{ name = argv[index]; }
+		index++;
+	}
+
+	TelemetryReader reader;
+	if(!reader.open(name, fromStart)){
+		std::cout << " ERROR: Failed to open telemetry ring '" << getTelemetryName(name) << "'!\n";
+		return 1;
+	}
+	if(!csvMode){
+		std::cout << " Opened telemetry ring '" << getTelemetryName(name) << "' (" << reader.getCapacity() << " samples)";
+		if(reader.getTitle()[0] != '\0'){ std::cout << ", title: " << reader.getTitle(); }
+		std::cout << std::endl;
+	}
+	else{ std::cout << "time(ms),T(C),P(Torr),R1,R2,host(ms)\n"; }
+
+	setup_signal_handlers();
+
+	TelemetrySample sample;
+	long idleTime = 0;
+	while(!SIGNAL_INTERRUPT && (maxCount < 0 || (long)reader.getNumRead() < maxCount)){
+		TelemetryStatus status = reader.read(sample);
+		if(status == TELEMETRY_CLOSED){
+			if(!csvMode){ std::cout << "\n Writer closed the telemetry ring."; }
+			break;
+		}
+		else if(status == TELEMETRY_NONE){
+			// A writer which crashed can not mark the ring as closed.
+			idleTime += poll;
+			if(idleTime >= 1000L*WRITER_CHECK_PERIOD){
+				if(!reader.isWriterAlive()){
+					if(!csvMode){ std::cout << "\n Writer is no longer running."; }
+					break;
+				}
+				idleTime = 0;
+			}
+			usleep(poll);
+			continue;
+		}
+		idleTime = 0;
+
+		if(csvMode){
+			std::cout << sample.timestamp << "," << sample.temperature << "," << sample.pressure << "," << sample.relay1 << "," << sample.relay2 << "," << sample.hostTime << "\n";
+		}
+		else{
+			std::cout << " time = " << sample.timestamp/1000 << " s, temp = " << sample.temperature << " C, pres = ";
+			std::cout << sciNotation(sample.pressure) << " Torr, R1 = " << sample.relay1 << ", R2 = " << sample.relay2 << "\r" << std::flush;
+		}
+	}
+
+	if(!csvMode){ std::cout << "\n Done! Read " << reader.getNumRead() << " samples, lost " << reader.getNumLost() << " samples.\n"; }
+	else{ std::cout << std::flush; }
+
+	return 0;
+}
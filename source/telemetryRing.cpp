@@ -0,0 +1,207 @@
+#include <string.h>
+#include <signal.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "telemetryRing.hpp"
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "Telemetry rings require lock-free 64-bit atomics");
+
+std::string getTelemetryName(const std::string &name_){
+	if(!name_.empty() && name_[0] == '/'){ return name_; }
+	return "/" + name_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// class TelemetryWriter
+///////////////////////////////////////////////////////////////////////////////
+
+TelemetryWriter::TelemetryWriter() : header(NULL), slots(NULL), mappedSize(0), writeIndex(0), mask(0) { }
+
+TelemetryWriter::~TelemetryWriter(){
+	close();
+}
+
+bool TelemetryWriter::open(const std::string &name_, const uint32_t &capacity_/*=TELEMETRY_DEFAULT_CAPACITY*/, const char *title_/*=NULL*/){
+	close();
+
+	uint32_t capacity = 1;
+	while(capacity < capacity_ && capacity < 0x80000000){ capacity <<= 1; }
+
+	// Replace any existing ring. Readers of the old ring keep their mapping until they close it.
+	name = getTelemetryName(name_);
+	shm_unlink(name.c_str());
+	int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+	if(fd < 0){ return false; }
+
+	mappedSize = sizeof(TelemetryHeader)+capacity*sizeof(TelemetrySlot);
+	void *ptr = MAP_FAILED;
+	if(ftruncate(fd, mappedSize) == 0){
+		ptr = mmap(NULL, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	}
+	::close(fd);
+	if(ptr == MAP_FAILED){
+		shm_unlink(name.c_str());
+		return false;
+	}
+
+	// The new object is zero filled, so every slot starts out empty.
+	header = (TelemetryHeader*)ptr;
+	slots = (TelemetrySlot*)((char*)ptr+sizeof(TelemetryHeader));
+	header->version = TELEMETRY_VERSION;
+	header->capacity = capacity;
+	header->sampleSize = sizeof(TelemetrySample);
+	header->writerPid = getpid();
+	if(title_){ strncpy(header->title, title_, sizeof(header->title)-1); }
+
+	// Readers only accept the ring once the magic is visible.
+	std::atomic_thread_fence(std::memory_order_release);
+	memcpy(header->magic, TELEMETRY_MAGIC, 8);
+
+	writeIndex = 0;
+	mask = capacity-1;
+
+	return true;
+}
+
+void TelemetryWriter::publish(const TelemetrySample &sample_){
+	if(!header){ return; }
+
+	uint64_t words[3];
+	memcpy((char*)words, (const char*)&sample_, sizeof(TelemetrySample));
+
+	// Mark the slot as being written before touching the sample.
+	TelemetrySlot &slot = slots[writeIndex & mask];
+	slot.sequence.store(2*writeIndex+1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	slot.words[0].store(words[0], std::memory_order_relaxed);
+	slot.words[1].store(words[1], std::memory_order_relaxed);
+	slot.words[2].store(words[2], std::memory_order_relaxed);
+	slot.sequence.store(2*writeIndex+2, std::memory_order_release);
+
+	header->writeIndex.store(++writeIndex, std::memory_order_release);
+}
+
+void TelemetryWriter::publish(const uint64_t &hostTime_, const unsigned int &timestamp_, const float &temperature_, const float &pressure_, const short &relay1_, const short &relay2_){
+	TelemetrySample sample;
+	sample.hostTime = hostTime_;
+	sample.timestamp = timestamp_;
+	sample.temperature = temperature_;
+	sample.pressure = pressure_;
+	sample.relay1 = relay1_;
+	sample.relay2 = relay2_;
+	publish(sample);
+}
+
+void TelemetryWriter::close(){
+	if(!header){ return; }
+	header->closed.store(1, std::memory_order_release);
+	munmap((void*)header, mappedSize);
+	shm_unlink(name.c_str());
+	header = NULL;
+	slots = NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// class TelemetryReader
+///////////////////////////////////////////////////////////////////////////////
+
+TelemetryReader::TelemetryReader() : header(NULL), slots(NULL), mappedSize(0), readIndex(0), mask(0), numLost(0), numRead(0) { }
+
+TelemetryReader::~TelemetryReader(){
+	close();
+}
+
+bool TelemetryReader::open(const std::string &name_, const bool &fromStart_/*=false*/){
+	close();
+
+	int fd = shm_open(getTelemetryName(name_).c_str(), O_RDONLY, 0);
+	if(fd < 0){ return false; }
+
+	struct stat info;
+	void *ptr = MAP_FAILED;
+	if(fstat(fd, &info) == 0 && (size_t)info.st_size >= sizeof(TelemetryHeader)){
+		mappedSize = info.st_size;
+		ptr = mmap(NULL, mappedSize, PROT_READ, MAP_SHARED, fd, 0);
+	}
+	::close(fd);
+	if(ptr == MAP_FAILED){ return false; }
+
+	// Check that the ring is complete and matches this version of the layout.
+	header = (TelemetryHeader*)ptr;
+	bool valid = (memcmp(header->magic, TELEMETRY_MAGIC, 8) == 0);
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if(!valid || header->version != TELEMETRY_VERSION || header->sampleSize != sizeof(TelemetrySample) || header->capacity == 0 ||
+	   (header->capacity & (header->capacity-1)) != 0 || mappedSize < sizeof(TelemetryHeader)+header->capacity*sizeof(TelemetrySlot)){
+		close();
+		return false;
+	}
+
+	slots = (TelemetrySlot*)((char*)ptr+sizeof(TelemetryHeader));
+	mask = header->capacity-1;
+	readIndex = header->writeIndex.load(std::memory_order_acquire);
+	if(fromStart_){ readIndex = (readIndex > header->capacity ? readIndex-header->capacity : 0); }
+	numLost = 0;
+	numRead = 0;
+
+	return true;
+}
+
+TelemetryStatus TelemetryReader::read(TelemetrySample &sample_){
+	if(!header){ return TELEMETRY_CLOSED; }
+
+	while(true){
+		// Check the closed flag first, so that no samples published before closing are missed.
+		bool closed = (header->closed.load(std::memory_order_acquire) != 0);
+		uint64_t head = header->writeIndex.load(std::memory_order_acquire);
+		if(readIndex >= head){ return (closed ? TELEMETRY_CLOSED : TELEMETRY_NONE); }
+
+		// Skip ahead to the oldest sample still in the ring.
+		if(head-readIndex > header->capacity){
+			numLost += head-header->capacity-readIndex;
+			readIndex = head-header->capacity;
+		}
+
+		const TelemetrySlot &slot = slots[readIndex & mask];
+		const uint64_t expected = 2*readIndex+2;
+		uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+		if(sequence == expected){
+			uint64_t words[3];
+			words[0] = slot.words[0].load(std::memory_order_relaxed);
+			words[1] = slot.words[1].load(std::memory_order_relaxed);
+			words[2] = slot.words[2].load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if(slot.sequence.load(std::memory_order_relaxed) == expected){ // Not modified while copying.
+				memcpy((char*)&sample_, (const char*)words, sizeof(TelemetrySample));
+				readIndex++;
+				numRead++;
+				return TELEMETRY_SAMPLE;
+			}
+		}
+
+		// The writer lapped this reader and the sample was overwritten.
+		numLost++;
+		readIndex++;
+	}
+}
+
+uint64_t TelemetryReader::getNumAvailable() const {
+	if(!header){ return 0; }
+	uint64_t head = header->writeIndex.load(std::memory_order_acquire);
+	return (head > readIndex ? head-readIndex : 0);
+}
+
+bool TelemetryReader::isWriterAlive() const {
+	if(!header){ return false; }
+	return (kill(header->writerPid, 0) == 0 || errno == EPERM);
+}
+
+void TelemetryReader::close(){
+	if(!header){ return; }
+	munmap((void*)header, mappedSize);
+	header = NULL;
+	slots = NULL;
+}
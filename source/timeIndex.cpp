@@ -0,0 +1,111 @@
+#include <fstream>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "timeIndex.hpp"
+#include "packetDecoder.hpp"
+
+// Get the size and modification time of a file. Return false if the file does not exist.
+static bool getFileStats(const std::string &fname_, uint64_t &size_, int64_t &time_){
+	struct stat info;
+	if(stat(fname_.c_str(), &info) != 0){ return false; }
+	size_ = info.st_size;
+	time_ = info.st_mtime;
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// class TimeIndex
+///////////////////////////////////////////////////////////////////////////////
+
+TimeIndex::TimeIndex(const size_t &stride_/*=TIME_INDEX_STRIDE*/){
+	memset((char*)&header, 0, sizeof(TimeIndexHeader));
+	header.stride = (stride_ > 0 ? stride_ : TIME_INDEX_STRIDE);
+}
+
+void TimeIndex::build(const char *data_, const size_t &size_, const size_t &offset_){
+	uint32_t stride = header.stride;
+	memset((char*)&header, 0, sizeof(TimeIndexHeader));
+	strncpy(header.magic, TIME_INDEX_MAGIC, 8);
+	header.version = TIME_INDEX_VERSION;
+	header.stride = stride;
+	header.dataOffset = offset_;
+	header.monotonic = 1;
+	entries.clear();
+
+	BatchDecoder decoder(data_, size_, offset_);
+	PacketColumns cols;
+	cols.reserve(stride);
+
+	unsigned int last = 0;
+	while(!decoder.eof()){
+		TimeIndexEntry entry;
+		entry.offset = decoder.getOffset();
+		entry.reserved = 0;
+
+		cols.clear();
+		if(decoder.decode(cols, stride) == 0){ break; }
+		entry.timestamp = cols.timestamp[0];
+
+		// The first packet of the file is usually junk, so it is never used for searching.
+		for(size_t i = (header.numRecords == 0 ? 1 : 0); i < cols.size(); i++){
+			if(cols.timestamp[i] < last){ header.monotonic = 0; }
+			last = cols.timestamp[i];
+		}
+
+		if(header.numRecords > 0){ entries.push_back(entry); }
+		header.numRecords += cols.size();
+	}
+	header.numEntries = entries.size();
+}
+
+bool TimeIndex::load(const std::string &fname_, const std::string &datname_){
+	std::ifstream file(fname_.c_str(), std::ios::binary);
+	if(!file.is_open()){ return false; }
+
+	TimeIndexHeader temp;
+	if(!file.read((char*)&temp, sizeof(TimeIndexHeader))){ return false; }
+	if(strncmp(temp.magic, TIME_INDEX_MAGIC, 8) != 0 || temp.version != TIME_INDEX_VERSION){ return false; }
+
+	// Make sure the DAT file has not changed since the index was written.
+	uint64_t fileSize;
+	int64_t fileTime;
+	if(!getFileStats(datname_, fileSize, fileTime) || fileSize != temp.fileSize || fileTime != temp.fileTime){ return false; }
+
+	std::vector<TimeIndexEntry> temp_entries(temp.numEntries);
+	if(temp.numEntries > 0 && !file.read((char*)&temp_entries[0], temp.numEntries*sizeof(TimeIndexEntry))){ return false; }
+
+	header = temp;
+	entries.swap(temp_entries);
+
+	return true;
+}
+
+bool TimeIndex::save(const std::string &fname_, const std::string &datname_){
+	if(!getFileStats(datname_, header.fileSize, header.fileTime)){ return false; }
+
+	std::ofstream file(fname_.c_str(), std::ios::binary | std::ios::trunc);
+	if(!file.is_open()){ return false; }
+
+	file.write((const char*)&header, sizeof(TimeIndexHeader));
+	if(!entries.empty()){ file.write((const char*)&entries[0], entries.size()*sizeof(TimeIndexEntry)); }
+	file.close();
+
+	return !file.fail();
+}
+
+size_t TimeIndex::find(const unsigned int &time_) const {
+	if(!isMonotonic() || entries.empty()){ return header.dataOffset; }
+
+	// Find the last block which starts before the requested time. Every packet
+	// before that block is then known to be earlier than the requested time.
+	size_t low = 0;
+	size_t high = entries.size();
+	while(low < high){
+		size_t mid = (low+high)/2;
+		if(entries[mid].timestamp < time_){ low = mid+1; }
+		else{ high = mid; }
+	}
+
+	return (low > 0 ? entries[low-1].offset : header.dataOffset);
+}
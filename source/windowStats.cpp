@@ -0,0 +1,227 @@
+#include <stdio.h>
+#include <cmath>
+
+#include "windowStats.hpp"
+
+///////////////////////////////////////////////////////////////////////////////
+// class RunningStats
+///////////////////////////////////////////////////////////////////////////////
+
+void RunningStats::clear(){
+	count = 0;
+	mean = 0;
+	m2 = 0;
+	min = INFINITY;
+	max = -INFINITY;
+}
+
+void RunningStats::merge(const RunningStats &other_){
+	if(other_.count == 0){ return; }
+	if(count == 0){
+		*this = other_;
+		return;
+	}
+
+	const double n = (double)count+other_.count;
+	const double delta = other_.mean-mean;
+	mean += delta*other_.count/n;
+	m2 += other_.m2+delta*delta*((double)count*other_.count/n);
+	count += other_.count;
+	if(other_.min < min){ min = other_.min; }
+	if(other_.max > max){ max = other_.max; }
+}
+
+double RunningStats::getMin() const {
+	return (count > 0 ? min : NAN);
+}
+
+double RunningStats::getMax() const {
+	return (count > 0 ? max : NAN);
+}
+
+double RunningStats::getMean() const {
+	return (count > 0 ? mean : NAN);
+}
+
+double RunningStats::getStdDev() const {
+	return std::sqrt(getVariance());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// struct WindowSummary
+///////////////////////////////////////////////////////////////////////////////
+
+void WindowSummary::clear(){
+	start = 0;
+	end = 0;
+	temperature.clear();
+	pressure.clear();
+	duration = 0;
+	relay1On = 0;
+	relay2On = 0;
+	overTemp = 0;
+}
+
+void WindowSummary::merge(const WindowSummary &other_){
+	temperature.merge(other_.temperature);
+	pressure.merge(other_.pressure);
+	duration += other_.duration;
+	relay1On += other_.relay1On;
+	relay2On += other_.relay2On;
+	overTemp += other_.overTemp;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// class WindowStats
+///////////////////////////////////////////////////////////////////////////////
+
+WindowStats::WindowStats() : slideLength(1000*STATS_WINDOW), numPanes(1), maxTemp(STATS_MAX_TEMP), numPackets(0), output(NULL), numWindows(0) {
+	reset();
+}
+
+bool WindowStats::setWindow(const double &window_, const double &slide_/*=0*/){
+	const double slide = (slide_ > 0 ? slide_ : window_);
+	if(!(window_ > 0) || slide > window_){ return false; }
+
+	// Both lengths are rounded to whole milliseconds.
+	const uint64_t window = (uint64_t)std::llround(1000*window_);
+	slideLength = (uint64_t)std::llround(1000*slide);
+	if(slideLength == 0 || window % slideLength != 0){ return false; }
+
+	numPanes = window/slideLength;
+	reset();
+
+	return true;
+}
+
+void WindowStats::setOutput(std::ostream *output_){
+	output = output_;
+	if(output){ writeHeader(*output); }
+}
+
+void WindowStats::add(const uint64_t &time_, const float &temperature_, const float &pressure_, const short &relay1_, const short &relay2_){
+	// The time since the last packet is assigned to the state of the last packet.
+	if(haveLast && time_ >= lastTime && time_-lastTime <= STATS_MAX_GAP){
+		const uint64_t dt = time_-lastTime;
+		WindowSummary &pane = panes[currentPane % numPanes];
+		pane.duration += dt;
+		total.duration += dt;
+		if(lastRelay1){
+			pane.relay1On += dt;
+			total.relay1On += dt;
+		}
+		if(lastRelay2){
+			pane.relay2On += dt;
+			total.relay2On += dt;
+		}
+		if(lastOver){
+			pane.overTemp += dt;
+			total.overTemp += dt;
+		}
+	}
+
+	const uint64_t index = time_/slideLength;
+	if(haveLast && time_ < lastTime){ // The controller was reset, so start a new set of windows.
+		flush();
+		reset();
+	}
+
+	if(!haveLast){
+		currentPane = index;
+		panes[index % numPanes].clear();
+		panes[index % numPanes].start = index*slideLength;
+	}
+	else if(index > currentPane){
+		emit(currentPane);
+
+		// After a gap, write the windows which end on the empty panes but still contain earlier packets.
+		for(uint64_t pane = currentPane+1; pane < index && pane < currentPane+numPanes; pane++){
+			panes[pane % numPanes].clear();
+			panes[pane % numPanes].start = pane*slideLength;
+			emit(pane);
+		}
+
+		currentPane = index;
+		panes[index % numPanes].clear();
+		panes[index % numPanes].start = index*slideLength;
+	}
+
+	WindowSummary &pane = panes[index % numPanes];
+	pane.temperature.add(temperature_);
+	pane.pressure.add(pressure_);
+	total.temperature.add(temperature_);
+	total.pressure.add(pressure_);
+	if(numPackets++ == 0){ total.start = time_; }
+	total.end = time_;
+
+	lastTime = time_;
+	lastRelay1 = relay1_;
+	lastRelay2 = relay2_;
+	lastOver = (temperature_ > maxTemp);
+	haveLast = true;
+}
+
+void WindowStats::flush(){
+	if(haveLast){ emit(currentPane); }
+}
+
+void WindowStats::print(std::ostream &out_/*=std::cout*/, const std::string &prefix_/*="  "*/) const {
+	if(numPackets == 0){
+		out_ << prefix_ << "No entries.\n";
+		return;
+	}
+
+	char line[256];
+	snprintf(line, 256, "T: mean=%.3f C, std=%.3f C, min=%.2f C, max=%.2f C\n", total.temperature.getMean(), total.temperature.getStdDev(), total.temperature.getMin(), total.temperature.getMax());
+	out_ << prefix_ << line;
+	snprintf(line, 256, "P: mean=%.3e Torr, std=%.3e Torr, min=%.3e Torr, max=%.3e Torr\n", total.pressure.getMean(), total.pressure.getStdDev(), total.pressure.getMin(), total.pressure.getMax());
+	out_ << prefix_ << line;
+	snprintf(line, 256, "R1 duty cycle %.2f%%, R2 duty cycle %.2f%%, above %g C for %.1f of %.1f s\n", 100*total.getDutyCycle1(), 100*total.getDutyCycle2(), maxTemp, total.overTemp/1000.0, total.duration/1000.0);
+	out_ << prefix_ << line;
+}
+
+void WindowStats::write(std::ostream &output_, const WindowSummary &window_){
+	char line[256];
+	snprintf(line, 256, "%.10g\t%.10g\t%lu\t%.2f\t%.2f\t%.3f\t%.3f\t%.3e\t%.3e\t%.3e\t%.3e\t%.2f\t%.2f\t%.1f\n", window_.start/1000.0, window_.end/1000.0,
+	         (unsigned long)window_.temperature.getCount(), window_.temperature.getMin(), window_.temperature.getMax(), window_.temperature.getMean(), window_.temperature.getStdDev(),
+	         window_.pressure.getMin(), window_.pressure.getMax(), window_.pressure.getMean(), window_.pressure.getStdDev(),
+	         100*window_.getDutyCycle1(), 100*window_.getDutyCycle2(), window_.overTemp/1000.0);
+	output_ << line;
+}
+
+void WindowStats::writeHeader(std::ostream &output_){
+	output_ << "start(s)\tend(s)\tN\tTmin(C)\tTmax(C)\tTmean(C)\tTstd(C)\tPmin(Torr)\tPmax(Torr)\tPmean(Torr)\tPstd(Torr)\tR1(%)\tR2(%)\tTover(s)\n";
+}
+
+void WindowStats::emit(const uint64_t &pane_){
+	WindowSummary window;
+	const uint64_t first = (pane_+1 > numPanes ? pane_+1-numPanes : 0);
+	window.start = first*slideLength;
+	window.end = (pane_+1)*slideLength;
+
+	// Panes which were skipped or belong to an earlier run still hold a different start time.
+	for(uint64_t pane = first; pane <= pane_; pane++){
+		const WindowSummary &summary = panes[pane % numPanes];
+		if(summary.start == pane*slideLength){ window.merge(summary); }
+	}
+
+	numWindows++;
+	if(output){
+		write(*output, window);
+		output->flush();
+	}
+}
+
+void WindowStats::reset(){
+	panes.assign(numPanes, WindowSummary());
+
+	// Mark every pane as unused.
+	for(size_t i = 0; i < numPanes; i++){ panes[i].start = UINT64_MAX; }
+
+	currentPane = 0;
+	lastTime = 0;
+	lastRelay1 = 0;
+	lastRelay2 = 0;
+	lastOver = false;
+	haveLast = false;
+}
@@ -28,49 +28,93 @@
 #include <termios.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <poll.h>
+#include <errno.h>
 #include <sys/ioctl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 
 #include "wiringSerial.h"
 
+#ifdef __linux__
+/*
+ * The Linux termios2 interface (see <asm/termbits.h>, which can not be
+ *	included along with <termios.h>) sets any baud rate with BOTHER.
+ */
+
+struct termios2
+{
+  tcflag_t c_iflag ;
+  tcflag_t c_oflag ;
+  tcflag_t c_cflag ;
+  tcflag_t c_lflag ;
+  cc_t     c_line ;
+  cc_t     c_cc [19] ;
+  speed_t  c_ispeed ;
+  speed_t  c_ospeed ;
+} ;
+
+#ifndef BOTHER
+#define BOTHER 0010000
+#endif
+
+#ifndef IBSHIFT
+#define IBSHIFT 16
+#endif
+#endif
+
+
+/*
+ * serialGetSpeed:
+ *	Return the termios speed constant for a standard baud rate, or B0 if
+ *	there is none.
+ *********************************************************************************
+ */
+
+static speed_t serialGetSpeed (const int baud)
+{
+  switch (baud)
+  {
+    case     50:	return     B50 ;
+    case     75:	return     B75 ;
+    case    110:	return    B110 ;
+    case    134:	return    B134 ;
+    case    150:	return    B150 ;
+    case    200:	return    B200 ;
+    case    300:	return    B300 ;
+    case    600:	return    B600 ;
+    case   1200:	return   B1200 ;
+    case   1800:	return   B1800 ;
+    case   2400:	return   B2400 ;
+    case   4800:	return   B4800 ;
+    case   9600:	return   B9600 ;
+    case  19200:	return  B19200 ;
+    case  38400:	return  B38400 ;
+    case  57600:	return  B57600 ;
+    case 115200:	return B115200 ;
+    case 230400:	return B230400 ;
+
+    default:
+      return B0 ;
+  }
+}
+
+
 /*
  * serialOpen:
  *	Open and initialise the serial port, setting all the right
  *	port parameters - or as many as are required - hopefully!
+ *	Any baud rate may be used on Linux (see serialSetBaud).
  *********************************************************************************
  */
 
 int serialOpen (const char *device, const int baud)
 {
   struct termios options ;
-  speed_t myBaud ;
   int     status, fd ;
 
-  switch (baud)
-  {
-    case     50:	myBaud =     B50 ; break ;
-    case     75:	myBaud =     B75 ; break ;
-    case    110:	myBaud =    B110 ; break ;
-    case    134:	myBaud =    B134 ; break ;
-    case    150:	myBaud =    B150 ; break ;
-    case    200:	myBaud =    B200 ; break ;
-    case    300:	myBaud =    B300 ; break ;
-    case    600:	myBaud =    B600 ; break ;
-    case   1200:	myBaud =   B1200 ; break ;
-    case   1800:	myBaud =   B1800 ; break ;
-    case   2400:	myBaud =   B2400 ; break ;
-    case   4800:	myBaud =   B4800 ; break ;
-    case   9600:	myBaud =   B9600 ; break ;
-    case  19200:	myBaud =  B19200 ; break ;
-    case  38400:	myBaud =  B38400 ; break ;
-    case  57600:	myBaud =  B57600 ; break ;
-    case 115200:	myBaud = B115200 ; break ;
-    case 230400:	myBaud = B230400 ; break ;
-
-    default:
-      return -2 ;
-  }
+  if (baud <= 0)
+    return -2 ;
 
   if ((fd = open (device, O_RDWR | O_NOCTTY | O_NDELAY | O_NONBLOCK)) == -1)
     return -1 ;
@@ -82,8 +126,6 @@ int serialOpen (const char *device, const int baud)
   tcgetattr (fd, &options) ;
 
     cfmakeraw   (&options) ;
-    cfsetispeed (&options, myBaud) ;
-    cfsetospeed (&options, myBaud) ;
 
     options.c_cflag |= (CLOCAL | CREAD) ;
     options.c_cflag &= ~PARENB ;
@@ -98,6 +140,12 @@ int serialOpen (const char *device, const int baud)
 
   tcsetattr (fd, TCSANOW | TCSAFLUSH, &options) ;
 
+  if (serialSetBaud (fd, baud) != 0)
+  {
+    close (fd) ;
+    return -2 ;
+  }
+
   ioctl (fd, TIOCMGET, &status);
 
   status |= TIOCM_DTR ;
@@ -111,6 +159,93 @@ int serialOpen (const char *device, const int baud)
 }
 
 
+/*
+ * serialSetBaud:
+ *	Set the baud rate of an open serial port. Standard rates use the
+ *	termios speed constants, and any other rate (e.g. the megabaud rates
+ *	of a USB-serial bridge) is set exactly with termios2 and BOTHER. The
+ *	driver may round the rate, see serialGetBaud.
+ *	Returns 0 on success, -1 on error and -2 if the rate is not supported.
+ *********************************************************************************
+ */
+
+int serialSetBaud (const int fd, const int baud)
+{
+  struct termios options ;
+  speed_t myBaud ;
+
+  if (baud <= 0)
+    return -2 ;
+
+  if ((myBaud = serialGetSpeed (baud)) != B0)
+  {
+    if (tcgetattr (fd, &options) == -1)
+      return -1 ;
+
+    cfsetispeed (&options, myBaud) ;
+    cfsetospeed (&options, myBaud) ;
+
+    if (tcsetattr (fd, TCSANOW, &options) == -1)
+      return -1 ;
+
+    return 0 ;
+  }
+
+#if defined (__linux__) && defined (TCSETS2)
+  {
+    struct termios2 options2 ;
+
+    if (ioctl (fd, TCGETS2, &options2) == -1)
+      return -1 ;
+
+    options2.c_cflag &= ~(CBAUD | (CBAUD << IBSHIFT)) ;
+    options2.c_cflag |= BOTHER | (BOTHER << IBSHIFT) ;
+    options2.c_ispeed = baud ;
+    options2.c_ospeed = baud ;
+
+    if (ioctl (fd, TCSETS2, &options2) == -1)
+      return -2 ;
+
+    return 0 ;
+  }
+#else
+  return -2 ;
+#endif
+}
+
+
+/*
+ * serialGetBaud:
+ *	Return the actual baud rate of an open serial port, or -1 on error.
+ *********************************************************************************
+ */
+
+int serialGetBaud (const int fd)
+{
+#if defined (__linux__) && defined (TCGETS2)
+  struct termios2 options2 ;
+
+  if (ioctl (fd, TCGETS2, &options2) == -1)
+    return -1 ;
+
+  return (int)options2.c_ospeed ;
+#else
+  static const int rates [] = { 50, 75, 110, 134, 150, 200, 300, 600, 1200, 1800, 2400, 4800, 9600, 19200, 38400, 57600, 115200, 230400 } ;
+  struct termios options ;
+  unsigned int i ;
+
+  if (tcgetattr (fd, &options) == -1)
+    return -1 ;
+
+  for (i = 0 ; i < sizeof (rates) / sizeof (rates [0]) ; ++i)
+    if (serialGetSpeed (rates [i]) == cfgetospeed (&options))
+      return rates [i] ;
+
+  return -1 ;
+#endif
+}
+
+
 /*
  * serialFlush:
  *	Flush the serial buffers (both tx & rx)
@@ -194,6 +329,66 @@ int serialDataAvail (const int fd)
 }
 
 
+/*
+ * serialSetTimeouts:
+ *	Set the minimum number of characters for a read (VMIN) and the read
+ *	timeout in deciseconds (VTIME). With VTIME set to zero, poll() on the
+ *	port will not return until at least VMIN characters are waiting.
+ *********************************************************************************
+ */
+
+int serialSetTimeouts (const int fd, const int vmin, const int vtime)
+{
+  struct termios options ;
+
+  if ((vmin < 0) || (vmin > 255) || (vtime < 0) || (vtime > 255))
+    return -2 ;
+
+  if (tcgetattr (fd, &options) == -1)
+    return -1 ;
+
+  options.c_cc [VMIN]  = vmin ;
+  options.c_cc [VTIME] = vtime ;
+
+  if (tcsetattr (fd, TCSANOW, &options) == -1)
+    return -1 ;
+
+  return 0 ;
+}
+
+
+/*
+ * serialWait:
+ *	Sleep until data is ready to be read from the serial port, or until
+ *	timeout milliseconds have passed (a negative timeout waits forever).
+ *	Returns 1 if data is ready, 0 on timeout or interrupt and -1 on error.
+ *********************************************************************************
+ */
+
+int serialWait (const int fd, const int timeout)
+{
+  struct pollfd pfd ;
+  int result ;
+
+  pfd.fd      = fd ;
+  pfd.events  = POLLIN ;
+  pfd.revents = 0 ;
+
+  result = poll (&pfd, 1, timeout) ;
+
+  if (result == -1)
+    return (errno == EINTR) ? 0 : -1 ;
+
+  if (result == 0)
+    return 0 ;
+
+  if (pfd.revents & (POLLERR | POLLHUP | POLLNVAL))
+    return -1 ;
+
+  return 1 ;
+}
+
+
 /*
  * serialGetchar:
  *	Get a single character from the serial device.
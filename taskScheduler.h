@@ -0,0 +1,91 @@
+#ifndef TASK_SCHEDULER_H
+#define TASK_SCHEDULER_H
+
+#include <stdint.h>
+
+// Maximum number of scheduled tasks.
+#define SCHEDULER_MAX_TASKS 8
+
+// A scheduled task. now_ is the time at which the scheduler ran the task.
+typedef void (*TaskFunction)(unsigned long now_);
+
+// Cooperative scheduler for periodic tasks. Times may be in any unit (e.g. from micros()),
+// and all comparisons are safe when the clock wraps around. A task which falls more than a
+// full period behind skips the missed runs instead of running several times in a row.
+class TaskScheduler{
+ public:
+  TaskScheduler() : numTasks(0) { }
+
+  // Add a task which runs every period_, starting at start_. Return the index of the task,
+  // or -1 if there is no room for another task.
+  int8_t add(TaskFunction func_, unsigned long period_, unsigned long start_=0){
+    if(numTasks >= SCHEDULER_MAX_TASKS){ return -1; }
+    Task &task = tasks[numTasks];
+    task.func = func_;
+    task.period = period_;
+    task.next = start_;
+    task.maxLate = 0;
+    task.overruns = 0;
+    return numTasks++;
+  }
+
+  // Run every task which is due at now_, in the order the tasks were added.
+  // Return the number of tasks which were run.
+  uint8_t run(unsigned long now_){
+    uint8_t count = 0;
+    for(uint8_t index = 0; index < numTasks; index++){
+      Task &task = tasks[index];
+      if((long)(now_-task.next) < 0){ continue; }
+
+      unsigned long late = now_-task.next;
+      if(late > task.maxLate){ task.maxLate = late; }
+
+      task.next += task.period;
+      if((long)(now_-task.next) >= 0){ // Missed at least one entire period.
+        task.next = now_+task.period;
+        task.overruns++;
+      }
+
+      task.func(now_);
+      count++;
+    }
+    return count;
+  }
+
+  // Return the time until the next task is due, or zero if a task is already due.
+  unsigned long getTimeToNext(unsigned long now_) const {
+    unsigned long wait = 0;
+    for(uint8_t index = 0; index < numTasks; index++){
+      if((long)(tasks[index].next-now_) <= 0){ return 0; }
+      if(index == 0 || tasks[index].next-now_ < wait){ wait = tasks[index].next-now_; }
+    }
+    return wait;
+  }
+
+  uint8_t getNumTasks() const { return numTasks; }
+
+  // Return the longest time a task has been run after it was due.
+  unsigned long getMaxLate(uint8_t task_) const { return tasks[task_].maxLate; }
+
+  // Reset the longest late time of every task, e.g. to measure it over a new interval.
+  void clearMaxLate(){
+    for(uint8_t index = 0; index < numTasks; index++){ tasks[index].maxLate = 0; }
+  }
+
+  // Return the number of times a task missed an entire period.
+  uint16_t getOverruns(uint8_t task_) const { return tasks[task_].overruns; }
+
+ private:
+  struct Task{
+    TaskFunction func;
+    unsigned long period;
+    unsigned long next; // Time at which the task is next due.
+    unsigned long maxLate;
+    uint16_t overruns;
+  };
+
+  Task tasks[SCHEDULER_MAX_TASKS];
+  uint8_t numTasks;
+};
+
+#endif